@@ -0,0 +1,46 @@
+/**
+ * aligned_allocator.h - Cache-line aligned allocator for numeric buffers
+ *
+ * Lets std::vector hand out storage aligned to a cache line (64 bytes by
+ * default) so hot weight and feature buffers start on a line boundary and
+ * can be loaded with aligned SIMD instructions.
+ */
+
+ #ifndef ALIGNED_ALLOCATOR_H
+ #define ALIGNED_ALLOCATOR_H
+
+ #include <cstddef>
+ #include <new>
+ #include <vector>
+
+ template <typename T, std::size_t Alignment = 64>
+ struct AlignedAllocator {
+     using value_type = T;
+
+     template <typename U>
+     struct rebind {
+         using other = AlignedAllocator<U, Alignment>;
+     };
+
+     AlignedAllocator() noexcept = default;
+     template <typename U>
+     AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+     T* allocate(std::size_t n) {
+         return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+     }
+
+     void deallocate(T* p, std::size_t) noexcept {
+         ::operator delete(p, std::align_val_t(Alignment));
+     }
+
+     template <typename U>
+     bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept { return true; }
+     template <typename U>
+     bool operator!=(const AlignedAllocator<U, Alignment>&) const noexcept { return false; }
+ };
+
+ // 64-byte aligned float buffer used for contiguous weight matrices
+ using AlignedFloatVector = std::vector<float, AlignedAllocator<float, 64>>;
+
+ #endif // ALIGNED_ALLOCATOR_H
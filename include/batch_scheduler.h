@@ -0,0 +1,84 @@
+/**
+ * batch_scheduler.h - Micro-batching front end for LoanScorer
+ *
+ * Callers submit single applications and get a future for the decision. A
+ * worker thread collects queued requests into a batch until it holds
+ * maxBatch rows or the oldest request has waited deadline, runs one
+ * LoanScorer::scoreBatch call for the batch and completes the futures in
+ * submission order. Latency (submit to completion) is tracked per request
+ * in a column_stats sketch, so p50/p99 cost O(1) per request to record.
+ */
+
+ #ifndef BATCH_SCHEDULER_H
+ #define BATCH_SCHEDULER_H
+
+ #include <chrono>
+ #include <condition_variable>
+ #include <cstdint>
+ #include <deque>
+ #include <functional>
+ #include <future>
+ #include <mutex>
+ #include <thread>
+ #include "loan_scorer.h"
+ #include "column_stats.h"
+
+ struct SchedulerOptions {
+     int maxBatch = 64;                                  // Rows per scoreBatch call at most
+     std::chrono::microseconds deadline{200};            // Longest a request waits for others
+ };
+
+ struct SchedulerStats {
+     uint64_t requests = 0;
+     uint64_t batches = 0;
+     double meanBatch = 0.0;
+     double p50Micros = 0.0;                             // Submit-to-completion latency
+     double p99Micros = 0.0;
+     double maxMicros = 0.0;
+ };
+
+ class BatchScheduler {
+ public:
+     // onBatchDone, if given, runs on the worker thread after each batch's
+     // futures are ready (e.g. to wake an event loop)
+     BatchScheduler(LoanScorer& scorer, const SchedulerOptions& options,
+                    std::function<void()> onBatchDone = nullptr);
+     // Scores whatever is still queued, then stops the worker
+     ~BatchScheduler();
+
+     BatchScheduler(const BatchScheduler&) = delete;
+     BatchScheduler& operator=(const BatchScheduler&) = delete;
+
+     // Queue one raw application (LOAN_FEATURES values)
+     std::future<LoanDecision> submit(const float* features);
+
+     SchedulerStats stats() const;
+
+ private:
+     using Clock = std::chrono::steady_clock;
+
+     struct Pending {
+         float features[LOAN_FEATURES];
+         std::promise<LoanDecision> promise;
+         Clock::time_point submitted;
+     };
+
+     void run();
+
+     LoanScorer& scorer;
+     SchedulerOptions options;
+     std::function<void()> onBatchDone;
+
+     std::mutex mutex;
+     std::condition_variable wake;
+     std::deque<Pending> queue;
+     bool stopping = false;
+
+     mutable std::mutex statsMutex;
+     uint64_t batches = 0;
+     column_stats::ColumnStats latencyMicros;
+
+     std::thread worker;                                 // Last: starts once the rest is built
+ };
+
+ #endif // BATCH_SCHEDULER_H
@@ -0,0 +1,171 @@
+/**
+ * binary_dataset.h - Versioned binary columnar dataset format
+ *
+ * Lets the preprocessor hand data to the trainer and evaluator without a
+ * text round trip. Layout (little-endian, no implicit padding):
+ *
+ *   FileHeader            magic "LOANCOL\0", version, column count, row
+ *                         count, label column, flags, data offset
+ *   column descriptors    per column: type (uint32), name length (uint32),
+ *                         name bytes
+ *   zero padding          up to dataOffset, a multiple of 64
+ *   column data           per column: numRows 4-byte values, zero padded to
+ *                         the next multiple of 64 bytes
+ *   row-major features    optional (FLAG_ROW_MAJOR_FEATURES): every non-label
+ *                         column again as one float32 numRows x D matrix
+ *
+ * Every column and the feature matrix start on a 64-byte boundary of the
+ * file, so a page-aligned mapping of it gives cache-line aligned arrays.
+ * The row-major copy is what the models consume; with it MappedDataset can
+ * hand out the feature matrix without copying.
+ */
+
+ #ifndef BINARY_DATASET_H
+ #define BINARY_DATASET_H
+
+ #include <cstdint>
+ #include <fstream>
+ #include <string>
+ #include <vector>
+ #include "data_span.h"
+
+ namespace binary_dataset {
+
+ constexpr char MAGIC[8] = {'L', 'O', 'A', 'N', 'C', 'O', 'L', '\0'};
+ constexpr uint32_t VERSION = 1;
+ constexpr uint64_t ALIGNMENT = 64;
+ constexpr uint32_t FLAG_ROW_MAJOR_FEATURES = 1u << 0;
+
+ enum class ColumnType : uint32_t { Float32 = 0, Int32 = 1 };
+
+ #pragma pack(push, 1)
+ struct FileHeader {
+     char magic[8];
+     uint32_t version;
+     uint32_t numColumns;
+     uint64_t numRows;
+     int32_t labelColumn;     // -1 when the file carries no label
+     uint32_t flags;          // FLAG_* bits
+     uint64_t dataOffset;     // Byte offset of the first column, 64-aligned
+ };
+ #pragma pack(pop)
+
+ struct ColumnInfo {
+     std::string name;
+     ColumnType type;
+     uint64_t offset;         // Byte offset of the column data in the file
+ };
+
+ struct DatasetInfo {
+     uint64_t numRows = 0;
+     int labelColumn = -1;
+     uint64_t dataOffset = 0;
+     uint64_t rowMajorOffset = 0;   // 0 when the file has no row-major copy
+     std::vector<ColumnInfo> columns;
+
+     int numFeatures() const { return static_cast<int>(columns.size()) - (labelColumn >= 0 ? 1 : 0); }
+ };
+
+ // Column to be written: numRows values of the given type at `data`
+ struct ColumnSource {
+     std::string name;
+     ColumnType type;
+     const void* data;
+ };
+
+ // Name and type of a column written through DatasetWriter
+ struct ColumnSpec {
+     std::string name;
+     ColumnType type;
+ };
+
+ // Bytes a column of numRows 4-byte values occupies, padding included
+ uint64_t paddedColumnBytes(uint64_t numRows);
+
+ // True if the file starts with the binary dataset magic
+ bool isBinaryDataset(const std::string& filename);
+
+ // Write the columns, plus the row-major feature matrix unless disabled;
+ // throws std::runtime_error on I/O failure
+ void writeDataset(const std::string& filename,
+                   const std::vector<ColumnSource>& columns,
+                   uint64_t numRows,
+                   int labelColumn,
+                   bool withRowMajorFeatures = true);
+
+ // Writes a dataset whose row count is known up front a chunk of rows at
+ // a time, so the caller never holds more than one chunk. Each append()
+ // lands in every column (and the row-major block) at its final offset.
+ class DatasetWriter {
+ public:
+     // Throws std::runtime_error if the file cannot be created
+     DatasetWriter(const std::string& filename,
+                   const std::vector<ColumnSpec>& columns,
+                   uint64_t numRows,
+                   int labelColumn,
+                   bool withRowMajorFeatures = true);
+
+     // Append `rows` rows; columnData holds one pointer per column, in order
+     void append(const std::vector<const void*>& columnData, uint64_t rows);
+
+     // Write the column padding and check that numRows rows were appended
+     void finish();
+
+ private:
+     std::string filename;
+     std::ofstream file;
+     std::vector<ColumnType> types;
+     uint64_t numRows;
+     uint64_t rowsWritten = 0;
+     int labelColumn;
+     uint64_t dataOffset = 0;
+     uint64_t rowMajorOffset = 0;   // 0 without a row-major block
+     std::vector<float> block;      // Row-major staging for one append
+ };
+
+ // Parse and validate the header and column descriptors; throws
+ // std::runtime_error on a bad magic, unsupported version or truncation
+ DatasetInfo readInfo(const std::string& filename);
+
+ // Load every non-label column as float32 features into a row-major N x D
+ // matrix and the label column into y
+ void loadDataset(const std::string& filename,
+                  std::vector<float>& X,
+                  std::vector<int>& y,
+                  int& N,
+                  int& D);
+
+ // Read-only memory mapping of a dataset file. features() and labels()
+ // point straight into the mapping when the file has a row-major feature
+ // matrix and an int32 label column; otherwise they are materialized once
+ // into owned buffers. Processes mapping the same file share its pages.
+ class MappedDataset {
+ public:
+     // Throws std::runtime_error if the file cannot be mapped or is invalid
+     explicit MappedDataset(const std::string& filename);
+     ~MappedDataset();
+
+     MappedDataset(const MappedDataset&) = delete;
+     MappedDataset& operator=(const MappedDataset&) = delete;
+
+     const DatasetInfo& info() const { return header; }
+     int numRows() const { return static_cast<int>(header.numRows); }
+     int numFeatures() const { return header.numFeatures(); }
+
+     FloatSpan features() const { return featureView; }   // Row-major N x D
+     LabelSpan labels() const { return labelView; }       // N labels
+     bool isZeroCopy() const { return ownedFeatures.empty() && ownedLabels.empty(); }
+
+ private:
+     DatasetInfo header;
+     void* mapping = nullptr;
+     size_t mappingSize = 0;
+     std::vector<float> ownedFeatures;
+     std::vector<int> ownedLabels;
+     FloatSpan featureView;
+     LabelSpan labelView;
+ };
+
+ } // namespace binary_dataset
+
+ #endif // BINARY_DATASET_H
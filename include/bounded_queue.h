@@ -0,0 +1,80 @@
+/**
+ * bounded_queue.h - Blocking fixed-capacity queue between pipeline stages
+ *
+ * A producer blocks in push() while the queue is full and a consumer blocks
+ * in pop() while it is empty, so a slow stage throttles the ones before it
+ * instead of letting chunks pile up in memory. close() marks the end of the
+ * stream; abort() also wakes every waiter so a failed pipeline can unwind.
+ */
+
+ #ifndef BOUNDED_QUEUE_H
+ #define BOUNDED_QUEUE_H
+
+ #include <condition_variable>
+ #include <cstddef>
+ #include <deque>
+ #include <mutex>
+
+ template <typename T>
+ class BoundedQueue {
+ public:
+     explicit BoundedQueue(std::size_t capacity) : capacity(capacity > 0 ? capacity : 1) {}
+
+     BoundedQueue(const BoundedQueue&) = delete;
+     BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+     // Blocks while full; false if the queue was closed or aborted
+     bool push(T item) {
+         std::unique_lock<std::mutex> lock(mutex);
+         notFull.wait(lock, [this] { return items.size() < capacity || closed; });
+         if (closed) {
+             return false;
+         }
+         items.push_back(std::move(item));
+         notEmpty.notify_one();
+         return true;
+     }
+
+     // Blocks while empty; false once the queue is closed and drained, or
+     // as soon as it is aborted
+     bool pop(T& item) {
+         std::unique_lock<std::mutex> lock(mutex);
+         notEmpty.wait(lock, [this] { return !items.empty() || closed; });
+         if (aborted || items.empty()) {
+             return false;
+         }
+         item = std::move(items.front());
+         items.pop_front();
+         notFull.notify_one();
+         return true;
+     }
+
+     // No more items will be pushed; queued ones can still be popped
+     void close() {
+         std::lock_guard<std::mutex> lock(mutex);
+         closed = true;
+         notEmpty.notify_all();
+         notFull.notify_all();
+     }
+
+     // Drop queued items and release every blocked producer and consumer
+     void abort() {
+         std::lock_guard<std::mutex> lock(mutex);
+         closed = true;
+         aborted = true;
+         items.clear();
+         notEmpty.notify_all();
+         notFull.notify_all();
+     }
+
+ private:
+     std::size_t capacity;
+     std::deque<T> items;
+     bool closed = false;
+     bool aborted = false;
+     std::mutex mutex;
+     std::condition_variable notEmpty;
+     std::condition_variable notFull;
+ };
+
+ #endif // BOUNDED_QUEUE_H
@@ -0,0 +1,170 @@
+/**
+ * column_stats.h - Mergeable per-column summary statistics
+ *
+ * ColumnStats accumulates count, mean and variance (Welford), min/max and a
+ * quantile sketch for one numeric column. Two summaries of disjoint parts
+ * of a column merge exactly for the moments (Chan et al.) and within the
+ * sketch's value error for quantiles, so a column can be summarised per
+ * thread, per chunk or per process and combined afterwards. mergeAll
+ * combines a list of partial summaries pairwise, keeping the merged parts
+ * balanced in size.
+ */
+
+ #ifndef COLUMN_STATS_H
+ #define COLUMN_STATS_H
+
+ #include <cstddef>
+ #include <cstdint>
+ #include <cstring>
+ #include <limits>
+ #include <vector>
+
+ namespace column_stats {
+
+ // Mantissa bits kept per sketch bucket: a quantile is off by a relative
+ // error of at most 2^-(SKETCH_MANTISSA_BITS + 1)
+ constexpr int SKETCH_MANTISSA_BITS = 8;
+
+ // Log-bucketed histogram (as in HDR histograms and DDSketch). A value's
+ // bucket is its sign, binary exponent and leading mantissa bits, read
+ // straight off its IEEE bit pattern, so add() is a few integer operations
+ // and merge() adds bucket counts - exact and independent of how the
+ // column was split.
+ class QuantileSketch {
+ public:
+     void add(double value) {
+         if (value == 0.0) {
+             ++zeros;
+         } else if (value > 0.0) {
+             positive.add(key(value));
+         } else if (value < 0.0) {
+             negative.add(key(-value));
+         } else {
+             return;   // NaN
+         }
+         ++n;
+     }
+
+     void merge(const QuantileSketch& other);
+
+     // Approximate q-quantile (0 <= q <= 1); NaN when empty
+     double quantile(double q) const;
+     uint64_t count() const { return n; }
+
+ private:
+     // Counts for a contiguous range of bucket keys, grown on demand
+     struct Buckets {
+         int64_t first = 0;
+         std::vector<uint64_t> counts;
+
+         void add(int64_t k) {
+             if (k < first || k >= first + static_cast<int64_t>(counts.size())) {
+                 grow(k);
+             }
+             ++counts[k - first];
+         }
+         void grow(int64_t k);
+     };
+
+     // Positive doubles order like their bit patterns, so dropping the low
+     // mantissa bits gives monotone bucket keys
+     static int64_t key(double magnitude) {
+         uint64_t bits;
+         std::memcpy(&bits, &magnitude, sizeof(bits));
+         return static_cast<int64_t>(bits >> (52 - SKETCH_MANTISSA_BITS));
+     }
+     static double bucketValue(int64_t k);   // Midpoint of bucket k
+
+     uint64_t n = 0;
+     uint64_t zeros = 0;
+     Buckets positive;
+     Buckets negative;   // Keyed by magnitude
+ };
+
+ class ColumnStats {
+ public:
+     void add(double value);
+
+     // Add values[begin, end) of the rows whose bit is set in valid (bit i
+     // of word i / 64, least significant first; nullptr: every row). The
+     // moments come from a sum and a squared-deviation loop over the
+     // block, so keep blocks small enough to stay in cache.
+     template <typename T>
+     void addBlock(const T* values, const uint64_t* valid, size_t begin, size_t end);
+
+     void merge(const ColumnStats& other);
+
+     // Merge parts pairwise (parts[0] += parts[1], parts[2] += parts[3],
+     // then parts[0] += parts[2], ...) and return the total
+     static ColumnStats mergeAll(std::vector<ColumnStats> parts);
+
+     uint64_t count() const { return n; }
+     double mean() const { return mu; }
+     double variance() const;         // Population variance; 0 when empty
+     double sampleVariance() const;   // 0 with fewer than two values
+     double sampleStddev() const;
+     double min() const { return lo; }   // +inf when empty
+     double max() const { return hi; }   // -inf when empty
+     // Approximate q-quantile, clamped to [min, max]; NaN when empty
+     double quantile(double q) const;
+     double median() const { return quantile(0.5); }
+
+ private:
+     uint64_t n = 0;
+     double mu = 0.0;
+     double m2 = 0.0;   // Sum of squared deviations from the mean
+     double lo = std::numeric_limits<double>::infinity();
+     double hi = -std::numeric_limits<double>::infinity();
+     QuantileSketch sketch;
+ };
+
+ template <typename T>
+ void ColumnStats::addBlock(const T* values, const uint64_t* valid, size_t begin, size_t end) {
+     auto present = [valid](size_t i) {
+         return valid == nullptr || ((valid[i / 64] >> (i % 64)) & 1);
+     };
+
+     double count = 0.0, sum = 0.0;
+     double blockMin = std::numeric_limits<double>::infinity();
+     double blockMax = -std::numeric_limits<double>::infinity();
+     #pragma omp simd reduction(+ : count, sum) reduction(min : blockMin) reduction(max : blockMax)
+     for (size_t i = begin; i < end; ++i) {
+         const double x = static_cast<double>(values[i]);
+         const bool p = present(i);
+         count += p;
+         sum += p ? x : 0.0;
+         blockMin = p ? (x < blockMin ? x : blockMin) : blockMin;
+         blockMax = p ? (x > blockMax ? x : blockMax) : blockMax;
+     }
+     if (count == 0.0) {
+         return;
+     }
+
+     const double blockMean = sum / count;
+     double blockM2 = 0.0;
+     #pragma omp simd reduction(+ : blockM2)
+     for (size_t i = begin; i < end; ++i) {
+         const double d = static_cast<double>(values[i]) - blockMean;
+         blockM2 += present(i) ? d * d : 0.0;
+     }
+
+     for (size_t i = begin; i < end; ++i) {
+         if (present(i)) {
+             sketch.add(static_cast<double>(values[i]));
+         }
+     }
+
+     // Chan et al. merge of the block into the running moments
+     const uint64_t blockCount = static_cast<uint64_t>(count);
+     const uint64_t total = n + blockCount;
+     const double delta = blockMean - mu;
+     mu += delta * blockCount / total;
+     m2 += blockM2 + delta * delta * (static_cast<double>(n) * blockCount / total);
+     n = total;
+     lo = blockMin < lo ? blockMin : lo;
+     hi = blockMax > hi ? blockMax : hi;
+ }
+
+ } // namespace column_stats
+
+ #endif // COLUMN_STATS_H
@@ -0,0 +1,56 @@
+/**
+ * csv_loader.h - Parallel loader for numeric CSV datasets
+ *
+ * Shared by hybrid_ml_trainer and model_evaluator. The file is mapped,
+ * split into byte ranges at newline boundaries and parsed by OpenMP threads
+ * with std::from_chars straight into a preallocated row-major matrix: one
+ * pass counts the rows of each range, a prefix sum gives every range its
+ * first output row, and a second pass fills X and y.
+ *
+ * Only plain numeric fields are supported (no quoting); blank lines are
+ * skipped and a trailing '\r' is ignored.
+ */
+
+ #ifndef CSV_LOADER_H
+ #define CSV_LOADER_H
+
+ #include <functional>
+ #include <string>
+ #include <vector>
+
+ namespace csv_loader {
+
+ // Which columns become the label and the features
+ struct ColumnSelection {
+     bool hasHeader = true;             // Skip the first line
+     int labelColumn = -1;              // -1: last column
+     std::vector<int> featureColumns;   // Empty: every other column, in file order
+ };
+
+ // Load the label column into y (truncated to int) and the selected
+ // feature columns into a row-major N x D matrix X. Throws
+ // std::runtime_error if the file cannot be read, a row has the wrong
+ // number of fields or a field is not a number.
+ void loadCsv(const std::string& filename,
+              std::vector<float>& X,
+              std::vector<int>& y,
+              int& N,
+              int& D,
+              const ColumnSelection& selection = ColumnSelection());
+
+ // Gets each chunk of consecutive rows: a row-major rows x numFeatures
+ // matrix and the labels, valid only during the call
+ using ChunkHandler = std::function<void(const float* X, const int* y, int rows, int numFeatures)>;
+
+ // Parse the file front to back and hand it over chunkRows rows at a time,
+ // so the caller can start on (or send off) the first rows while the rest
+ // is still being parsed. Same format, selection and errors as loadCsv; a
+ // malformed row throws once the rows before it have been handed over.
+ void streamCsv(const std::string& filename,
+                int chunkRows,
+                const ChunkHandler& onChunk,
+                const ColumnSelection& selection = ColumnSelection());
+
+ } // namespace csv_loader
+
+ #endif // CSV_LOADER_H
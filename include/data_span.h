@@ -0,0 +1,43 @@
+/**
+ * data_span.h - Read-only views over contiguous feature and label arrays
+ *
+ * Training and evaluation only read X and y, so they take these views
+ * instead of const std::vector references. A view converts implicitly from
+ * a vector, and can also point into memory the caller does not own, e.g.
+ * a memory-mapped dataset file or one rank's slice of a shared matrix.
+ */
+
+ #ifndef DATA_SPAN_H
+ #define DATA_SPAN_H
+
+ #include <cstddef>
+ #include <vector>
+
+ template <typename T>
+ class ConstSpan {
+ public:
+     ConstSpan() = default;
+     ConstSpan(const T* data, std::size_t size) : ptr(data), count(size) {}
+     template <typename Alloc>
+     ConstSpan(const std::vector<T, Alloc>& v) : ptr(v.data()), count(v.size()) {}
+
+     const T* data() const { return ptr; }
+     std::size_t size() const { return count; }
+     bool empty() const { return count == 0; }
+     const T& operator[](std::size_t i) const { return ptr[i]; }
+     const T* begin() const { return ptr; }
+     const T* end() const { return ptr + count; }
+
+     // View of count elements starting at offset
+     ConstSpan subspan(std::size_t offset, std::size_t n) const { return ConstSpan(ptr + offset, n); }
+
+ private:
+     const T* ptr = nullptr;
+     std::size_t count = 0;
+ };
+
+ // Row-major N x D feature matrix and N labels
+ using FloatSpan = ConstSpan<float>;
+ using LabelSpan = ConstSpan<int>;
+
+ #endif // DATA_SPAN_H
@@ -0,0 +1,80 @@
+/**
+ * ensemble.h - Soft-vote combination of several trained classifiers
+ *
+ * Each member contributes P(class 1) for a whole batch from one
+ * predictProbaBatch call; the ensemble combines those probabilities with
+ * either
+ *
+ *   Weighted  sum_m w[m] * p[m] / sum_m w[m]
+ *   Stacked   sigmoid(b + sum_m v[m] * logit(p[m]))
+ *
+ * where the stacked meta-learner (v, b) is a LogisticRegression fitted on
+ * labelled rows the members did not train on. Fitting over member logits
+ * also recalibrates them: RF vote shares and normalized MLP outputs are
+ * scores rather than probabilities, and the meta-learner maps them to one.
+ * It is saved with LogisticRegression::saveModel, by default as
+ * ensemble_stacker.bin next to the models.
+ */
+
+ #ifndef ENSEMBLE_H
+ #define ENSEMBLE_H
+
+ #include <memory>
+ #include <string>
+ #include <vector>
+ #include "evaluate.h"
+ #include "logistic_regression.h"
+
+ constexpr const char* DEFAULT_STACKER_FILE = "ensemble_stacker.bin";
+
+ enum class EnsembleRule { Weighted, Stacked };
+
+ class Ensemble {
+ public:
+     // Members take part in the order they are added
+     void addMember(const std::string& name, std::unique_ptr<ModelInterface> model, float weight = 1.0f);
+
+     int size() const { return static_cast<int>(members.size()); }
+     const std::string& memberName(int m) const { return members[m].name; }
+     ModelInterface& member(int m) { return *members[m].model; }
+
+     // One weight per member, all >= 0 with a positive sum; throws
+     // std::invalid_argument otherwise
+     void setWeights(const std::vector<float>& weights);
+     std::vector<float> weights() const;
+
+     // Stacked needs a fitted or loaded meta-learner; throws
+     // std::logic_error otherwise
+     void setRule(EnsembleRule rule);
+     EnsembleRule rule() const { return combineRule; }
+     bool hasStacker() const { return stacker != nullptr; }
+
+     // Fit the meta-learner on N labelled rows (X already transformed) and
+     // switch to Stacked
+     void fitStacker(const float* X, const int* y, int N, int D);
+     void saveStacker(const std::string& filename) const;
+     // Load a meta-learner saved for the same members and switch to
+     // Stacked; throws std::runtime_error if the file is missing or was
+     // fitted for a different number of members
+     void loadStacker(const std::string& filename);
+
+     // Score N rows: memberProbs (N x size(), row-major) gets each member's
+     // P(class 1) and combined the ensemble's. memberProbs may be null.
+     void predictProba(const float* X, int N, int D, float* combined, float* memberProbs = nullptr);
+
+ private:
+     struct Member {
+         std::string name;
+         std::unique_ptr<ModelInterface> model;
+         float weight;
+     };
+
+     // N x size() member probabilities, row-major
+     void memberProbabilities(const float* X, int N, int D, float* probs);
+
+     std::vector<Member> members;
+     EnsembleRule combineRule = EnsembleRule::Weighted;
+     std::unique_ptr<LogisticRegression> stacker;
+ };
+
+ #endif // ENSEMBLE_H
@@ -124,6 +124,7 @@
 #include <memory>
 #include <iostream>
 #include <mpi.h>
+#include "data_span.h"
 
 // Forward declarations for model classes
 class RandomForest;
@@ -136,6 +137,10 @@ public:
     virtual ~ModelInterface() = default;
     virtual void loadModel(const std::string& path) = 0;
     virtual int predict(const std::vector<float>& features) = 0;  // Note: Not const to match your implementation
+    // Score N rows of a contiguous row-major N x D matrix into out[0..N)
+    virtual void predictBatch(const float* X, int N, int D, int* out) = 0;
+    // Probability of class 1 for N rows of a row-major N x D matrix
+    virtual void predictProbaBatch(const float* X, int N, int D, float* out) = 0;
     // make a full copy, so each thread can have its own instance
     virtual std::unique_ptr<ModelInterface> clone() const = 0;
 };
@@ -150,7 +155,8 @@ struct Metrics {
 };
 #pragma pack(pop)
 
-// Load test data from CSV: fills X (row-major N*D), y (size N), and sets N (#samples) and D (#features)
+// Load test data from CSV or a binary columnar dataset (binary_dataset.h):
+// fills X (row-major N*D), y (size N), and sets N (#samples) and D (#features)
 void loadTestData(const std::string& filename,
                   std::vector<float>& X,
                   std::vector<int>& y,
@@ -160,15 +166,15 @@ void loadTestData(const std::string& filename,
 // Evaluate a model at modelPath on dataset (X,y) with dimensions N x D
 // Uses OpenMP to parallelize predictions and accumulate TP, FP, TN, FN
 Metrics evaluateModel(const std::string& modelPath,
-                      const std::vector<float>& X,
-                      const std::vector<int>& y,
+                      FloatSpan X,
+                      LabelSpan y,
                       int N,
                       int D);
 
 // Function to evaluate any model that implements ModelInterface
 Metrics evaluate(const ModelInterface& prototype,
-                 const std::vector<float>& X,
-                 const std::vector<int>& y,
+                 FloatSpan X,
+                 LabelSpan y,
                  int N,
                  int D);
 
@@ -0,0 +1,92 @@
+/**
+ * feature_transform.h - Persisted per-feature input transform
+ *
+ * The preprocessor writes the statistics it computed as a small binary
+ * artifact; the trainer, evaluator and predictor map it and apply the same
+ * transform to every feature row, so scoring never re-derives or hard-codes
+ * statistics. Each feature j becomes
+ *
+ *   (clamp(x, lower[j], upper[j]) - offset[j]) * scale[j]
+ *
+ * i.e. standardisation of the numeric columns, clipped to the range seen in
+ * the training data, and identity (offset 0, scale 1, unbounded) for the
+ * categorical ones. Layout (little-endian):
+ *
+ *   TransformHeader     magic "LOANFTX\0", version, feature count, rows
+ *                       the statistics came from, parameter offset
+ *   parameters          float32 offset[D], scale[D], lower[D], upper[D]
+ */
+
+ #ifndef FEATURE_TRANSFORM_H
+ #define FEATURE_TRANSFORM_H
+
+ #include <cstddef>
+ #include <cstdint>
+ #include <limits>
+ #include <string>
+ #include <vector>
+
+ namespace feature_transform {
+
+ constexpr char MAGIC[8] = {'L', 'O', 'A', 'N', 'F', 'T', 'X', '\0'};
+ constexpr uint32_t VERSION = 1;
+
+ // Written next to the models by default and looked up there by ml_predictor
+ constexpr const char* DEFAULT_TRANSFORM_FILE = "feature_transform.bin";
+
+ #pragma pack(push, 1)
+ struct TransformHeader {
+     char magic[8];
+     uint32_t version;
+     uint32_t numFeatures;
+     uint64_t numRows;         // Rows the statistics were computed over
+     uint64_t paramsOffset;    // Byte offset of the parameter arrays
+ };
+ #pragma pack(pop)
+
+ struct FeatureParams {
+     float offset = 0.0f;
+     float scale = 1.0f;
+     float lower = -std::numeric_limits<float>::infinity();   // Default: no clipping
+     float upper = std::numeric_limits<float>::infinity();
+ };
+
+ // Throws std::runtime_error if the file cannot be written
+ void writeTransform(const std::string& filename, const std::vector<FeatureParams>& features, uint64_t numRows);
+
+ class FeatureTransform {
+ public:
+     // Maps filename; throws std::runtime_error if it cannot be read or is
+     // not a transform file
+     explicit FeatureTransform(const std::string& filename);
+     ~FeatureTransform();
+
+     FeatureTransform(const FeatureTransform&) = delete;
+     FeatureTransform& operator=(const FeatureTransform&) = delete;
+
+     int numFeatures() const { return static_cast<int>(header.numFeatures); }
+     uint64_t numRows() const { return header.numRows; }
+     FeatureParams params(int feature) const;
+
+     // Transform a row-major rows x numFeatures() batch; in and out may be
+     // the same buffer
+     void apply(const float* in, float* out, size_t rows) const;
+     std::vector<float> apply(const std::vector<float>& X) const;
+
+ private:
+     TransformHeader header{};
+     void* mapping = nullptr;
+     size_t mappingSize = 0;
+     const float* offsets = nullptr;   // Into the mapping
+     const float* scales = nullptr;
+     const float* lowers = nullptr;
+     const float* uppers = nullptr;
+
+     // Parameters repeated for TILE_ROWS rows, so a whole tile of the batch
+     // is one flat vectorizable loop however few features there are
+     std::vector<float> tileOffset, tileScale, tileLower, tileUpper;
+ };
+
+ } // namespace feature_transform
+
+ #endif // FEATURE_TRANSFORM_H
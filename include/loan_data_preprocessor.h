@@ -105,7 +105,10 @@
 #include <vector>
 #include <memory>
 #include <unordered_map>
+#include <iosfwd>
+#include <cstdint>
 #include <omp.h>
+#include "column_stats.h"
 
 // Forward declarations
 namespace csv
@@ -113,6 +116,11 @@ namespace csv
     class CSVReader; // From fast-cpp-csv-parser
 }
 
+namespace binary_dataset
+{
+    class DatasetWriter;
+}
+
 namespace loan_preprocessing
 {
     // Profiling utility
@@ -124,6 +132,12 @@ namespace loan_preprocessing
         int thread_id;
         int thread_count;
 
+        // Pipeline stages split their wall time into work and waiting on a
+        // neighbouring queue; other stages count as busy throughout
+        bool tracks_stalls{false};
+        double busy_time{0.0};
+        double stall_time{0.0};
+
         ProfileMetric(const std::string &name);
         void end();
     };
@@ -143,6 +157,81 @@ namespace loan_preprocessing
         static std::vector<double> column_stddevs;
     };
 
+    // One bit per row, set when the row holds a real value
+    class ValidityBitmap
+    {
+    public:
+        size_t size() const { return bits; }
+        void clear() { words.clear(); bits = 0; }
+        void reserve(size_t n) { words.reserve((n + 63) / 64); }
+
+        void push_back(bool valid)
+        {
+            if (bits % 64 == 0)
+            {
+                words.push_back(0);
+            }
+            words.back() |= static_cast<uint64_t>(valid) << (bits % 64);
+            bits++;
+        }
+
+        bool test(size_t i) const { return (words[i / 64] >> (i % 64)) & 1; }
+        const uint64_t *data() const { return words.data(); }
+
+        // Mark every row valid (bits past size() stay clear)
+        void set_all();
+        // Number of set bits in rows [begin, end); begin a multiple of 64
+        size_t count(size_t begin, size_t end) const;
+        size_t count() const { return count(0, bits); }
+
+    private:
+        std::vector<uint64_t> words;
+        size_t bits{0};
+    };
+
+    // Column-oriented rows: one contiguous array per field and a validity
+    // bitmap per column in place of the NaN / <= 0 / -1 sentinels. Missing
+    // entries are stored as 0 so column loops need no special cases.
+    struct LoanColumns
+    {
+        std::vector<double> income;
+        std::vector<int32_t> credit_score;
+        std::vector<double> loan_amount;
+        std::vector<double> dti_ratio;
+        std::vector<int32_t> employment_status;
+        std::vector<int32_t> approval;
+
+        ValidityBitmap income_valid;
+        ValidityBitmap credit_score_valid;
+        ValidityBitmap loan_amount_valid;
+        ValidityBitmap dti_ratio_valid;
+        ValidityBitmap employment_status_valid;
+        ValidityBitmap approval_valid;
+
+        size_t size() const { return income.size(); }
+        bool empty() const { return income.empty(); }
+        void clear();
+        void reserve(size_t n);
+
+        // Append a parsed record; sentinel values become missing entries
+        void append(const LoanRecord &record);
+    };
+
+    // Rows per chunk in streaming mode
+    constexpr size_t DEFAULT_STREAM_CHUNK_ROWS = 65536;
+
+    // Chunks each pipeline queue holds before its producer blocks
+    constexpr size_t PIPELINE_QUEUE_DEPTH = 4;
+
+    // Output format for Dataset::save_to_file
+    //  - Csv: text with a header row, as read by every tool
+    //  - Binary: versioned columnar file from binary_dataset.h
+    enum class OutputFormat
+    {
+        Csv,
+        Binary
+    };
+
     // Dataset container class
     class Dataset
     {
@@ -159,8 +248,28 @@ namespace loan_preprocessing
         // Main processing functions
         bool load_from_file(const std::string &filename);
         void preprocess();
-        void save_to_file(const std::string &filename);
+        void save_to_file(const std::string &filename, OutputFormat format = OutputFormat::Csv);
+
+        // Preprocess input_file into output_file without holding it in memory:
+        // one pass gathers the column statistics chunk by chunk, a second
+        // imputes and writes each chunk. Peak memory is bounded by chunk_rows.
+        bool stream_to_file(const std::string &input_file, const std::string &output_file,
+                            OutputFormat format = OutputFormat::Csv,
+                            size_t chunk_rows = DEFAULT_STREAM_CHUNK_ROWS);
+
+        // Same two passes with parsing, encoding, statistics / imputation,
+        // formatting and writing running as concurrent stages connected by
+        // bounded queues of chunk_rows-row chunks
+        bool pipeline_to_file(const std::string &input_file, const std::string &output_file,
+                              OutputFormat format = OutputFormat::Csv,
+                              size_t chunk_rows = DEFAULT_STREAM_CHUNK_ROWS);
         void print_sample(int sample_size) const;
+
+        // Write the feature transform artifact (feature_transform.h) built
+        // from the statistics of the last preprocess / stream / pipeline run:
+        // the numeric features standardised and clipped to their observed
+        // range, Employment_Status passed through
+        void save_transform(const std::string &filename) const;
         void export_profiling_data(const std::string &filename) const;
         void print_preprocessed_sample(int sample_size) const;
         bool verify_preprocessing() const;
@@ -171,13 +280,27 @@ namespace loan_preprocessing
         void encode_categorical_variables();
         void impute_missing_values();
         void normalize_numerical_features();
+        void save_binary(const std::string &filename) const;
+
+        // Per-chunk pieces shared by the in-memory and streaming paths
+        // (parallel = false when called from a pipeline stage thread)
+        void accumulate_statistics(const LoanColumns &rows, std::vector<column_stats::ColumnStats> &stats, bool parallel = true) const;
+        void finalize_statistics(const std::vector<column_stats::ColumnStats> &stats, size_t rows);
+        void count_missing_categorical(const LoanColumns &rows, int &missing_employment, int &missing_approval) const;
+        void report_missing_categorical(int missing_employment, int missing_approval) const;
+        void impute_columns(LoanColumns &rows, bool parallel = true) const;
+        void write_csv_header(std::ostream &out) const;
+        void write_csv_rows(std::ostream &out, const LoanColumns &rows) const;
+        void append_binary(binary_dataset::DatasetWriter &writer, const LoanColumns &rows) const;
 
         // Helper methods
         void encode_categorical_vars(LoanRecord &record, const std::string &employment, const std::string &approval);
         bool is_missing_value(const std::string &value) const;
 
         // Data members
-        std::vector<LoanRecord> records;
+        LoanColumns columns;
+        std::vector<column_stats::ColumnStats> feature_stats; // Income, credit score, loan amount, DTI ratio
+        size_t stats_rows{0};
         std::vector<ProfileMetric> profile_data;
 
         // Column name mappings for categorical variables
@@ -0,0 +1,80 @@
+/**
+ * loan_scorer.h - Ensemble loan decision over the three trained models
+ *
+ * Loads the Random Forest, MLP and Logistic Regression models and the
+ * preprocessor's feature transform once, then scores batches of raw
+ * applications: one transform and one predictProbaBatch call per model for
+ * the whole batch, combined by an Ensemble (ensemble.h) into the decision,
+ * the per-model votes and the risk score. Used by ml_predictor both for a
+ * single interactive decision and in its long-running server modes.
+ */
+
+ #ifndef LOAN_SCORER_H
+ #define LOAN_SCORER_H
+
+ #include <memory>
+ #include <string>
+ #include <vector>
+ #include "ensemble.h"
+ #include "feature_transform.h"
+
+ // Raw application: income, credit score, loan amount, DTI ratio, employment
+ constexpr int LOAN_FEATURES = 5;
+
+ enum class LoanOutcome { Approved, Borderline, NotApproved, Unavailable };
+
+ struct LoanDecision {
+     LoanOutcome outcome = LoanOutcome::Unavailable;
+     int rfVote = -1;            // 1 approve, 0 reject, -1 model not available
+     int mlpVote = -1;
+     int lrVote = -1;
+     float riskScore = -1.0f;    // Ensemble approval probability, 0-100; -1 without models
+ };
+
+ struct ScorerOptions {
+     // Weighted-rule weights; a model that is not loaded is left out
+     float rfWeight = 1.0f;
+     float mlpWeight = 1.0f;
+     float lrWeight = 1.0f;
+     // Combine with the stacked meta-learner from ensemble_stacker.bin in
+     // the model directory when it exists and matches the loaded models
+     bool useStacker = true;
+     // Approval probabilities within this distance of 0.5 are Borderline
+     float borderlineMargin = 0.05f;
+ };
+
+ class LoanScorer {
+ public:
+     // Loads every model it can find under modelDir; a model that fails to
+     // load is reported on stderr and left out of the ensemble
+     explicit LoanScorer(const std::string& modelDir = ".", const ScorerOptions& options = ScorerOptions());
+
+     bool anyModelLoaded() const { return ensemble.size() > 0; }
+     bool rfAvailable() const { return rfMember >= 0; }
+     bool mlpAvailable() const { return mlpMember >= 0; }
+     bool lrAvailable() const { return lrMember >= 0; }
+     const Ensemble& models() const { return ensemble; }
+
+     // Score n raw row-major applications (n x LOAN_FEATURES)
+     std::vector<LoanDecision> scoreBatch(const float* raw, int n);
+
+     // Fit the stacked meta-learner on n labelled raw applications, use it
+     // from now on and save it to filename
+     void fitStacker(const float* raw, const int* labels, int n, const std::string& filename);
+
+ private:
+     // Transformed copy of n raw rows
+     std::vector<float> transformed(const float* raw, int n) const;
+
+     Ensemble ensemble;
+     int rfMember = -1;          // Ensemble member index, -1 when not loaded
+     int mlpMember = -1;
+     int lrMember = -1;
+     float borderlineMargin;
+     std::unique_ptr<feature_transform::FeatureTransform> transform;
+ };
+
+ // "Approved", "Borderline - Additional Review Required", ...
+ std::string outcomeText(LoanOutcome outcome);
+
+ #endif // LOAN_SCORER_H
@@ -12,23 +12,38 @@
  #include <string>
  #include <random>
  #include <memory>
+ #include <functional>
  #include "evaluate.h"  // For ModelInterface
+ #include "aligned_allocator.h"
+ #include "data_span.h"
+ 
+ // Optimizer used by LogisticRegression::train
+ //  - GradientDescent: fixed-step full-batch gradient descent for
+ //    maxIterations iterations
+ //  - LBFGS: limited-memory BFGS over (weights, bias) with a backtracking
+ //    line search; stops early once the gradient or the loss change falls
+ //    below the tolerance
+ enum class LRSolver { GradientDescent, LBFGS };
  
  class LogisticRegression : public ModelInterface {
  public:
      LogisticRegression(int numFeatures = 0,
                         float learningRate = 0.01f,
-                        int maxIterations = 100);
+                        int maxIterations = 100,
+                        LRSolver solver = LRSolver::GradientDescent,
+                        float tolerance = 1e-5f);
      ~LogisticRegression() override = default;
  
      // ModelInterface methods
      void loadModel(const std::string& filename) override;
      int predict(const std::vector<float>& features) override;
+     void predictBatch(const float* X, int N, int D, int* out) override;
+     void predictProbaBatch(const float* X, int N, int D, float* out) override;
      std::unique_ptr<ModelInterface> clone() const override;
  
      // Batch operations
-     void train(const std::vector<float>& X,
-                const std::vector<int>& y,
+     void train(FloatSpan X,
+                LabelSpan y,
                 int numSamples,
                 int numFeatures);
      std::vector<int> predict(const std::vector<float>& X,
@@ -38,11 +53,34 @@
                                              int numSamples,
                                              int numFeatures);
      void saveModel(const std::string& filename);
+     int featureCount() const { return numFeatures; }
+ 
+     // Data-parallel training: train() is then called on every rank of comm
+     // with that rank's shard. The initial parameters come from rank 0 and
+     // each gradient and loss is summed over comm, so every rank takes the
+     // same steps on the full dataset's objective.
+     void setCommunicator(MPI_Comm comm);
+ 
+     // Gradients from data this object does not hold (e.g. shards scored on
+     // other ranks): given theta = [weights..., bias], a source returns the
+     // sums [gradient..., bias gradient, loss, sample count] over the whole
+     // training set, and train() then steps on those; X and y are unused.
+     using GradientSource = std::function<std::vector<double>(const std::vector<float>& theta)>;
+     void setGradientSource(GradientSource source);
+     // Those sums over numSamples rows at theta (also made the current
+     // parameters), for the ranks that serve a gradient source
+     std::vector<double> gradientSums(FloatSpan X,
+                                      LabelSpan y,
+                                      int numSamples,
+                                      int numFeatures,
+                                      const std::vector<float>& theta);
  
  private:
      int numFeatures;
      float learningRate;
      int maxIterations;
+     LRSolver solver;
+     float tolerance;
  
      // Model parameters
      std::vector<float> weights;
@@ -51,16 +89,42 @@
      // RNG
      std::mt19937 rng;
  
+     // MPI_COMM_NULL unless training data-parallel
+     MPI_Comm comm = MPI_COMM_NULL;
+     GradientSource gradientSource;
+ 
+     // Gradient of the last computeGradient call: numFeatures weight
+     // entries followed by the bias entry
+     std::vector<float> gradient;
+ 
+     // Per-thread accumulators, one cache-line padded slot per thread
+     // holding [gradient..., bias gradient, loss]
+     AlignedFloatVector gradientArena;
+     int arenaStride = 0;
+     int arenaThreads = 0;
+ 
      // Helpers
      float sigmoid(float x);
-     std::vector<float> computeGradient(const std::vector<float>& X,
-                                        const std::vector<int>& y,
-                                        int numSamples,
-                                        int numFeatures);
-     float computeLoss(const std::vector<float>& X,
-                       const std::vector<int>& y,
-                       int numSamples,
-                       int numFeatures);
+     void allocateGradientArena(int numThreads);
+     void broadcastParameters();
+     // Per-thread passes summed into the first arena slot, which then holds
+     // [gradient sums..., bias gradient sum, loss sum]; returns that slot
+     const float* accumulateGradient(FloatSpan X,
+                                     LabelSpan y,
+                                     int numSamples,
+                                     int numFeatures,
+                                     bool withLoss);
+     void trainLBFGS(FloatSpan X,
+                     LabelSpan y,
+                     int numSamples,
+                     int numFeatures);
+     // Fills `gradient`; with withLoss it also returns the mean loss at the
+     // current weights from the same pass (0 otherwise)
+     float computeGradient(FloatSpan X,
+                           LabelSpan y,
+                           int numSamples,
+                           int numFeatures,
+                           bool withLoss = false);
  };
  
  #endif // LOGISTIC_REGRESSION_H
\ No newline at end of file
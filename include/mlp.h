@@ -73,6 +73,8 @@
 #include <random>
 #include <memory>
 #include "evaluate.h"  // For ModelInterface
+#include "aligned_allocator.h"
+#include "data_span.h"
 
 /**
  * mlp.h - Definition of the Multilayer Perceptron (MLP) Neural Network
@@ -88,9 +90,15 @@ private:
     std::vector<int> hiddenSizes;
     int outputSize;
     
-    // Weights and biases
-    std::vector<std::vector<std::vector<float>>> weights; // [layer][neuron][input]
-    std::vector<std::vector<float>> biases;                // [layer][neuron]
+    std::vector<int> layerSizes;  // input, hidden..., output
+    
+    // Weights and biases. Each layer's weights are one 64-byte aligned
+    // row-major [neuron x input] buffer; weightsT optionally mirrors it as
+    // [input x neuron] so the backward pass reads contiguous rows.
+    std::vector<AlignedFloatVector> weights;   // [layer][neuron * inputs + input]
+    std::vector<AlignedFloatVector> weightsT;  // [layer][input * neurons + neuron]
+    bool useTransposedWeights = true;
+    std::vector<std::vector<float>> biases;    // [layer][neuron]
     
     // Activations and deltas for training
     std::vector<std::vector<float>> activations; // [layer][neuron]
@@ -99,6 +107,10 @@ private:
     // Random number generator
     std::mt19937 rng;
     
+    // Data-parallel training (setCommunicator); MPI_COMM_NULL otherwise
+    MPI_Comm comm = MPI_COMM_NULL;
+    int syncEvery = 1;
+    
     // Helper functions
     float sigmoid(float x);
     float sigmoidDerivative(float x);
@@ -106,22 +118,56 @@ private:
     void backwardPass(const std::vector<float>& input, const std::vector<float>& target);
     void updateWeights(const std::vector<float>& input, float learningRate);
     std::vector<float> oneHotEncode(int label, int numClasses);
+    void allocateLayers();
+    // Forward N rows with per-thread scratch; visit(i, outputs) runs per row.
+    // Throws std::invalid_argument unless D == inputSize
+    template <typename Visit>
+    void forwardBatch(const float* X, int N, int D, Visit visit) const;
+    void refreshTransposedWeights();
+    void trainMiniBatch(FloatSpan X, LabelSpan y,
+                        int numSamples, int numFeatures, int epochs, float learningRate, int batchSize);
+    // Every layer's weights then biases, as one flat buffer
+    void packParameters(std::vector<float>& buffer) const;
+    void unpackParameters(const float* buffer, float scale);
+    // Replace the parameters with their mean over comm
+    void averageParameters(std::vector<float>& buffer);
 
 public:
     MLP(int inputSize = 0, const std::vector<int>& hiddenSizes = {}, int outputSize = 0);
     ~MLP() override = default;
     
     // Original training and batch prediction methods
-    void train(const std::vector<float>& X, const std::vector<int>& y, 
-               int numSamples, int numFeatures, int epochs = 100, float learningRate = 0.01);
+    // batchSize > 1 switches from per-sample SGD to mini-batch gradient descent
+    void train(FloatSpan X, LabelSpan y, 
+               int numSamples, int numFeatures, int epochs = 100, float learningRate = 0.01,
+               int batchSize = 1);
     std::vector<int> predict(const std::vector<float>& X, int numSamples, int numFeatures);
     
+    // Keep a transposed weight copy for the per-sample backward pass
+    void setUseTransposedWeights(bool enabled);
+    
+    // Data-parallel training: train() is then called on every rank of comm
+    // with that rank's shard, and always runs mini-batches. All ranks start
+    // from rank 0's parameters. With syncEvery == 1 the batch gradients are
+    // summed over comm every step (synchronous SGD on a global batch of
+    // batchSize rows per rank); with syncEvery = k > 1 each rank takes k
+    // local steps and the parameters are then averaged.
+    void setCommunicator(MPI_Comm comm, int syncEvery = 1);
+    
+    // Every layer's weights then biases as one flat buffer, e.g. to move
+    // the model between ranks
+    void getParameters(std::vector<float>& buffer) const;
+    void setParameters(const std::vector<float>& buffer);
+    
     // Model saving methods (original)
     void saveModel(const std::string& filename);
     
     // Implementation of ModelInterface methods
     void loadModel(const std::string& path) override;
     int predict(const std::vector<float>& features) override; // Single sample prediction
+    void predictBatch(const float* X, int N, int D, int* out) override; // Row-major N x D batch
+    // Class 1 output normalized over the output units
+    void predictProbaBatch(const float* X, int N, int D, float* out) override;
 
     // Clone method for thread-safe evaluation
     std::unique_ptr<ModelInterface> clone() const override {
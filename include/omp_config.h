@@ -10,6 +10,7 @@
  
  #include <omp.h>
  #include <iostream>
+ #include <mutex>
  
  // Default to 5 threads unless overridden at compile time
  #ifndef OMP_NUM_THREADS
@@ -24,15 +25,18 @@
      // Explicitly set thread count regardless of environment
      omp_set_num_threads(OMP_NUM_THREADS);
      
-     // Verify thread count (debug only, can be removed in production)
-     #pragma omp parallel
-     {
-         #pragma omp master
+     // Verify thread count once per process, not once per model constructed
+     static std::once_flag reported;
+     std::call_once(reported, [] {
+         #pragma omp parallel
          {
-             std::cout << "OpenMP using " << omp_get_num_threads() 
-                       << " threads (max: " << omp_get_max_threads() << ")" << std::endl;
+             #pragma omp master
+             {
+                 std::cout << "OpenMP using " << omp_get_num_threads() 
+                           << " threads (max: " << omp_get_max_threads() << ")" << std::endl;
+             }
          }
-     }
+     });
  }
  
  #endif // OMP_CONFIG_H
\ No newline at end of file
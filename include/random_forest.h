@@ -7,8 +7,10 @@
 #include <random>
 #include <fstream>
 #include <utility>
+#include <cstdint>
 #include <omp.h>
 #include "evaluate.h"  // For ModelInterface
+#include "data_span.h"
 
 /**
  * random_forest.h - Definition of the Random Forest classifier
@@ -17,6 +19,71 @@
  * and integrates with the evaluation framework.
  */
 
+// Split-finding strategy used while growing trees
+enum class SplitMode {
+    Exhaustive,  // Try every sample value as a threshold (original behaviour)
+    Histogram,   // Score pre-binned features with per-bin class histograms
+    Presorted    // Exact thresholds from per-tree argsorted feature columns
+};
+
+// Feature matrix quantized once per forest for histogram split finding.
+// Bin edges are actual data values, so "bin <= b" is equivalent to
+// "x <= binEdges[f][b]" and trees keep using plain float thresholds.
+struct BinnedFeatures {
+    static constexpr int kMaxBins = 256;
+
+    int numSamples = 0;
+    int numFeatures = 0;
+    int numClasses = 0;
+    std::vector<uint8_t> bins;                 // [sample * numFeatures + feature]
+    std::vector<std::vector<float>> binEdges;  // [feature][bin] inclusive upper edge
+
+    void build(FloatSpan X,
+               LabelSpan y,
+               int numSamples,
+               int numFeatures,
+               int maxBins = kMaxBins);
+    // Collective over comm for row-sharded data: each rank passes its own
+    // rows and the edges are merged from every rank's local quantile edges
+    // (MPI_Allgatherv), so edges and numClasses are identical on all ranks
+    void buildDistributed(FloatSpan X,
+                          LabelSpan y,
+                          int numSamples,
+                          int numFeatures,
+                          MPI_Comm comm,
+                          int maxBins = kMaxBins);
+
+    // Incremental build for rows that arrive in chunks: addChunk sorts each
+    // chunk's columns while later chunks are still on their way, and
+    // finish(X) merges them and bins X, which must hold every added row in
+    // order. The result is the same as build() over all the rows.
+    void addChunk(const float* X, const int* y, int rows, int numFeatures);
+    void finish(FloatSpan X, int maxBins = kMaxBins);
+
+private:
+    void binColumns(FloatSpan X);
+
+    // Sorted runs of each feature column from addChunk, [feature][run];
+    // run sizes shrink towards the back, so merging stays n log n
+    std::vector<std::vector<std::vector<float>>> sortedRuns;
+};
+
+// Single-file forest layout written by RandomForest::saveModel:
+//   ForestHeader, then numTrees DecisionTree::serialize records back to back
+constexpr char FOREST_MAGIC[8] = {'L', 'O', 'A', 'N', 'R', 'F', '\0', '\0'};
+constexpr uint32_t FOREST_VERSION = 1;
+
+#pragma pack(push, 1)
+struct ForestHeader {
+    char magic[8];
+    uint32_t version;
+    int32_t numTrees;
+    int32_t maxDepth;
+    int32_t minSamplesLeaf;
+    int32_t numFeatures;
+};
+#pragma pack(pop)
+
 // Tree node for classification
 class Node {
 public:
@@ -26,46 +93,113 @@ public:
     int classLabel = -1;
     Node* left = nullptr;
     Node* right = nullptr;
+
+    ~Node() {
+        delete left;
+        delete right;
+    }
 };
 
+// Flattened node used for inference. Nodes are laid out in preorder, so a
+// split's left child is always the next entry and only the right child
+// index is stored; a whole node fits in 16 bytes.
+struct FlatNode {
+    int32_t featureIndex;  // -1 for leaves
+    float threshold;
+    uint32_t rightChild;
+    int32_t classLabel;
+};
+static_assert(sizeof(FlatNode) == 16, "FlatNode should stay 16 bytes");
+
 // Single decision tree
 class DecisionTree {
 public:
     DecisionTree(int maxDepth, int minSamplesLeaf, int numFeatures, unsigned int seed);
     ~DecisionTree();
 
-    void train(const std::vector<float>& X,
-               const std::vector<int>& y,
+    void train(FloatSpan X,
+               LabelSpan y,
                int numSamples,
-               int numFeatures);
+               int numFeatures,
+               SplitMode splitMode = SplitMode::Exhaustive,
+               const BinnedFeatures* binned = nullptr);
+    // Collective over comm: grow one tree over the rows of every rank.
+    // binned comes from BinnedFeatures::buildDistributed on the same comm;
+    // each rank only reads its own rows and the node histograms are summed
+    // with MPI_Allreduce, so all ranks pick the same splits and end up with
+    // the same tree. Every rank must construct the tree with the same seed.
+    void trainDistributed(LabelSpan y,
+                          int numSamples,
+                          const BinnedFeatures& binned,
+                          MPI_Comm comm);
     int predict(const std::vector<float>& x);
+    int predict(const float* x) const;
+    int predictPointerWalk(const std::vector<float>& x);  // Reference path for benchmarks
     void saveTree(const std::string& filename);
     void loadTree(const std::string& filename);
+    // Preorder node records; self-delimiting, so trees can be concatenated.
+    // deserialize throws std::runtime_error on truncated input.
+    void serialize(std::ostream& out) const;
+    void deserialize(std::istream& in);
 
 private:
     Node* root;
+    std::vector<FlatNode> flatNodes;  // Rebuilt from root after train/load
     int maxDepth;
     int minSamplesLeaf;
     int numFeatures;
     int mtry;
     std::mt19937 rng;
+    const BinnedFeatures* binned = nullptr;  // Only set while training in histogram mode
 
-    Node* buildTree(const std::vector<float>& X,
-                    const std::vector<int>& y,
+    // Presorted mode: per-feature sample indices ordered by feature value.
+    // Each node owns the range [begin, end) of every list; children get
+    // stable partitions of that range, so the lists stay sorted.
+    std::vector<std::vector<int>> sortedIndices;  // [feature][position]
+    std::vector<int> partitionBuffer;
+    int numClasses = 0;
+
+    Node* buildTree(FloatSpan X,
+                    LabelSpan y,
                     const std::vector<int>& sampleIndices,
                     int depth);
-    std::pair<int, float> findBestSplit(const std::vector<float>& X,
-                                        const std::vector<int>& y,
+    std::pair<int, float> findBestSplit(FloatSpan X,
+                                        LabelSpan y,
                                         const std::vector<int>& sampleIndices,
                                         const std::vector<int>& featureIndices);
-    float calculateGini(const std::vector<int>& y,
+    std::pair<int, float> findBestSplitHistogram(LabelSpan y,
+                                                 const std::vector<int>& sampleIndices,
+                                                 const std::vector<int>& featureIndices);
+    int scanHistogram(const int* histogram,
+                      int numBins,
+                      int numClasses,
+                      const int* totalCounts,
+                      size_t n,
+                      float& bestGini) const;
+    Node* buildTreeDistributed(LabelSpan y,
+                               const std::vector<int>& sampleIndices,
+                               int depth,
+                               MPI_Comm comm);
+    Node* buildTreePresorted(FloatSpan X,
+                             LabelSpan y,
+                             int begin,
+                             int end,
+                             int depth);
+    std::pair<int, float> findBestSplitPresorted(FloatSpan X,
+                                                 LabelSpan y,
+                                                 int begin,
+                                                 int end,
+                                                 const std::vector<int>& featureIndices);
+    float calculateGini(LabelSpan y,
                         const std::vector<int>& sampleIndices);
     void predict(const std::vector<float>& x,
                  Node* node,
                  int& prediction);
-    void saveTreeRecursive(Node* node,
-                           std::ofstream& file);
-    Node* loadTreeRecursive(std::ifstream& file);
+    void flatten();
+    void flattenRecursive(Node* node);
+    void saveTreeRecursive(const Node* node,
+                           std::ostream& file) const;
+    Node* loadTreeRecursive(std::istream& file);
 };
 
 // Random forest ensemble
@@ -74,22 +208,54 @@ public:
     RandomForest(int numTrees = 10,
                  int maxDepth = 5,
                  int minSamplesLeaf = 1,
-                 int numFeatures = 0);
+                 int numFeatures = 0,
+                 SplitMode splitMode = SplitMode::Exhaustive);
     ~RandomForest() override;
 
-    // Load and save
+    // Load and save. saveModel writes one forest file at path; loadModel
+    // reads it, or the older layout of prefix_meta.txt plus one
+    // prefix_tree_<i>.bin per tree, and throws std::runtime_error if
+    // neither is there
     void loadModel(const std::string& path) override;
-    void saveModel(const std::string& prefix);
-    void loadModel(const std::string& prefix, int numTrees);
+    void saveModel(const std::string& path);
+    void loadModel(const std::string& prefix, int numTrees);  // numTrees <= 0 uses the stored count
 
     // Training
-    void train(const std::vector<float>& X,
-               const std::vector<int>& y,
+    // prebinned, when given, replaces the forest's own binning in histogram
+    // mode and must have been built from the same rows
+    void train(FloatSpan X,
+               LabelSpan y,
                int numSamples,
-               int numFeatures);
+               int numFeatures,
+               const BinnedFeatures* prebinned = nullptr);
+    // Collective over comm for row-sharded data: every rank passes its own
+    // rows and all numTrees trees are grown over the rows of every rank with
+    // DecisionTree::trainDistributed (histogram splits whatever the split
+    // mode), so each rank ends up holding the same forest
+    void trainDistributed(FloatSpan X,
+                          LabelSpan y,
+                          int numSamples,
+                          int numFeatures,
+                          MPI_Comm comm);
+    // Tree i is grown from seed + i (default: seeded from the clock)
+    void setSeed(unsigned int seed);
+    // Distributed training: this forest's numTrees trees are trees
+    // [firstTree, firstTree + numTrees) of a forest of totalTrees grown on
+    // several ranks, seeded by their global index
+    void setForestSlice(int firstTree, int totalTrees);
+    // Collective over comm: serialize every rank's trees and MPI_Gatherv
+    // them to root, whose forest then holds all of them in rank order
+    void gatherForest(MPI_Comm comm, int root = 0);
+    int treeCount() const { return static_cast<int>(trees.size()); }
+    // Replace the forest with trees grown elsewhere (e.g. by other ranks)
+    void setTrees(std::vector<std::shared_ptr<DecisionTree>> trees);
 
     // Single-sample API
     int predict(const std::vector<float>& features) override;
+    int predict(const float* features) const;
+    int predictPointerWalk(const std::vector<float>& features);  // Reference path for benchmarks
+    void predictBatch(const float* X, int N, int D, int* out) override;
+    void predictProbaBatch(const float* X, int N, int D, float* out) override;  // Share of trees voting 1
     std::unique_ptr<ModelInterface> clone() const override;
 
 private:
@@ -98,7 +264,14 @@ private:
     int maxDepth;
     int minSamplesLeaf;
     int numFeatures;
+    SplitMode splitMode;
     std::string modelPath;
+    int firstTree = 0;
+    int totalTrees;
+    bool hasSeed = false;
+    unsigned int seed = 0;
+
+    bool loadForestFile(const std::string& path);
 };
 
 #endif // RANDOM_FOREST_H
\ No newline at end of file
@@ -0,0 +1,47 @@
+/**
+ * scoring_server.h - Long-running request loop for ml_predictor
+ *
+ * Requests are newline-delimited text, one application per line:
+ *
+ *   income,credit_score,loan_amount,dti_ratio,employment_status
+ *
+ * and every request gets one response line, in request order per client:
+ *
+ *   outcome,rf_vote,mlp_vote,lr_vote,risk_score
+ *
+ * with outcome one of approved, borderline, rejected or unavailable, votes
+ * 1 (approve), 0 (reject) or -1 (model not loaded) and the risk score on a
+ * 0-100 scale (-1 when no model provides one). A malformed request is
+ * answered with "error,<reason>"; blank lines are ignored. The line "stats"
+ * is answered with the scheduler's counters, which include every request
+ * answered before it:
+ *
+ *   stats,requests,batches,mean_batch,p50_us,p99_us
+ *
+ * The loop polls every input and hands each request to a BatchScheduler,
+ * which scores requests from all clients together once maxBatch are queued
+ * or the oldest has waited the batching deadline; responses are written as
+ * their batches complete.
+ */
+
+ #ifndef SCORING_SERVER_H
+ #define SCORING_SERVER_H
+
+ #include <string>
+ #include "loan_scorer.h"
+ #include "batch_scheduler.h"
+
+ struct ServerOptions {
+     SchedulerOptions batching;  // Batch size and deadline for the models
+ };
+
+ // Serve requests read from inFd and answer on outFd until inFd reaches EOF
+ // (e.g. ml_predictor --serve on a stdin/stdout pipe)
+ void serveStream(LoanScorer& scorer, int inFd, int outFd, const ServerOptions& options);
+
+ // Listen on a Unix domain socket at path until SIGINT or SIGTERM; any
+ // number of clients may connect. Throws std::runtime_error if the socket
+ // cannot be created.
+ void serveSocket(LoanScorer& scorer, const std::string& path, const ServerOptions& options);
+
+ #endif // SCORING_SERVER_H
@@ -0,0 +1,46 @@
+/**
+ * simd_kernels.h - Vectorized math kernels shared by the models
+ *
+ * Small set of float kernels used by LogisticRegression and MLP. The
+ * implementation is picked once at runtime from the CPU: AVX-512F,
+ * AVX2+FMA, or a portable scalar fallback. Setting the environment
+ * variable ML_SIMD=scalar|avx2|avx512 caps the selection, which is handy
+ * for comparing paths.
+ *
+ * Accuracy: the SIMD paths evaluate exp with a degree-6 polynomial after
+ * range reduction (Cephes expf). The vector sigmoid stays within
+ * SIGMOID_MAX_ULP of the scalar 1 / (1 + std::exp(-x)) for x in
+ * [-SIGMOID_ACCURATE_RANGE, SIGMOID_ACCURATE_RANGE]; outside that range it
+ * saturates towards 0 or 1. Dot products and logits sum in a different
+ * order than a plain loop, so they agree with it to rounding only.
+ */
+
+ #ifndef SIMD_KERNELS_H
+ #define SIMD_KERNELS_H
+
+ namespace kernels {
+
+ constexpr int SIGMOID_MAX_ULP = 4;
+ constexpr float SIGMOID_ACCURATE_RANGE = 80.0f;
+
+ // Name of the selected implementation: "avx512", "avx2" or "scalar"
+ const char* activeIsa();
+
+ // Scalar reference sigmoid, 1 / (1 + exp(-x))
+ float sigmoid(float x);
+
+ // out[i] = sigmoid(x[i]); x and out may alias
+ void sigmoid(const float* x, float* out, int n);
+
+ // sum(a[i] * b[i])
+ float dot(const float* a, const float* b, int n);
+
+ // y[i] += alpha * x[i]
+ void axpy(float alpha, const float* x, float* y, int n);
+
+ // out[i] = bias + dot(X[i, :], w) for a row-major N x D matrix
+ void logits(const float* X, int N, int D, const float* w, float bias, float* out);
+
+ } // namespace kernels
+
+ #endif // SIMD_KERNELS_H
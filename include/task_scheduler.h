@@ -0,0 +1,95 @@
+/**
+ * task_scheduler.h - Dynamic master/worker task scheduling over MPI
+ *
+ * Rank 0 of the communicator is the master. It queues tasks (a kind, a
+ * priority and an opaque byte payload) and hands each one to whichever
+ * worker rank is free; every other rank runs serve(), executing tasks with
+ * the executor all ranks share until the master shuts down. Higher
+ * priorities go first, so tasks on a long dependency chain can jump ahead
+ * of independent filler work.
+ *
+ * A worker is kept tasksInFlight tasks ahead, so its next task has already
+ * arrived when it finishes one. Tasks and results travel with MPI_Isend,
+ * and neither side waits for the other to receive. When every worker is
+ * full the master runs a queued task itself. Completion callbacks run on
+ * the master inside runUntil() and may submit further tasks.
+ */
+
+ #ifndef TASK_SCHEDULER_H
+ #define TASK_SCHEDULER_H
+
+ #include <mpi.h>
+ #include <cstdint>
+ #include <deque>
+ #include <functional>
+ #include <map>
+ #include <unordered_map>
+ #include <utility>
+ #include <vector>
+
+ class TaskScheduler {
+ public:
+     using Payload = std::vector<char>;
+     using Executor = std::function<Payload(int kind, const Payload& input)>;
+     using Completion = std::function<void(Payload&& result)>;
+
+     // Collective over comm
+     TaskScheduler(MPI_Comm comm, Executor execute, int tasksInFlight = 2);
+     // The master shuts the workers down if shutdown() was not called
+     ~TaskScheduler();
+
+     TaskScheduler(const TaskScheduler&) = delete;
+     TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+     bool isMaster() const { return rank == 0; }
+
+     // Workers: run tasks until the master shuts down
+     void serve();
+
+     // Master only. Queue a task; equal priorities run in submission order.
+     void submit(int kind, int priority, Payload input, Completion onDone);
+     // Master only. Hand out tasks and run completions until done() holds;
+     // throws std::logic_error if nothing is left to run before that
+     void runUntil(const std::function<bool()>& done);
+     // Master only. Stop the workers; every task must have completed
+     void shutdown();
+
+     // Tasks completed by each rank so far (master only)
+     const std::vector<int>& tasksRun() const { return completedByRank; }
+
+ private:
+     struct Queued {
+         int kind;
+         Payload input;
+         Completion onDone;
+     };
+
+     // Isend buffers live until the send completes
+     struct PendingSend {
+         MPI_Request request;
+         Payload message;
+     };
+
+     bool dispatch();
+     bool receiveResult(bool wait);
+     void runLocally();
+     void reapSends(bool wait);
+
+     MPI_Comm comm;
+     Executor execute;
+     int tasksInFlight;
+     int rank = 0;
+     int worldSize = 1;
+     bool stopped = false;
+
+     // Master state; the queue is ordered by (-priority, submission)
+     std::map<std::pair<int, uint64_t>, Queued> queue;
+     uint64_t submitted = 0;
+     int32_t nextTaskId = 0;
+     std::unordered_map<int32_t, Completion> running;
+     std::vector<int> inFlight;
+     std::vector<int> completedByRank;
+     std::deque<PendingSend> sends;
+ };
+
+ #endif // TASK_SCHEDULER_H
@@ -0,0 +1,124 @@
+/**
+ * batch_scheduler.cpp - Micro-batching front end for LoanScorer
+ */
+
+ #include "./include/batch_scheduler.h"
+ #include <algorithm>
+ #include <exception>
+ #include <vector>
+
+ static SchedulerOptions validated(SchedulerOptions options) {
+     options.maxBatch = std::max(1, options.maxBatch);
+     options.deadline = std::max(options.deadline, std::chrono::microseconds(0));
+     return options;
+ }
+
+ BatchScheduler::BatchScheduler(LoanScorer& scorer, const SchedulerOptions& options,
+                                std::function<void()> onBatchDone)
+     : scorer(scorer), options(validated(options)), onBatchDone(std::move(onBatchDone)),
+       worker(&BatchScheduler::run, this) {}
+
+ BatchScheduler::~BatchScheduler() {
+     {
+         std::lock_guard<std::mutex> lock(mutex);
+         stopping = true;
+     }
+     wake.notify_one();
+     worker.join();
+ }
+
+ std::future<LoanDecision> BatchScheduler::submit(const float* features) {
+     Pending pending;
+     std::copy(features, features + LOAN_FEATURES, pending.features);
+     pending.submitted = Clock::now();
+     std::future<LoanDecision> result = pending.promise.get_future();
+
+     size_t queued;
+     {
+         std::lock_guard<std::mutex> lock(mutex);
+         queue.push_back(std::move(pending));
+         queued = queue.size();
+     }
+     // The worker only needs waking to start a deadline or to cut a batch
+     if (queued == 1 || queued == static_cast<size_t>(options.maxBatch)) {
+         wake.notify_one();
+     }
+     return result;
+ }
+
+ void BatchScheduler::run() {
+     std::vector<Pending> batch;
+     std::vector<float> raw;
+
+     while (true) {
+         {
+             std::unique_lock<std::mutex> lock(mutex);
+             wake.wait(lock, [this] { return stopping || !queue.empty(); });
+             if (queue.empty()) {
+                 return;   // Stopping and drained
+             }
+
+             // Wait for a full batch, but no longer than the oldest request's deadline
+             const Clock::time_point due = queue.front().submitted + options.deadline;
+             wake.wait_until(lock, due, [this] {
+                 return stopping || queue.size() >= static_cast<size_t>(options.maxBatch);
+             });
+
+             const size_t n = std::min(queue.size(), static_cast<size_t>(options.maxBatch));
+             batch.clear();
+             for (size_t i = 0; i < n; ++i) {
+                 batch.push_back(std::move(queue.front()));
+                 queue.pop_front();
+             }
+         }
+
+         raw.clear();
+         for (const Pending& pending : batch) {
+             raw.insert(raw.end(), pending.features, pending.features + LOAN_FEATURES);
+         }
+
+         std::vector<LoanDecision> decisions;
+         std::exception_ptr failure;
+         try {
+             decisions = scorer.scoreBatch(raw.data(), static_cast<int>(batch.size()));
+         } catch (...) {
+             failure = std::current_exception();
+         }
+
+         // Count the batch before any caller can see its results, so stats()
+         // already includes every request whose future is ready
+         const Clock::time_point done = Clock::now();
+         {
+             std::lock_guard<std::mutex> lock(statsMutex);
+             ++batches;
+             for (const Pending& pending : batch) {
+                 latencyMicros.add(std::chrono::duration<double, std::micro>(done - pending.submitted).count());
+             }
+         }
+         for (size_t i = 0; i < batch.size(); ++i) {
+             if (failure) {
+                 batch[i].promise.set_exception(failure);
+             } else {
+                 batch[i].promise.set_value(decisions[i]);
+             }
+         }
+
+         if (onBatchDone) {
+             onBatchDone();
+         }
+     }
+ }
+
+ SchedulerStats BatchScheduler::stats() const {
+     std::lock_guard<std::mutex> lock(statsMutex);
+     SchedulerStats s;
+     s.requests = latencyMicros.count();
+     s.batches = batches;
+     if (s.requests > 0) {
+         s.meanBatch = static_cast<double>(s.requests) / batches;
+         s.p50Micros = latencyMicros.quantile(0.5);
+         s.p99Micros = latencyMicros.quantile(0.99);
+         s.maxMicros = latencyMicros.max();
+     }
+     return s;
+ }
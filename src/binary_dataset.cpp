@@ -0,0 +1,366 @@
+/**
+ * binary_dataset.cpp - Reader and writer for the binary columnar dataset format
+ */
+
+ #include "./include/binary_dataset.h"
+ #include <fstream>
+ #include <sstream>
+ #include <algorithm>
+ #include <stdexcept>
+ #include <cstring>
+ #include <cerrno>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <fcntl.h>
+ #include <unistd.h>
+
+ namespace binary_dataset {
+
+ static uint64_t alignUp(uint64_t value) {
+     return (value + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+ }
+
+ // Column value i as float, whatever the stored 4-byte type
+ static float columnValue(const void* data, ColumnType type, size_t i) {
+     if (type == ColumnType::Int32) {
+         int32_t v;
+         std::memcpy(&v, static_cast<const char*>(data) + i * sizeof(v), sizeof(v));
+         return static_cast<float>(v);
+     }
+     float v;
+     std::memcpy(&v, static_cast<const char*>(data) + i * sizeof(v), sizeof(v));
+     return v;
+ }
+
+ // Column value i as an integer label
+ static int labelValue(const void* data, ColumnType type, size_t i) {
+     if (type == ColumnType::Int32) {
+         int32_t v;
+         std::memcpy(&v, static_cast<const char*>(data) + i * sizeof(v), sizeof(v));
+         return v;
+     }
+     return static_cast<int>(columnValue(data, type, i));
+ }
+
+ uint64_t paddedColumnBytes(uint64_t numRows) {
+     return alignUp(numRows * sizeof(float));
+ }
+
+ bool isBinaryDataset(const std::string& filename) {
+     std::ifstream file(filename, std::ios::binary);
+     char magic[sizeof(MAGIC)] = {};
+     file.read(magic, sizeof(magic));
+     return file && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+ }
+
+ DatasetWriter::DatasetWriter(const std::string& filename,
+                              const std::vector<ColumnSpec>& columns,
+                              uint64_t numRows,
+                              int labelColumn,
+                              bool withRowMajorFeatures)
+     : filename(filename), file(filename, std::ios::binary), numRows(numRows), labelColumn(labelColumn) {
+     if (!file.is_open()) {
+         throw std::runtime_error("Could not open output file: " + filename);
+     }
+
+     // Descriptors sit right after the fixed header; data starts at the
+     // next 64-byte boundary
+     uint64_t descriptorBytes = 0;
+     for (const auto& column : columns) {
+         descriptorBytes += 2 * sizeof(uint32_t) + column.name.size();
+         types.push_back(column.type);
+     }
+
+     FileHeader header{};
+     std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+     header.version = VERSION;
+     header.numColumns = static_cast<uint32_t>(columns.size());
+     header.numRows = numRows;
+     header.labelColumn = labelColumn;
+     header.flags = withRowMajorFeatures ? FLAG_ROW_MAJOR_FEATURES : 0;
+     header.dataOffset = alignUp(sizeof(FileHeader) + descriptorBytes);
+     file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+     for (const auto& column : columns) {
+         uint32_t type = static_cast<uint32_t>(column.type);
+         uint32_t nameLength = static_cast<uint32_t>(column.name.size());
+         file.write(reinterpret_cast<const char*>(&type), sizeof(type));
+         file.write(reinterpret_cast<const char*>(&nameLength), sizeof(nameLength));
+         file.write(column.name.data(), nameLength);
+     }
+
+     const std::vector<char> zeros(ALIGNMENT, 0);
+     file.write(zeros.data(), header.dataOffset - sizeof(FileHeader) - descriptorBytes);
+
+     dataOffset = header.dataOffset;
+     if (withRowMajorFeatures) {
+         rowMajorOffset = dataOffset + columns.size() * paddedColumnBytes(numRows);
+     }
+ }
+
+ void DatasetWriter::append(const std::vector<const void*>& columnData, uint64_t rows) {
+     if (columnData.size() != types.size()) {
+         throw std::runtime_error("Column count mismatch writing " + filename);
+     }
+     if (rowsWritten + rows > numRows) {
+         throw std::runtime_error("More rows than declared written to " + filename);
+     }
+
+     const uint64_t columnBytes = paddedColumnBytes(numRows);
+     for (size_t c = 0; c < types.size(); ++c) {
+         file.seekp(dataOffset + c * columnBytes + rowsWritten * sizeof(float));
+         file.write(static_cast<const char*>(columnData[c]), rows * sizeof(float));
+     }
+
+     // Row-major feature matrix for these rows
+     if (rowMajorOffset != 0) {
+         const size_t D = types.size() - (labelColumn >= 0 ? 1 : 0);
+         block.resize(rows * D);
+         for (uint64_t i = 0; i < rows; ++i) {
+             size_t f = 0;
+             for (size_t c = 0; c < types.size(); ++c) {
+                 if (static_cast<int>(c) != labelColumn) {
+                     block[i * D + f++] = columnValue(columnData[c], types[c], i);
+                 }
+             }
+         }
+         file.seekp(rowMajorOffset + rowsWritten * D * sizeof(float));
+         file.write(reinterpret_cast<const char*>(block.data()), block.size() * sizeof(float));
+     }
+
+     rowsWritten += rows;
+     if (!file) {
+         throw std::runtime_error("Failed writing binary dataset: " + filename);
+     }
+ }
+
+ void DatasetWriter::finish() {
+     if (rowsWritten != numRows) {
+         throw std::runtime_error("Expected " + std::to_string(numRows) + " rows but wrote " +
+                                  std::to_string(rowsWritten) + " to " + filename);
+     }
+
+     // Zero the tail of every column up to its 64-byte boundary
+     const std::vector<char> zeros(ALIGNMENT, 0);
+     const uint64_t columnBytes = paddedColumnBytes(numRows);
+     const uint64_t padding = columnBytes - numRows * sizeof(float);
+     for (size_t c = 0; c < types.size(); ++c) {
+         file.seekp(dataOffset + c * columnBytes + numRows * sizeof(float));
+         file.write(zeros.data(), padding);
+     }
+     file.flush();
+     if (!file) {
+         throw std::runtime_error("Failed writing binary dataset: " + filename);
+     }
+ }
+
+ void writeDataset(const std::string& filename,
+                   const std::vector<ColumnSource>& columns,
+                   uint64_t numRows,
+                   int labelColumn,
+                   bool withRowMajorFeatures) {
+     std::vector<ColumnSpec> specs;
+     std::vector<const void*> data;
+     for (const auto& column : columns) {
+         specs.push_back({column.name, column.type});
+         data.push_back(column.data);
+     }
+
+     // Whole dataset as one chunk, written a block of rows at a time so the
+     // row-major staging stays small
+     DatasetWriter writer(filename, specs, numRows, labelColumn, withRowMajorFeatures);
+     const uint64_t blockRows = 4096;
+     for (uint64_t start = 0; start < numRows; start += blockRows) {
+         const uint64_t rows = std::min(blockRows, numRows - start);
+         std::vector<const void*> blockData;
+         for (const void* column : data) {
+             blockData.push_back(static_cast<const char*>(column) + start * sizeof(float));
+         }
+         writer.append(blockData, rows);
+     }
+     writer.finish();
+ }
+
+ // Parse the header from the first bytes of a file of fileSize bytes
+ static DatasetInfo parseInfo(std::istream& in, uint64_t fileSize, const std::string& filename) {
+     FileHeader header{};
+     in.read(reinterpret_cast<char*>(&header), sizeof(header));
+     if (!in || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+         throw std::runtime_error("Not a binary dataset file: " + filename);
+     }
+     if (header.version != VERSION) {
+         throw std::runtime_error("Unsupported binary dataset version " + std::to_string(header.version) +
+                                  " in " + filename);
+     }
+
+     DatasetInfo info;
+     info.numRows = header.numRows;
+     info.labelColumn = header.labelColumn;
+     info.dataOffset = header.dataOffset;
+     info.columns.resize(header.numColumns);
+
+     const uint64_t columnBytes = paddedColumnBytes(header.numRows);
+     for (uint32_t c = 0; c < header.numColumns; ++c) {
+         uint32_t type = 0, nameLength = 0;
+         in.read(reinterpret_cast<char*>(&type), sizeof(type));
+         in.read(reinterpret_cast<char*>(&nameLength), sizeof(nameLength));
+         if (!in || type > static_cast<uint32_t>(ColumnType::Int32) || nameLength > header.dataOffset) {
+             throw std::runtime_error("Corrupt column descriptor in " + filename);
+         }
+         info.columns[c].name.resize(nameLength);
+         in.read(&info.columns[c].name[0], nameLength);
+         info.columns[c].type = static_cast<ColumnType>(type);
+         info.columns[c].offset = header.dataOffset + c * columnBytes;
+     }
+     if (!in) {
+         throw std::runtime_error("Truncated header in " + filename);
+     }
+     if (info.labelColumn >= static_cast<int>(header.numColumns)) {
+         throw std::runtime_error("Label column out of range in " + filename);
+     }
+
+     // The data sections must be complete
+     uint64_t expectedSize = header.dataOffset + header.numColumns * columnBytes;
+     if (header.flags & FLAG_ROW_MAJOR_FEATURES) {
+         info.rowMajorOffset = expectedSize;
+         expectedSize += header.numRows * info.numFeatures() * sizeof(float);
+     }
+     if (fileSize < expectedSize) {
+         throw std::runtime_error("Truncated column data in " + filename);
+     }
+
+     return info;
+ }
+
+ DatasetInfo readInfo(const std::string& filename) {
+     std::ifstream file(filename, std::ios::binary | std::ios::ate);
+     if (!file.is_open()) {
+         throw std::runtime_error("Could not open dataset file: " + filename);
+     }
+     uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+     file.seekg(0);
+     return parseInfo(file, fileSize, filename);
+ }
+
+ void loadDataset(const std::string& filename,
+                  std::vector<float>& X,
+                  std::vector<int>& y,
+                  int& N,
+                  int& D) {
+     DatasetInfo info = readInfo(filename);
+     std::ifstream file(filename, std::ios::binary);
+
+     N = static_cast<int>(info.numRows);
+     D = info.numFeatures();
+     X.resize(static_cast<size_t>(N) * D);
+     y.assign(N, 0);
+
+     std::vector<uint32_t> raw(N);
+     if (info.labelColumn >= 0) {
+         const ColumnInfo& label = info.columns[info.labelColumn];
+         file.seekg(label.offset);
+         file.read(reinterpret_cast<char*>(raw.data()), static_cast<std::streamsize>(N) * sizeof(uint32_t));
+         for (int i = 0; i < N; ++i) {
+             y[i] = labelValue(raw.data(), label.type, i);
+         }
+     }
+
+     // The row-major copy is a single read; otherwise scatter the columns
+     if (info.rowMajorOffset != 0) {
+         file.seekg(info.rowMajorOffset);
+         file.read(reinterpret_cast<char*>(X.data()), static_cast<std::streamsize>(X.size()) * sizeof(float));
+     } else {
+         int feature = 0;
+         for (int c = 0; c < static_cast<int>(info.columns.size()); ++c) {
+             if (c == info.labelColumn) {
+                 continue;
+             }
+             const ColumnInfo& column = info.columns[c];
+             file.seekg(column.offset);
+             file.read(reinterpret_cast<char*>(raw.data()), static_cast<std::streamsize>(N) * sizeof(uint32_t));
+             for (int i = 0; i < N; ++i) {
+                 X[static_cast<size_t>(i) * D + feature] = columnValue(raw.data(), column.type, i);
+             }
+             ++feature;
+         }
+     }
+
+     if (!file) {
+         throw std::runtime_error("Failed reading binary dataset: " + filename);
+     }
+ }
+
+ MappedDataset::MappedDataset(const std::string& filename) {
+     int fd = ::open(filename.c_str(), O_RDONLY);
+     if (fd < 0) {
+         throw std::runtime_error("Could not open dataset file: " + filename + " (" + std::strerror(errno) + ")");
+     }
+     struct stat st;
+     if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+         ::close(fd);
+         throw std::runtime_error("Could not stat dataset file: " + filename);
+     }
+     mappingSize = static_cast<size_t>(st.st_size);
+     mapping = ::mmap(nullptr, mappingSize, PROT_READ, MAP_SHARED, fd, 0);
+     ::close(fd);
+     if (mapping == MAP_FAILED) {
+         mapping = nullptr;
+         throw std::runtime_error("Could not map dataset file: " + filename + " (" + std::strerror(errno) + ")");
+     }
+
+     const char* base = static_cast<const char*>(mapping);
+     try {
+         // Descriptors end before dataOffset; parse that prefix as a stream
+         FileHeader peek{};
+         std::memcpy(&peek, base, std::min(sizeof(peek), mappingSize));
+         size_t headerSize = std::min<uint64_t>(mappingSize, std::max<uint64_t>(sizeof(peek), peek.dataOffset));
+         std::istringstream in(std::string(base, headerSize));
+         header = parseInfo(in, mappingSize, filename);
+     } catch (...) {
+         ::munmap(mapping, mappingSize);
+         throw;
+     }
+
+     const size_t N = header.numRows;
+     const size_t D = header.numFeatures();
+
+     if (header.rowMajorOffset != 0) {
+         featureView = FloatSpan(reinterpret_cast<const float*>(base + header.rowMajorOffset), N * D);
+     } else {
+         ownedFeatures.resize(N * D);
+         size_t feature = 0;
+         for (int c = 0; c < static_cast<int>(header.columns.size()); ++c) {
+             if (c == header.labelColumn) {
+                 continue;
+             }
+             const ColumnInfo& column = header.columns[c];
+             for (size_t i = 0; i < N; ++i) {
+                 ownedFeatures[i * D + feature] = columnValue(base + column.offset, column.type, i);
+             }
+             ++feature;
+         }
+         featureView = FloatSpan(ownedFeatures);
+     }
+
+     if (header.labelColumn >= 0 && header.columns[header.labelColumn].type == ColumnType::Int32) {
+         const ColumnInfo& label = header.columns[header.labelColumn];
+         labelView = LabelSpan(reinterpret_cast<const int*>(base + label.offset), N);
+     } else {
+         ownedLabels.assign(N, 0);
+         if (header.labelColumn >= 0) {
+             const ColumnInfo& label = header.columns[header.labelColumn];
+             for (size_t i = 0; i < N; ++i) {
+                 ownedLabels[i] = labelValue(base + label.offset, label.type, i);
+             }
+         }
+         labelView = LabelSpan(ownedLabels);
+     }
+ }
+
+ MappedDataset::~MappedDataset() {
+     if (mapping) {
+         ::munmap(mapping, mappingSize);
+     }
+ }
+
+ } // namespace binary_dataset
@@ -0,0 +1,136 @@
+/**
+ * column_stats.cpp - Mergeable per-column summary statistics
+ */
+
+ #include "./include/column_stats.h"
+ #include <algorithm>
+ #include <cmath>
+ #include <utility>
+
+ namespace column_stats {
+
+ void QuantileSketch::Buckets::grow(int64_t k) {
+     if (counts.empty()) {
+         first = k;
+         counts.assign(1, 0);
+         return;
+     }
+     const int64_t last = first + static_cast<int64_t>(counts.size()) - 1;
+     const int64_t newFirst = std::min(first, k);
+     const int64_t newLast = std::max(last, k);
+     std::vector<uint64_t> grown(newLast - newFirst + 1, 0);
+     std::copy(counts.begin(), counts.end(), grown.begin() + (first - newFirst));
+     counts.swap(grown);
+     first = newFirst;
+ }
+
+ double QuantileSketch::bucketValue(int64_t k) {
+     const uint64_t lowBits = static_cast<uint64_t>(k) << (52 - SKETCH_MANTISSA_BITS);
+     const uint64_t highBits = static_cast<uint64_t>(k + 1) << (52 - SKETCH_MANTISSA_BITS);
+     double low, high;
+     std::memcpy(&low, &lowBits, sizeof(low));
+     std::memcpy(&high, &highBits, sizeof(high));
+     return 0.5 * (low + high);
+ }
+
+ void QuantileSketch::merge(const QuantileSketch& other) {
+     for (auto side : {std::make_pair(&positive, &other.positive), std::make_pair(&negative, &other.negative)}) {
+         Buckets& into = *side.first;
+         const Buckets& from = *side.second;
+         if (from.counts.empty()) {
+             continue;
+         }
+         into.grow(from.first);
+         into.grow(from.first + static_cast<int64_t>(from.counts.size()) - 1);
+         for (size_t i = 0; i < from.counts.size(); ++i) {
+             into.counts[from.first - into.first + i] += from.counts[i];
+         }
+     }
+     zeros += other.zeros;
+     n += other.n;
+ }
+
+ double QuantileSketch::quantile(double q) const {
+     if (n == 0) {
+         return std::nan("");
+     }
+     // Smallest value whose cumulative count reaches rank q * (n - 1) + 1,
+     // walking negatives from the largest magnitude down
+     const uint64_t rank = static_cast<uint64_t>(std::min(std::max(q, 0.0), 1.0) * (n - 1)) + 1;
+     uint64_t seen = 0;
+     for (size_t i = negative.counts.size(); i-- > 0; ) {
+         seen += negative.counts[i];
+         if (seen >= rank) {
+             return -bucketValue(negative.first + static_cast<int64_t>(i));
+         }
+     }
+     seen += zeros;
+     if (seen >= rank) {
+         return 0.0;
+     }
+     for (size_t i = 0; i < positive.counts.size(); ++i) {
+         seen += positive.counts[i];
+         if (seen >= rank) {
+             return bucketValue(positive.first + static_cast<int64_t>(i));
+         }
+     }
+     return bucketValue(positive.first + static_cast<int64_t>(positive.counts.size()) - 1);
+ }
+
+ void ColumnStats::add(double value) {
+     ++n;
+     const double delta = value - mu;
+     mu += delta / n;
+     m2 += delta * (value - mu);
+     lo = std::min(lo, value);
+     hi = std::max(hi, value);
+     sketch.add(value);
+ }
+
+ void ColumnStats::merge(const ColumnStats& other) {
+     if (other.n == 0) {
+         return;
+     }
+     if (n == 0) {
+         *this = other;
+         return;
+     }
+     const uint64_t total = n + other.n;
+     const double delta = other.mu - mu;
+     mu += delta * other.n / total;
+     m2 += other.m2 + delta * delta * (static_cast<double>(n) * other.n / total);
+     n = total;
+     lo = std::min(lo, other.lo);
+     hi = std::max(hi, other.hi);
+     sketch.merge(other.sketch);
+ }
+
+ ColumnStats ColumnStats::mergeAll(std::vector<ColumnStats> parts) {
+     if (parts.empty()) {
+         return ColumnStats();
+     }
+     for (size_t stride = 1; stride < parts.size(); stride *= 2) {
+         for (size_t i = 0; i + stride < parts.size(); i += 2 * stride) {
+             parts[i].merge(parts[i + stride]);
+         }
+     }
+     return std::move(parts[0]);
+ }
+
+ double ColumnStats::variance() const {
+     return n > 0 ? m2 / n : 0.0;
+ }
+
+ double ColumnStats::sampleVariance() const {
+     return n > 1 ? m2 / (n - 1) : 0.0;
+ }
+
+ double ColumnStats::sampleStddev() const {
+     return std::sqrt(sampleVariance());
+ }
+
+ double ColumnStats::quantile(double q) const {
+     return n > 0 ? std::min(std::max(sketch.quantile(q), lo), hi) : std::nan("");
+ }
+
+ } // namespace column_stats
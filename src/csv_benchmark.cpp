@@ -0,0 +1,128 @@
+/**
+ * csv_benchmark.cpp - Ingest benchmark for csv_loader
+ *
+ * Writes a synthetic processed-data CSV (five features plus a label, as
+ * produced by loan_preprocessor), or takes an existing file, and loads it
+ * with the original per-line stringstream/stof parser and with
+ * csv_loader::loadCsv. Reports throughput for both and exits with status 1
+ * if their outputs differ.
+ *
+ * Usage: csv_benchmark [rows] [file]
+ */
+
+ #include <iostream>
+ #include <iomanip>
+ #include <fstream>
+ #include <sstream>
+ #include <vector>
+ #include <string>
+ #include <random>
+ #include <chrono>
+ #include <cstdio>
+ #include <omp.h>
+ #include "./include/csv_loader.h"
+
+ using namespace std;
+
+ // The parser loadData and loadTestData used before csv_loader
+ static void legacyLoad(const string& filename, vector<float>& X, vector<int>& y, int& N, int& D) {
+     ifstream file(filename);
+     string line;
+     getline(file, line);
+
+     vector<vector<float>> data;
+     vector<int> labels;
+     while (getline(file, line)) {
+         stringstream ss(line);
+         string value;
+         vector<float> row;
+         while (getline(ss, value, ',')) {
+             if (ss.peek() == EOF) {
+                 labels.push_back(static_cast<int>(stof(value)));
+             } else {
+                 row.push_back(stof(value));
+             }
+         }
+         data.push_back(row);
+     }
+
+     N = data.size();
+     D = data[0].size();
+     X.resize(static_cast<size_t>(N) * D);
+     y = labels;
+     for (int i = 0; i < N; ++i) {
+         for (int j = 0; j < D; ++j) {
+             X[static_cast<size_t>(i) * D + j] = data[i][j];
+         }
+     }
+ }
+
+ static void writeSynthetic(const string& filename, int rows) {
+     mt19937 rng(42);
+     // Whole-dollar amounts and a two-decimal ratio, printed with %f like
+     // the preprocessor's output
+     uniform_int_distribution<int> income(15000, 200000), loan(1000, 150000), dti(0, 10000);
+     uniform_int_distribution<int> credit(300, 850), flag(0, 1);
+     FILE* out = fopen(filename.c_str(), "w");
+     if (!out) {
+         cerr << "Error: Unable to write " << filename << endl;
+         exit(1);
+     }
+     fprintf(out, "Income,Credit_Score,Loan_Amount,DTI_Ratio,Employment_Status,Approval\n");
+     for (int i = 0; i < rows; ++i) {
+         fprintf(out, "%f,%d,%f,%f,%d,%d\n", static_cast<double>(income(rng)), credit(rng),
+                 static_cast<double>(loan(rng)), dti(rng) / 100.0, flag(rng), flag(rng));
+     }
+     fclose(out);
+ }
+
+ int main(int argc, char* argv[]) {
+     int rows = argc > 1 ? stoi(argv[1]) : 2000000;
+     string filename = argc > 2 ? argv[2] : "csv_benchmark_data.csv";
+     bool synthetic = argc <= 2;
+
+     if (synthetic) {
+         writeSynthetic(filename, rows);
+     }
+     ifstream probe(filename, ios::binary | ios::ate);
+     double megabytes = static_cast<double>(probe.tellg()) / (1 << 20);
+
+     cout << "==================================================" << endl;
+     cout << "CSV INGEST BENCHMARK (" << fixed << setprecision(1) << megabytes << " MB, "
+          << omp_get_max_threads() << " threads)" << endl;
+     cout << "--------------------------------------------------" << endl;
+
+     vector<float> legacyX, fastX;
+     vector<int> legacyY, fastY;
+     int legacyN = 0, legacyD = 0, fastN = 0, fastD = 0;
+
+     auto start = chrono::high_resolution_clock::now();
+     legacyLoad(filename, legacyX, legacyY, legacyN, legacyD);
+     double legacySeconds = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+
+     start = chrono::high_resolution_clock::now();
+     try {
+         csv_loader::loadCsv(filename, fastX, fastY, fastN, fastD);
+     } catch (const exception& e) {
+         cerr << "Error: " << e.what() << endl;
+         return 1;
+     }
+     double fastSeconds = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+
+     bool same = legacyN == fastN && legacyD == fastD && legacyX == fastX && legacyY == fastY;
+
+     cout << "Rows: " << fastN << ", features: " << fastD << endl;
+     cout << setprecision(3);
+     cout << "stringstream + stof : " << legacySeconds << " s, " << setprecision(1)
+          << megabytes / legacySeconds << " MB/s" << endl;
+     cout << setprecision(3);
+     cout << "csv_loader          : " << fastSeconds << " s, " << setprecision(1)
+          << megabytes / fastSeconds << " MB/s" << endl;
+     cout << "Speedup: " << setprecision(2) << legacySeconds / fastSeconds << "x" << endl;
+     cout << "Outputs " << (same ? "match" : "DIFFER") << endl;
+
+     if (synthetic) {
+         remove(filename.c_str());
+     }
+     return same ? 0 : 1;
+ }
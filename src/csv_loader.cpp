@@ -0,0 +1,325 @@
+/**
+ * csv_loader.cpp - Chunked, OpenMP-parallel numeric CSV loader
+ */
+
+ #include "./include/csv_loader.h"
+ #include <omp.h>
+ #include <algorithm>
+ #include <charconv>
+ #include <cstdint>
+ #include <cstring>
+ #include <cerrno>
+ #include <stdexcept>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <fcntl.h>
+ #include <unistd.h>
+
+ namespace csv_loader {
+
+ // Ranges smaller than this are not worth a task of their own
+ static const size_t MIN_CHUNK_BYTES = 1 << 20;
+ // Ranges per thread, so uneven line lengths still balance
+ static const int CHUNKS_PER_THREAD = 4;
+
+ static const int SKIP_COLUMN = -2;
+ static const int LABEL_COLUMN = -1;
+
+ // Read-only mapping of the input, released on scope exit
+ class MappedFile {
+ public:
+     explicit MappedFile(const std::string& filename) {
+         int fd = ::open(filename.c_str(), O_RDONLY);
+         if (fd < 0) {
+             throw std::runtime_error("Unable to open file " + filename + " (" + std::strerror(errno) + ")");
+         }
+         struct stat st;
+         if (::fstat(fd, &st) != 0) {
+             ::close(fd);
+             throw std::runtime_error("Unable to stat file " + filename);
+         }
+         size = static_cast<size_t>(st.st_size);
+         if (size > 0) {
+             void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+             if (mapping == MAP_FAILED) {
+                 ::close(fd);
+                 throw std::runtime_error("Unable to map file " + filename + " (" + std::strerror(errno) + ")");
+             }
+             ::madvise(mapping, size, MADV_SEQUENTIAL);
+             data = static_cast<const char*>(mapping);
+         }
+         ::close(fd);
+     }
+     ~MappedFile() {
+         if (data) {
+             ::munmap(const_cast<char*>(data), size);
+         }
+     }
+     MappedFile(const MappedFile&) = delete;
+     MappedFile& operator=(const MappedFile&) = delete;
+
+     const char* data = nullptr;
+     size_t size = 0;
+ };
+
+ // End of the line starting at p (the '\n' or end), and the line content
+ // end with any '\r' dropped
+ static const char* lineEnd(const char* p, const char* end, const char*& contentEnd) {
+     const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+     const char* e = nl ? nl : end;
+     contentEnd = (e > p && e[-1] == '\r') ? e - 1 : e;
+     return e;
+ }
+
+ static int countFields(const char* p, const char* end) {
+     return 1 + static_cast<int>(std::count(p, end, ','));
+ }
+
+ static bool isSpace(char c) {
+     return c == ' ' || c == '\t';
+ }
+
+ // Plain decimals whose significant digits fit a float exactly are divided
+ // by an exact power of ten, which IEEE rounds correctly (Clinger's fast
+ // path); everything else goes to std::from_chars. Either way the result is
+ // the correctly rounded float.
+ static const float EXACT_POWERS_OF_TEN[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+ static const uint64_t MAX_EXACT_MANTISSA = uint64_t(1) << 24;
+
+ static const char* parseFloat(const char* p, const char* end, float& value) {
+     const char* start = p;
+     bool negative = p < end && *p == '-';
+     p += negative;
+     uint64_t mantissa = 0;
+     int digits = 0, fraction = 0;
+     for (; p < end && *p >= '0' && *p <= '9'; ++p, ++digits) {
+         mantissa = mantissa * 10 + (*p - '0');
+     }
+     if (p < end && *p == '.') {
+         for (++p; p < end && *p >= '0' && *p <= '9'; ++p, ++digits, ++fraction) {
+             mantissa = mantissa * 10 + (*p - '0');
+         }
+     }
+     const bool plain = digits > 0 && digits <= 19 && (p == end || *p == ',' || isSpace(*p));
+     if (plain) {
+         while (fraction > 0 && mantissa % 10 == 0) {
+             mantissa /= 10;
+             --fraction;
+         }
+         if (mantissa <= MAX_EXACT_MANTISSA && fraction <= 10) {
+             value = static_cast<float>(mantissa) / EXACT_POWERS_OF_TEN[fraction];
+             value = negative ? -value : value;
+             return p;
+         }
+     }
+     auto result = std::from_chars(start, end, value);
+     return result.ec == std::errc() ? result.ptr : nullptr;
+ }
+
+ enum class FieldEnd { Invalid, Comma, LineEnd };
+
+ // Parse one field of [p, end) and leave p after its ','
+ static FieldEnd parseField(const char*& p, const char* end, float& value) {
+     while (p < end && isSpace(*p)) ++p;
+     if (p < end && *p == '+') ++p;
+     const char* next = parseFloat(p, end, value);
+     if (next == nullptr) {
+         return FieldEnd::Invalid;
+     }
+     p = next;
+     while (p < end && isSpace(*p)) ++p;
+     if (p == end) {
+         return FieldEnd::LineEnd;
+     }
+     if (*p != ',') {
+         return FieldEnd::Invalid;
+     }
+     ++p;
+     return FieldEnd::Comma;
+ }
+
+ // Where the rows start and which column feeds which feature or the label
+ struct ColumnPlan {
+     const char* body;
+     int numColumns;
+     std::vector<int> target;   // Feature index, LABEL_COLUMN or SKIP_COLUMN per column
+     size_t numFeatures;
+ };
+
+ static ColumnPlan planColumns(const MappedFile& file, const std::string& filename,
+                               const ColumnSelection& selection) {
+     const char* begin = file.data;
+     const char* end = file.data + file.size;
+
+     // The first line (header or not) fixes the number of columns
+     const char* firstContentEnd = begin;
+     const char* firstEnd = begin ? lineEnd(begin, end, firstContentEnd) : end;
+     if (begin == nullptr || firstContentEnd == begin) {
+         throw std::runtime_error("Empty CSV file " + filename);
+     }
+     ColumnPlan plan;
+     const int numColumns = plan.numColumns = countFields(begin, firstContentEnd);
+     plan.body = selection.hasHeader ? std::min(firstEnd + 1, end) : begin;
+
+     // Map every column to a feature index, the label or nothing
+     const int labelColumn = selection.labelColumn < 0 ? numColumns - 1 : selection.labelColumn;
+     if (labelColumn >= numColumns) {
+         throw std::runtime_error("Label column " + std::to_string(labelColumn) + " out of range in " + filename);
+     }
+     std::vector<int>& target = plan.target;
+     target.assign(numColumns, SKIP_COLUMN);
+     target[labelColumn] = LABEL_COLUMN;
+     std::vector<int> features = selection.featureColumns;
+     if (features.empty()) {
+         for (int c = 0; c < numColumns; ++c) {
+             if (c != labelColumn) {
+                 features.push_back(c);
+             }
+         }
+     }
+     for (size_t j = 0; j < features.size(); ++j) {
+         int c = features[j];
+         if (c < 0 || c >= numColumns || target[c] != SKIP_COLUMN) {
+             throw std::runtime_error("Invalid feature column " + std::to_string(c) + " for " + filename);
+         }
+         target[c] = static_cast<int>(j);
+     }
+     plan.numFeatures = features.size();
+     return plan;
+ }
+
+ // Parse the non-blank line [p, contentEnd) as row `row` into out and
+ // label; returns an error message, empty on success
+ static std::string parseRow(const char* p, const char* contentEnd, const ColumnPlan& plan,
+                             float* out, int& label, size_t row, const std::string& filename) {
+     for (int c = 0; c < plan.numColumns; ++c) {
+         float value;
+         FieldEnd fieldEnd = parseField(p, contentEnd, value);
+         if (fieldEnd == FieldEnd::Invalid) {
+             return "Invalid number in row " + std::to_string(row + 1) + ", column " + std::to_string(c) +
+                    " of " + filename;
+         }
+         if ((fieldEnd == FieldEnd::LineEnd) != (c == plan.numColumns - 1)) {
+             return "Row " + std::to_string(row + 1) + " of " + filename + " does not have " +
+                    std::to_string(plan.numColumns) + " fields";
+         }
+         if (plan.target[c] >= 0) {
+             out[plan.target[c]] = value;
+         } else if (plan.target[c] == LABEL_COLUMN) {
+             label = static_cast<int>(value);
+         }
+     }
+     return std::string();
+ }
+
+ void loadCsv(const std::string& filename,
+              std::vector<float>& X,
+              std::vector<int>& y,
+              int& N,
+              int& D,
+              const ColumnSelection& selection) {
+     MappedFile file(filename);
+     const char* end = file.data + file.size;
+     const ColumnPlan plan = planColumns(file, filename, selection);
+     const char* body = plan.body;
+     const size_t numFeatures = plan.numFeatures;
+
+     // Split the body into ranges that start right after a newline
+     const size_t bodyBytes = end - body;
+     const int numChunks = static_cast<int>(std::max<size_t>(1, std::min<size_t>(
+         static_cast<size_t>(omp_get_max_threads()) * CHUNKS_PER_THREAD, bodyBytes / MIN_CHUNK_BYTES)));
+     std::vector<const char*> bounds(numChunks + 1, end);
+     bounds[0] = body;
+     for (int k = 1; k < numChunks; ++k) {
+         const char* p = std::max(body + bodyBytes * k / numChunks, bounds[k - 1]);
+         const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+         bounds[k] = nl ? nl + 1 : end;
+     }
+
+     // Pass 1: non-blank rows per range, then each range's first row
+     std::vector<size_t> firstRow(numChunks + 1, 0);
+     #pragma omp parallel for schedule(dynamic, 1)
+     for (int k = 0; k < numChunks; ++k) {
+         size_t rows = 0;
+         const char* contentEnd;
+         for (const char* p = bounds[k]; p < bounds[k + 1]; ) {
+             const char* next = lineEnd(p, end, contentEnd) + 1;
+             rows += contentEnd != p;
+             p = next;
+         }
+         firstRow[k + 1] = rows;
+     }
+     for (int k = 0; k < numChunks; ++k) {
+         firstRow[k + 1] += firstRow[k];
+     }
+     const size_t numRows = firstRow[numChunks];
+
+     X.assign(numRows * numFeatures, 0.0f);
+     y.assign(numRows, 0);
+
+     // Pass 2: parse each range into its rows; keep the first error per range
+     std::vector<std::string> errors(numChunks);
+     #pragma omp parallel for schedule(dynamic, 1)
+     for (int k = 0; k < numChunks; ++k) {
+         size_t row = firstRow[k];
+         const char* contentEnd;
+         for (const char* p = bounds[k]; p < bounds[k + 1]; ) {
+             const char* next = lineEnd(p, end, contentEnd) + 1;
+             if (contentEnd == p) {
+                 p = next;
+                 continue;
+             }
+             errors[k] = parseRow(p, contentEnd, plan, X.data() + row * numFeatures, y[row], row, filename);
+             if (!errors[k].empty()) {
+                 break;
+             }
+             ++row;
+             p = next;
+         }
+     }
+     for (const auto& error : errors) {
+         if (!error.empty()) {
+             throw std::runtime_error(error);
+         }
+     }
+
+     N = static_cast<int>(numRows);
+     D = static_cast<int>(numFeatures);
+ }
+
+ void streamCsv(const std::string& filename,
+                int chunkRows,
+                const ChunkHandler& onChunk,
+                const ColumnSelection& selection) {
+     MappedFile file(filename);
+     const char* end = file.data + file.size;
+     const ColumnPlan plan = planColumns(file, filename, selection);
+     const size_t numFeatures = plan.numFeatures;
+     chunkRows = std::max(1, chunkRows);
+
+     std::vector<float> X(static_cast<size_t>(chunkRows) * numFeatures);
+     std::vector<int> y(chunkRows);
+     int rows = 0;
+     size_t row = 0;
+     const char* contentEnd;
+     for (const char* p = plan.body; p < end; ) {
+         const char* next = lineEnd(p, end, contentEnd) + 1;
+         if (contentEnd != p) {
+             std::string error = parseRow(p, contentEnd, plan, X.data() + rows * numFeatures, y[rows], row, filename);
+             if (!error.empty()) {
+                 throw std::runtime_error(error);
+             }
+             ++row;
+             if (++rows == chunkRows) {
+                 onChunk(X.data(), y.data(), rows, static_cast<int>(numFeatures));
+                 rows = 0;
+             }
+         }
+         p = next;
+     }
+     if (rows > 0) {
+         onChunk(X.data(), y.data(), rows, static_cast<int>(numFeatures));
+     }
+ }
+
+ } // namespace csv_loader
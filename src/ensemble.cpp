@@ -0,0 +1,158 @@
+/**
+ * ensemble.cpp - Soft-vote combination of several trained classifiers
+ */
+
+ #include "./include/ensemble.h"
+ #include <algorithm>
+ #include <cmath>
+ #include <fstream>
+ #include <stdexcept>
+
+ using namespace std;
+
+ // Keeps logit finite for unanimous RF votes and saturated outputs
+ static const float PROB_EPSILON = 1e-4f;
+
+ static void toLogits(float* values, size_t count) {
+     for (size_t i = 0; i < count; ++i) {
+         float p = min(max(values[i], PROB_EPSILON), 1.0f - PROB_EPSILON);
+         values[i] = log(p / (1.0f - p));
+     }
+ }
+
+ void Ensemble::addMember(const string& name, unique_ptr<ModelInterface> model, float weight) {
+     if (!model) {
+         throw invalid_argument("Ensemble member " + name + " has no model");
+     }
+     if (!(weight >= 0.0f)) {
+         throw invalid_argument("Ensemble member " + name + " has a negative weight");
+     }
+     members.push_back({name, move(model), weight});
+     // A meta-learner only fits the member set it was trained for
+     stacker.reset();
+     combineRule = EnsembleRule::Weighted;
+ }
+
+ void Ensemble::setWeights(const vector<float>& weights) {
+     if (weights.size() != members.size()) {
+         throw invalid_argument("Expected " + to_string(members.size()) + " ensemble weights, got " +
+                                to_string(weights.size()));
+     }
+     float total = 0.0f;
+     for (float w : weights) {
+         if (!(w >= 0.0f)) {
+             throw invalid_argument("Ensemble weights must be non-negative");
+         }
+         total += w;
+     }
+     if (total <= 0.0f) {
+         throw invalid_argument("Ensemble weights must not all be zero");
+     }
+     for (size_t m = 0; m < members.size(); ++m) {
+         members[m].weight = weights[m];
+     }
+ }
+
+ vector<float> Ensemble::weights() const {
+     vector<float> w;
+     for (const Member& member : members) {
+         w.push_back(member.weight);
+     }
+     return w;
+ }
+
+ void Ensemble::setRule(EnsembleRule rule) {
+     if (rule == EnsembleRule::Stacked && !stacker) {
+         throw logic_error("Stacked ensemble rule needs a fitted or loaded meta-learner");
+     }
+     combineRule = rule;
+ }
+
+ void Ensemble::memberProbabilities(const float* X, int N, int D, float* probs) {
+     const int M = size();
+     vector<float> column(N);
+     for (int m = 0; m < M; ++m) {
+         members[m].model->predictProbaBatch(X, N, D, column.data());
+         for (int i = 0; i < N; ++i) {
+             probs[static_cast<size_t>(i) * M + m] = column[i];
+         }
+     }
+ }
+
+ void Ensemble::fitStacker(const float* X, const int* y, int N, int D) {
+     const int M = size();
+     if (M == 0 || N <= 0) {
+         throw logic_error("Fitting an ensemble meta-learner needs members and labelled rows");
+     }
+     vector<float> inputs(static_cast<size_t>(N) * M);
+     memberProbabilities(X, N, D, inputs.data());
+     toLogits(inputs.data(), inputs.size());
+
+     auto fitted = make_unique<LogisticRegression>(M, 0.01f, 100, LRSolver::LBFGS, 1e-6f);
+     fitted->train(FloatSpan(inputs.data(), inputs.size()), LabelSpan(y, static_cast<size_t>(N)), N, M);
+     stacker = move(fitted);
+     combineRule = EnsembleRule::Stacked;
+ }
+
+ void Ensemble::saveStacker(const string& filename) const {
+     if (!stacker) {
+         throw logic_error("No ensemble meta-learner to save");
+     }
+     stacker->saveModel(filename);
+ }
+
+ void Ensemble::loadStacker(const string& filename) {
+     // LogisticRegression::loadModel only reports a missing file, so check first
+     if (!ifstream(filename, ios::binary)) {
+         throw runtime_error("Cannot open " + filename);
+     }
+     auto loaded = make_unique<LogisticRegression>();
+     loaded->loadModel(filename);
+     if (loaded->featureCount() != size()) {
+         throw runtime_error(filename + " was fitted for " + to_string(loaded->featureCount()) +
+                             " ensemble members, have " + to_string(size()));
+     }
+     stacker = move(loaded);
+     combineRule = EnsembleRule::Stacked;
+ }
+
+ void Ensemble::predictProba(const float* X, int N, int D, float* combined, float* memberProbs) {
+     const int M = size();
+     if (N <= 0) {
+         return;
+     }
+     if (M == 0) {
+         throw logic_error("Ensemble has no members");
+     }
+
+     vector<float> scratch;
+     float* probs = memberProbs;
+     if (!probs) {
+         scratch.resize(static_cast<size_t>(N) * M);
+         probs = scratch.data();
+     }
+     memberProbabilities(X, N, D, probs);
+
+     if (combineRule == EnsembleRule::Stacked) {
+         vector<float> logits(probs, probs + static_cast<size_t>(N) * M);
+         toLogits(logits.data(), logits.size());
+         stacker->predictProbaBatch(logits.data(), N, M, combined);
+         return;
+     }
+
+     float total = 0.0f;
+     for (const Member& member : members) {
+         total += member.weight;
+     }
+     if (total <= 0.0f) {
+         throw logic_error("Ensemble weights must not all be zero");
+     }
+     for (int i = 0; i < N; ++i) {
+         const float* p = probs + static_cast<size_t>(i) * M;
+         float sum = 0.0f;
+         for (int m = 0; m < M; ++m) {
+             sum += members[m].weight * p[m];
+         }
+         combined[i] = sum / total;
+     }
+ }
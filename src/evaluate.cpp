@@ -265,65 +265,56 @@
 #include "./include/random_forest.h"
 #include "./include/mlp.h"
 #include "./include/logistic_regression.h"
+#include "./include/binary_dataset.h"
+#include "./include/csv_loader.h"
 
 void loadTestData(const std::string& filename,
                   std::vector<float>& X,
                   std::vector<int>& y,
                   int& N,
                   int& D) {
-    std::ifstream file(filename);
-    std::string line;
-    // Read header
-    std::getline(file, line);
-
-    std::vector<std::vector<float>> data;
-    std::vector<int> labels;
-
-    while (std::getline(file, line)) {
-        std::stringstream ss(line);
-        std::string val;
-        std::vector<float> row;
-        int col = 0;
-        while (std::getline(ss, val, ',')) {
-            if (ss.peek() == EOF) {
-                // last column is label
-                labels.push_back(std::stoi(val));
-            } else {
-                row.push_back(std::stof(val));
-            }
-            ++col;
+    if (binary_dataset::isBinaryDataset(filename)) {
+        try {
+            binary_dataset::loadDataset(filename, X, y, N, D);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            MPI_Abort(MPI_COMM_WORLD, 1);
         }
-        data.push_back(row);
+        return;
     }
 
-    N = data.size();
-    D = data[0].size();
-    X.resize(N * D);
-    y = labels;
-
-    for (int i = 0; i < N; ++i) {
-        for (int j = 0; j < D; ++j) {
-            X[i*D + j] = data[i][j];
-        }
+    // Same column layout as the trainer: label last, the rest features
+    try {
+        csv_loader::loadCsv(filename, X, y, N, D);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, 1);
     }
 }
 
 // Define the evaluate function before it's used
 Metrics evaluate(const ModelInterface& prototype,
-                 const std::vector<float>& X,
-                 const std::vector<int>& y,
+                 FloatSpan X,
+                 LabelSpan y,
                  int N,
                  int D) {
     int TP=0, FP=0, TN=0, FN=0;
 
+    // Score the whole matrix in one batch; models parallelize internally
+    auto model = prototype.clone();
+    std::vector<int> preds(N);
+    try {
+        model->predictBatch(X.data(), N, D, preds.data());
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
     #pragma omp parallel reduction(+:TP,FP,TN,FN)
     {
-        // each thread gets its own model copy
-        auto model = prototype.clone();
         #pragma omp for
         for (int i = 0; i < N; ++i) {
-            std::vector<float> feat(X.begin() + i*D, X.begin() + i*D + D);
-            int pred = model->predict(feat);
+            int pred = preds[i];
             int actual = y[i];
             if      (pred==1 && actual==1) ++TP;
             else if (pred==1 && actual==0) ++FP;
@@ -340,8 +331,8 @@ Metrics evaluate(const ModelInterface& prototype,
 }
 
 Metrics evaluateModel(const std::string& modelPath,
-                      const std::vector<float>& X,
-                      const std::vector<int>& y,
+                      FloatSpan X,
+                      LabelSpan y,
                       int N,
                       int D) {
     // Load the appropriate model based on path
@@ -0,0 +1,138 @@
+/**
+ * feature_transform.cpp - Persisted per-feature input transform
+ */
+
+ #include "./include/feature_transform.h"
+ #include <fstream>
+ #include <algorithm>
+ #include <stdexcept>
+ #include <cstring>
+ #include <cerrno>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <fcntl.h>
+ #include <unistd.h>
+
+ namespace feature_transform {
+
+ // Rows per tile of FeatureTransform::apply
+ static const size_t TILE_ROWS = 16;
+ // Batches smaller than this are transformed on the calling thread
+ static const size_t PARALLEL_MIN_ROWS = 1 << 16;
+
+ void writeTransform(const std::string& filename, const std::vector<FeatureParams>& features, uint64_t numRows) {
+     std::ofstream out(filename, std::ios::binary);
+     if (!out) {
+         throw std::runtime_error("Could not open transform file for writing: " + filename);
+     }
+
+     TransformHeader header{};
+     std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+     header.version = VERSION;
+     header.numFeatures = static_cast<uint32_t>(features.size());
+     header.numRows = numRows;
+     header.paramsOffset = sizeof(TransformHeader);
+     out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+     for (float FeatureParams::*field : {&FeatureParams::offset, &FeatureParams::scale,
+                                         &FeatureParams::lower, &FeatureParams::upper}) {
+         for (const FeatureParams& feature : features) {
+             out.write(reinterpret_cast<const char*>(&(feature.*field)), sizeof(float));
+         }
+     }
+     if (!out) {
+         throw std::runtime_error("Failed writing transform file: " + filename);
+     }
+ }
+
+ FeatureTransform::FeatureTransform(const std::string& filename) {
+     int fd = ::open(filename.c_str(), O_RDONLY);
+     if (fd < 0) {
+         throw std::runtime_error("Could not open transform file: " + filename + " (" + std::strerror(errno) + ")");
+     }
+     struct stat st;
+     if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(TransformHeader)) {
+         ::close(fd);
+         throw std::runtime_error("Not a feature transform file: " + filename);
+     }
+     mappingSize = static_cast<size_t>(st.st_size);
+     mapping = ::mmap(nullptr, mappingSize, PROT_READ, MAP_SHARED, fd, 0);
+     ::close(fd);
+     if (mapping == MAP_FAILED) {
+         mapping = nullptr;
+         throw std::runtime_error("Could not map transform file: " + filename + " (" + std::strerror(errno) + ")");
+     }
+
+     const char* base = static_cast<const char*>(mapping);
+     std::memcpy(&header, base, sizeof(header));
+     const uint64_t D = header.numFeatures;
+     if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+         header.paramsOffset % sizeof(float) != 0 ||
+         header.paramsOffset > mappingSize || (mappingSize - header.paramsOffset) / (4 * sizeof(float)) < D) {
+         ::munmap(mapping, mappingSize);
+         throw std::runtime_error("Not a feature transform file: " + filename);
+     }
+
+     offsets = reinterpret_cast<const float*>(base + header.paramsOffset);
+     scales = offsets + D;
+     lowers = scales + D;
+     uppers = lowers + D;
+
+     tileOffset.resize(TILE_ROWS * D);
+     tileScale.resize(TILE_ROWS * D);
+     tileLower.resize(TILE_ROWS * D);
+     tileUpper.resize(TILE_ROWS * D);
+     for (size_t k = 0; k < TILE_ROWS * D; ++k) {
+         tileOffset[k] = offsets[k % D];
+         tileScale[k] = scales[k % D];
+         tileLower[k] = lowers[k % D];
+         tileUpper[k] = uppers[k % D];
+     }
+ }
+
+ FeatureTransform::~FeatureTransform() {
+     if (mapping) {
+         ::munmap(mapping, mappingSize);
+     }
+ }
+
+ FeatureParams FeatureTransform::params(int feature) const {
+     FeatureParams p;
+     p.offset = offsets[feature];
+     p.scale = scales[feature];
+     p.lower = lowers[feature];
+     p.upper = uppers[feature];
+     return p;
+ }
+
+ void FeatureTransform::apply(const float* in, float* out, size_t rows) const {
+     const size_t D = header.numFeatures;
+     const size_t tileSize = TILE_ROWS * D;
+     const size_t total = rows * D;
+     const size_t numTiles = (total + tileSize - 1) / std::max<size_t>(tileSize, 1);
+     const float* off = tileOffset.data();
+     const float* sc = tileScale.data();
+     const float* lo = tileLower.data();
+     const float* hi = tileUpper.data();
+
+     // Tiles start on row boundaries, so element k of a tile is feature k % D
+     #pragma omp parallel for schedule(static) if (rows >= PARALLEL_MIN_ROWS)
+     for (size_t t = 0; t < numTiles; ++t) {
+         const size_t begin = t * tileSize;
+         const size_t n = std::min(tileSize, total - begin);
+         const float* x = in + begin;
+         float* y = out + begin;
+         #pragma omp simd
+         for (size_t k = 0; k < n; ++k) {
+             y[k] = (std::min(std::max(x[k], lo[k]), hi[k]) - off[k]) * sc[k];
+         }
+     }
+ }
+
+ std::vector<float> FeatureTransform::apply(const std::vector<float>& X) const {
+     std::vector<float> out(X.size());
+     apply(X.data(), out.data(), X.size() / std::max(1, numFeatures()));
+     return out;
+ }
+
+ } // namespace feature_transform
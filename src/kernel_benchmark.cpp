@@ -0,0 +1,175 @@
+/**
+ * kernel_benchmark.cpp - Accuracy check and microbenchmark for simd_kernels
+ *
+ * Compares the runtime-selected kernels (see kernels::activeIsa) with plain
+ * scalar loops: the vector sigmoid is swept over
+ * [-SIGMOID_ACCURATE_RANGE, SIGMOID_ACCURATE_RANGE] and its worst error in
+ * ULPs is reported against SIGMOID_MAX_ULP; dot, axpy and logits are
+ * checked to a relative tolerance. Exits with status 1 if any check fails,
+ * so it can be run once per ISA with ML_SIMD=scalar|avx2|avx512.
+ */
+
+ #include <iostream>
+ #include <iomanip>
+ #include <vector>
+ #include <random>
+ #include <chrono>
+ #include <cmath>
+ #include <cstring>
+ #include <cstdint>
+ #include <string>
+ #include <algorithm>
+ #include "./include/simd_kernels.h"
+
+ using namespace std;
+
+ // Distance in units in the last place between two non-negative floats
+ static int64_t ulpDistance(float a, float b) {
+     int32_t ia, ib;
+     memcpy(&ia, &a, sizeof(float));
+     memcpy(&ib, &b, sizeof(float));
+     return llabs(static_cast<int64_t>(ia) - static_cast<int64_t>(ib));
+ }
+
+ static bool closeEnough(float got, float want, float tol) {
+     return fabs(got - want) <= tol * max(1.0f, fabs(want));
+ }
+
+ int main(int argc, char* argv[]) {
+     int n = argc > 1 ? stoi(argv[1]) : 1 << 20;
+     int repeats = argc > 2 ? stoi(argv[2]) : 20;
+     bool ok = true;
+
+     cout << "==================================================" << endl;
+     cout << "SIMD KERNEL CHECK (active path: " << kernels::activeIsa() << ")" << endl;
+     cout << "--------------------------------------------------" << endl;
+
+     // Sigmoid: sweep the float bit patterns of [0, range] on both signs
+     const float range = kernels::SIGMOID_ACCURATE_RANGE;
+     int32_t maxBits;
+     memcpy(&maxBits, &range, sizeof(float));
+     const int32_t stride = 61;
+     const int chunk = 4096;
+     vector<float> xs, ys(chunk);
+     xs.reserve(chunk);
+     int64_t worstUlp = 0;
+     float worstX = 0.0f;
+     size_t swept = 0;
+     auto flush = [&]() {
+         kernels::sigmoid(xs.data(), ys.data(), xs.size());
+         for (size_t i = 0; i < xs.size(); ++i) {
+             int64_t d = ulpDistance(ys[i], kernels::sigmoid(xs[i]));
+             if (d > worstUlp) {
+                 worstUlp = d;
+                 worstX = xs[i];
+             }
+         }
+         swept += xs.size();
+         xs.clear();
+     };
+     for (int32_t bits = 0; bits <= maxBits; bits += stride) {
+         float v;
+         memcpy(&v, &bits, sizeof(float));
+         xs.push_back(v);
+         xs.push_back(-v);
+         if (xs.size() >= static_cast<size_t>(chunk)) {
+             flush();
+         }
+     }
+     flush();
+     bool sigmoidOk = worstUlp <= kernels::SIGMOID_MAX_ULP;
+     ok = ok && sigmoidOk;
+     cout << "sigmoid: " << swept << " points, max error " << worstUlp << " ulp at x=" << worstX
+          << " (bound " << kernels::SIGMOID_MAX_ULP << ") " << (sigmoidOk ? "OK" : "FAIL") << endl;
+
+     // Dot, axpy and logits over odd lengths so the tails are exercised
+     mt19937 rng(42);
+     uniform_real_distribution<float> dist(-1.0f, 1.0f);
+     const float tol = 1e-4f;
+     bool linearOk = true;
+     for (int len : {1, 3, 5, 7, 8, 15, 16, 17, 31, 64, 100, 257}) {
+         vector<float> a(len), b(len), y(len), yRef(len);
+         for (int i = 0; i < len; ++i) {
+             a[i] = dist(rng);
+             b[i] = dist(rng);
+             y[i] = yRef[i] = dist(rng);
+         }
+
+         double ref = 0.0;
+         for (int i = 0; i < len; ++i) {
+             ref += static_cast<double>(a[i]) * b[i];
+         }
+         linearOk = linearOk && closeEnough(kernels::dot(a.data(), b.data(), len), ref, tol * len);
+
+         kernels::axpy(0.75f, a.data(), y.data(), len);
+         for (int i = 0; i < len; ++i) {
+             yRef[i] += 0.75f * a[i];
+             linearOk = linearOk && closeEnough(y[i], yRef[i], tol);
+         }
+
+         for (int rows : {1, 7, 16, 33}) {
+             vector<float> X(static_cast<size_t>(rows) * len), out(rows);
+             for (float& v : X) {
+                 v = dist(rng);
+             }
+             kernels::logits(X.data(), rows, len, b.data(), 0.5f, out.data());
+             for (int r = 0; r < rows; ++r) {
+                 double z = 0.5;
+                 for (int j = 0; j < len; ++j) {
+                     z += static_cast<double>(X[static_cast<size_t>(r) * len + j]) * b[j];
+                 }
+                 linearOk = linearOk && closeEnough(out[r], z, tol * len);
+             }
+         }
+     }
+     ok = ok && linearOk;
+     cout << "dot/axpy/logits vs scalar: " << (linearOk ? "OK" : "FAIL") << endl;
+
+     // Throughput against the scalar loops the models used before
+     vector<float> x(n), out(n), w(5);
+     for (float& v : x) {
+         v = dist(rng) * 10.0f;
+     }
+     for (float& v : w) {
+         v = dist(rng);
+     }
+     const int rows = n / 5;
+
+     using clk = chrono::high_resolution_clock;
+     auto timeLoop = [&](auto&& body) {
+         auto start = clk::now();
+         for (int r = 0; r < repeats; ++r) {
+             body();
+         }
+         return chrono::duration<double>(clk::now() - start).count();
+     };
+
+     double tSigScalar = timeLoop([&]() {
+         for (int i = 0; i < n; ++i) {
+             out[i] = kernels::sigmoid(x[i]);
+         }
+     });
+     double tSigVec = timeLoop([&]() { kernels::sigmoid(x.data(), out.data(), n); });
+     double tLogitScalar = timeLoop([&]() {
+         for (int i = 0; i < rows; ++i) {
+             float z = 0.0f;
+             for (int j = 0; j < 5; ++j) {
+                 z += w[j] * x[static_cast<size_t>(i) * 5 + j];
+             }
+             out[i] = z;
+         }
+     });
+     double tLogitVec = timeLoop([&]() { kernels::logits(x.data(), rows, 5, w.data(), 0.0f, out.data()); });
+
+     double elems = static_cast<double>(n) * repeats / 1e6;
+     double logitRows = static_cast<double>(rows) * repeats / 1e6;
+     cout << "--------------------------------------------------" << endl;
+     cout << fixed << setprecision(1);
+     cout << "Sigmoid scalar:      " << elems / tSigScalar << " M elems/s" << endl;
+     cout << "Sigmoid dispatched:  " << elems / tSigVec << " M elems/s" << endl;
+     cout << "Logits D=5 scalar:   " << logitRows / tLogitScalar << " M rows/s" << endl;
+     cout << "Logits D=5 dispatch: " << logitRows / tLogitVec << " M rows/s" << endl;
+     cout << "==================================================" << endl;
+
+     return ok ? 0 : 1;
+ }
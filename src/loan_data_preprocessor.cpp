@@ -5,6 +5,9 @@
 // loan_data_preprocessor.cpp
 #include "include/loan_data_preprocessor.h"
 #include "include/csv.h" // Include fast-cpp-csv-parser
+#include "include/binary_dataset.h"
+#include "include/bounded_queue.h"
+#include "include/feature_transform.h"
 
 #include <iostream>
 #include <fstream>
@@ -15,6 +18,11 @@
 #include <stdexcept>
 #include <iomanip>
 #include <sstream>
+#include <charconv>
+#include <thread>
+#include <mutex>
+#include <exception>
+#include <functional>
 using namespace io;
 namespace loan_preprocessing
 {
@@ -22,6 +30,252 @@ namespace loan_preprocessing
     std::vector<double> LoanRecord::column_means;
     std::vector<double> LoanRecord::column_stddevs;
 
+    // Numerical columns with statistics: income, credit_score, loan_amount, dti_ratio
+    static const int NUM_STAT_FEATURES = 4;
+
+    // Output column layout; Approval is the label
+    static const int LABEL_COLUMN = 5;
+
+    static std::vector<binary_dataset::ColumnSpec> loan_columns()
+    {
+        using binary_dataset::ColumnType;
+        return {{"Income", ColumnType::Float32},
+                {"Credit_Score", ColumnType::Int32},
+                {"Loan_Amount", ColumnType::Float32},
+                {"DTI_Ratio", ColumnType::Float32},
+                {"Employment_Status", ColumnType::Int32},
+                {"Approval", ColumnType::Int32}};
+    }
+
+    // Rows formatted per output block when writing CSV
+    static const size_t CSV_BLOCK_ROWS = 16384;
+
+    // Rows per ColumnStats::addBlock call; small enough that the block is
+    // still in cache for its squared-deviation loop
+    static const size_t STATS_BLOCK_ROWS = 4096;
+
+    // ValidityBitmap implementation
+    void ValidityBitmap::set_all()
+    {
+        std::fill(words.begin(), words.end(), ~uint64_t(0));
+        if (bits % 64 != 0)
+        {
+            words.back() = (uint64_t(1) << (bits % 64)) - 1;
+        }
+    }
+
+    size_t ValidityBitmap::count(size_t begin, size_t end) const
+    {
+        size_t total = 0;
+        for (size_t w = begin / 64; w < (end + 63) / 64; w++)
+        {
+            uint64_t word = words[w];
+            if (w == end / 64)
+            {
+                word &= (uint64_t(1) << (end % 64)) - 1;
+            }
+            total += __builtin_popcountll(word);
+        }
+        return total;
+    }
+
+    // LoanColumns implementation
+    void LoanColumns::clear()
+    {
+        income.clear();
+        credit_score.clear();
+        loan_amount.clear();
+        dti_ratio.clear();
+        employment_status.clear();
+        approval.clear();
+        for (ValidityBitmap *valid : {&income_valid, &credit_score_valid, &loan_amount_valid,
+                                      &dti_ratio_valid, &employment_status_valid, &approval_valid})
+        {
+            valid->clear();
+        }
+    }
+
+    void LoanColumns::reserve(size_t n)
+    {
+        income.reserve(n);
+        credit_score.reserve(n);
+        loan_amount.reserve(n);
+        dti_ratio.reserve(n);
+        employment_status.reserve(n);
+        approval.reserve(n);
+        for (ValidityBitmap *valid : {&income_valid, &credit_score_valid, &loan_amount_valid,
+                                      &dti_ratio_valid, &employment_status_valid, &approval_valid})
+        {
+            valid->reserve(n);
+        }
+    }
+
+    // Store value when it is present, 0 otherwise
+    template <typename T>
+    static void append_value(std::vector<T> &values, ValidityBitmap &valid, T value, bool present)
+    {
+        values.push_back(present ? value : T(0));
+        valid.push_back(present);
+    }
+
+    void LoanColumns::append(const LoanRecord &record)
+    {
+        // Non-positive and NaN amounts and unknown categories are missing
+        append_value(income, income_valid, record.income, !std::isnan(record.income) && record.income > 0);
+        append_value<int32_t>(credit_score, credit_score_valid, record.credit_score, record.credit_score > 0);
+        append_value(loan_amount, loan_amount_valid, record.loan_amount, !std::isnan(record.loan_amount) && record.loan_amount > 0);
+        append_value(dti_ratio, dti_ratio_valid, record.dti_ratio, !std::isnan(record.dti_ratio) && record.dti_ratio > 0);
+        append_value<int32_t>(employment_status, employment_status_valid, record.employment_status, record.employment_status >= 0);
+        append_value<int32_t>(approval, approval_valid, record.approval, record.approval >= 0);
+    }
+
+    // Replace missing entries with fill and mark the column complete
+    template <typename T>
+    static void impute_column(std::vector<T> &values, ValidityBitmap &valid, T fill, bool parallel)
+    {
+        T *x = values.data();
+        const uint64_t *bits = valid.data();
+        const size_t n = values.size();
+#pragma omp parallel for simd if (parallel) schedule(static)
+        for (size_t i = 0; i < n; i++)
+        {
+            x[i] = ((bits[i / 64] >> (i % 64)) & 1) ? x[i] : fill;
+        }
+        valid.set_all();
+    }
+
+    // Append value in std::fixed, precision 6 notation
+    static void append_fixed(std::string &out, double value)
+    {
+        char buffer[128];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::fixed, 6);
+        if (result.ec == std::errc())
+        {
+            out.append(buffer, result.ptr);
+        }
+        else
+        {
+            std::ostringstream stream;
+            stream << std::fixed << std::setprecision(6) << value;
+            out += stream.str();
+        }
+    }
+
+    static void append_int(std::string &out, int value)
+    {
+        char buffer[16];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out.append(buffer, result.ptr);
+    }
+
+    // Format rows as CSV lines, the same text operator<< with std::fixed
+    // and std::setprecision(6) produces
+    static void format_csv_rows(const LoanColumns &rows, size_t begin, size_t end, std::string &out)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            append_fixed(out, rows.income[i]);
+            out += ',';
+            append_int(out, rows.credit_score[i]);
+            out += ',';
+            append_fixed(out, rows.loan_amount[i]);
+            out += ',';
+            append_fixed(out, rows.dti_ratio[i]);
+            out += ',';
+            append_int(out, rows.employment_status[i]);
+            out += ',';
+            append_int(out, rows.approval[i]);
+            out += '\n';
+        }
+    }
+
+    using LoanCsvReader = io::CSVReader<6>;
+
+    // Reader positioned after the header of a raw loan CSV
+    static std::unique_ptr<LoanCsvReader> open_loan_csv(const std::string &filename)
+    {
+        auto reader = std::make_unique<LoanCsvReader>(filename);
+        reader->read_header(ignore_extra_column,
+            "Income", "Credit_Score",
+            "Loan_Amount", "DTI_Ratio",
+            "Employment_Status", "Approval");
+        return reader;
+    }
+
+    // One raw CSV row, before categorical encoding
+    struct RawLoanRow
+    {
+        double income{0.0};
+        int credit_score{0};
+        double loan_amount{0.0};
+        double dti_ratio{0.0};
+        std::string employment_status;
+        std::string approval;
+    };
+
+    using RawChunk = std::vector<RawLoanRow>;
+    using RecordChunk = LoanColumns;
+
+    // Output of the format stage: CSV text, or the records themselves when
+    // the binary writer does its own column conversion
+    struct FormattedChunk
+    {
+        std::string text;
+        RecordChunk records;
+        size_t rows{0};
+    };
+
+    // Run one middle pipeline stage: pop a chunk, transform it, push the
+    // result. Time blocked on either queue is stall time, the rest is busy.
+    template <typename In, typename Out, typename Work>
+    static void run_pipeline_stage(BoundedQueue<In> &in, BoundedQueue<Out> &out, ProfileMetric &metric, Work work)
+    {
+        In item;
+        while (true)
+        {
+            double waited = omp_get_wtime();
+            bool more = in.pop(item);
+            double started = omp_get_wtime();
+            metric.stall_time += started - waited;
+            if (!more)
+            {
+                break;
+            }
+
+            Out result = work(std::move(item));
+            double finished = omp_get_wtime();
+            metric.busy_time += finished - started;
+
+            if (!out.push(std::move(result)))
+            {
+                break;
+            }
+            metric.stall_time += omp_get_wtime() - finished;
+        }
+        out.close();
+    }
+
+    // Final stage: pop chunks and consume them
+    template <typename In, typename Work>
+    static void run_pipeline_sink(BoundedQueue<In> &in, ProfileMetric &metric, Work work)
+    {
+        In item;
+        while (true)
+        {
+            double waited = omp_get_wtime();
+            bool more = in.pop(item);
+            double started = omp_get_wtime();
+            metric.stall_time += started - waited;
+            if (!more)
+            {
+                break;
+            }
+
+            work(item);
+            metric.busy_time += omp_get_wtime() - started;
+        }
+    }
+
     // ProfileMetric implementation
     ProfileMetric::ProfileMetric(const std::string &name) : stage_name(name),
                                                             start_time(omp_get_wtime()),
@@ -31,6 +285,10 @@ namespace loan_preprocessing
     void ProfileMetric::end()
     {
         end_time = omp_get_wtime();
+        if (!tracks_stalls)
+        {
+            busy_time = end_time - start_time;
+        }
     }
 
     // Dataset implementation
@@ -56,7 +314,7 @@ bool Dataset::load_from_file(const std::string &filename)
             "Employment_Status", "Approval");
         
 
-        records.clear();
+        columns.clear();
         
         std::string employment_status, approval_status;
         double income, loan_amount, dti_ratio;
@@ -71,11 +329,11 @@ bool Dataset::load_from_file(const std::string &filename)
             record.dti_ratio = dti_ratio;
         
             encode_categorical_vars(record, employment_status, approval_status);
-            records.push_back(std::move(record));
+            columns.append(record);
         }
         
 
-        std::cout << "Successfully loaded " << records.size() << " records\n";
+        std::cout << "Successfully loaded " << columns.size() << " records\n";
 
         metric.end();
         profile_data.push_back(metric);
@@ -114,7 +372,7 @@ bool Dataset::load_from_file(const std::string &filename)
 
     void Dataset::preprocess()
     {
-        if (records.empty())
+        if (columns.empty())
         {
             throw std::runtime_error("No data to preprocess. Load data first.");
         }
@@ -135,132 +393,57 @@ bool Dataset::load_from_file(const std::string &filename)
     {
         ProfileMetric metric("calculate_statistics");
 
-        // Initialize statistics vectors
-        const int NUM_FEATURES = 4; // income, credit_score, loan_amount, dti_ratio
-        LoanRecord::column_means.resize(NUM_FEATURES, 0.0);
-        LoanRecord::column_stddevs.resize(NUM_FEATURES, 0.0);
+        std::vector<column_stats::ColumnStats> stats(NUM_STAT_FEATURES);
+        accumulate_statistics(columns, stats);
+        finalize_statistics(stats, columns.size());
 
-        std::vector<int> counts(NUM_FEATURES, 0);
-
-// First pass: calculate means
-#pragma omp parallel
-        {
-            // Thread-local sums and counts
-            std::vector<double> local_sums(NUM_FEATURES, 0.0);
-            std::vector<int> local_counts(NUM_FEATURES, 0);
-
-#pragma omp for schedule(static)
-            for (size_t i = 0; i < records.size(); i++)
-            {
-                const LoanRecord &record = records[i];
-
-                // For each numerical feature, add to local sum if valid
-                if (!std::isnan(record.income) && record.income > 0)
-                {
-                    local_sums[0] += record.income;
-                    local_counts[0]++;
-                }
-
-                if (record.credit_score > 0)
-                {
-                    local_sums[1] += record.credit_score;
-                    local_counts[1]++;
-                }
-
-                if (!std::isnan(record.loan_amount) && record.loan_amount > 0)
-                {
-                    local_sums[2] += record.loan_amount;
-                    local_counts[2]++;
-                }
-
-                if (!std::isnan(record.dti_ratio) && record.dti_ratio > 0)
-                {
-                    local_sums[3] += record.dti_ratio;
-                    local_counts[3]++;
-                }
-            }
+        metric.end();
+        profile_data.push_back(metric);
+    }
 
-// Combine results using reduction
-#pragma omp critical
-            {
-                for (int j = 0; j < NUM_FEATURES; j++)
-                {
-                    LoanRecord::column_means[j] += local_sums[j];
-                    counts[j] += local_counts[j];
-                }
-            }
-        }
+    void Dataset::accumulate_statistics(const LoanColumns &rows, std::vector<column_stats::ColumnStats> &stats, bool parallel) const
+    {
+        const size_t n = rows.size();
+        const size_t num_blocks = (n + STATS_BLOCK_ROWS - 1) / STATS_BLOCK_ROWS;
+        const int num_threads = parallel ? omp_get_max_threads() : 1;
 
-        // Calculate final means
-        for (int j = 0; j < NUM_FEATURES; j++)
-        {
-            if (counts[j] > 0)
-            {
-                LoanRecord::column_means[j] /= counts[j];
-            }
-        }
+        // One partial summary per thread and column, merged pairwise below
+        std::vector<std::vector<column_stats::ColumnStats>> partials(
+            NUM_STAT_FEATURES, std::vector<column_stats::ColumnStats>(num_threads));
 
-// Second pass: calculate standard deviations
-#pragma omp parallel
+#pragma omp parallel num_threads(num_threads) if (parallel)
         {
-            std::vector<double> local_var_sums(NUM_FEATURES, 0.0);
-            std::vector<int> local_counts(NUM_FEATURES, 0);
+            const int t = omp_get_thread_num();
 
 #pragma omp for schedule(static)
-            for (size_t i = 0; i < records.size(); i++)
+            for (size_t b = 0; b < num_blocks; b++)
             {
-                const LoanRecord &record = records[i];
-
-                if (!std::isnan(record.income) && record.income > 0)
-                {
-                    double diff = record.income - LoanRecord::column_means[0];
-                    local_var_sums[0] += diff * diff;
-                    local_counts[0]++;
-                }
-
-                if (record.credit_score > 0)
-                {
-                    double diff = record.credit_score - LoanRecord::column_means[1];
-                    local_var_sums[1] += diff * diff;
-                    local_counts[1]++;
-                }
-
-                if (!std::isnan(record.loan_amount) && record.loan_amount > 0)
-                {
-                    double diff = record.loan_amount - LoanRecord::column_means[2];
-                    local_var_sums[2] += diff * diff;
-                    local_counts[2]++;
-                }
-
-                if (!std::isnan(record.dti_ratio) && record.dti_ratio > 0)
-                {
-                    double diff = record.dti_ratio - LoanRecord::column_means[3];
-                    local_var_sums[3] += diff * diff;
-                    local_counts[3]++;
-                }
+                const size_t begin = b * STATS_BLOCK_ROWS;
+                const size_t end = std::min(n, begin + STATS_BLOCK_ROWS);
+                partials[0][t].addBlock(rows.income.data(), rows.income_valid.data(), begin, end);
+                partials[1][t].addBlock(rows.credit_score.data(), rows.credit_score_valid.data(), begin, end);
+                partials[2][t].addBlock(rows.loan_amount.data(), rows.loan_amount_valid.data(), begin, end);
+                partials[3][t].addBlock(rows.dti_ratio.data(), rows.dti_ratio_valid.data(), begin, end);
             }
+        }
 
-// Combine results
-#pragma omp critical
-            {
-                for (int j = 0; j < NUM_FEATURES; j++)
-                {
-                    LoanRecord::column_stddevs[j] += local_var_sums[j];
-                }
-            }
+        for (int j = 0; j < NUM_STAT_FEATURES; j++)
+        {
+            stats[j].merge(column_stats::ColumnStats::mergeAll(std::move(partials[j])));
         }
+    }
 
-        // Calculate final standard deviations
-        for (int j = 0; j < NUM_FEATURES; j++)
+    void Dataset::finalize_statistics(const std::vector<column_stats::ColumnStats> &stats, size_t rows)
+    {
+        feature_stats = stats;
+        stats_rows = rows;
+        LoanRecord::column_means.assign(NUM_STAT_FEATURES, 0.0);
+        LoanRecord::column_stddevs.assign(NUM_STAT_FEATURES, 1.0);
+        for (int j = 0; j < NUM_STAT_FEATURES; j++)
         {
-            if (counts[j] > 1)
-            {
-                LoanRecord::column_stddevs[j] = std::sqrt(LoanRecord::column_stddevs[j] / (counts[j] - 1));
-            }
-            else
-            {
-                LoanRecord::column_stddevs[j] = 1.0; // Default to 1.0 to avoid division by zero
-            }
+            LoanRecord::column_means[j] = stats[j].mean();
+            // Default to 1.0 to avoid division by zero downstream
+            LoanRecord::column_stddevs[j] = stats[j].count() > 1 ? stats[j].sampleStddev() : 1.0;
         }
 
         std::cout << "Statistics calculation complete:" << std::endl;
@@ -278,138 +461,170 @@ bool Dataset::load_from_file(const std::string &filename)
         std::cout << "DTI Ratio: " << LoanRecord::column_stddevs[3];
         std::cout << std::endl;
 
-        metric.end();
-        profile_data.push_back(metric);
+        const char *names[NUM_STAT_FEATURES] = {"Income", "Credit Score", "Loan Amount", "DTI Ratio"};
+        std::cout << "Column ranges (min / p25 / median / p75 / max):" << std::endl;
+        for (int j = 0; j < NUM_STAT_FEATURES; j++)
+        {
+            if (stats[j].count() == 0)
+            {
+                continue;
+            }
+            std::cout << "  " << names[j] << ": " << stats[j].min() << " / " << stats[j].quantile(0.25) << " / "
+                      << stats[j].median() << " / " << stats[j].quantile(0.75) << " / " << stats[j].max() << std::endl;
+        }
     }
 
     void Dataset::encode_categorical_variables()
     {
         ProfileMetric metric("encode_categorical");
 
-        // Check for employment status encoding
         int missing_employment = 0;
-#pragma omp parallel for reduction(+ : missing_employment)
-        for (size_t i = 0; i < records.size(); i++)
-        {
-            if (records[i].employment_status < 0)
-            {
-                missing_employment++;
-            }
-        }
+        int missing_approval = 0;
+        count_missing_categorical(columns, missing_employment, missing_approval);
+        report_missing_categorical(missing_employment, missing_approval);
 
+        metric.end();
+        profile_data.push_back(metric);
+    }
+
+    void Dataset::count_missing_categorical(const LoanColumns &rows, int &missing_employment, int &missing_approval) const
+    {
+        missing_employment = static_cast<int>(rows.size() - rows.employment_status_valid.count());
+        missing_approval = static_cast<int>(rows.size() - rows.approval_valid.count());
+    }
+
+    void Dataset::report_missing_categorical(int missing_employment, int missing_approval) const
+    {
         if (missing_employment > 0)
         {
             std::cout << "Warning: " << missing_employment
                       << " records with missing employment status" << std::endl;
         }
 
-        // Check for approval encoding
-        int missing_approval = 0;
-#pragma omp parallel for reduction(+ : missing_approval)
-        for (size_t i = 0; i < records.size(); i++)
-        {
-            if (records[i].approval < 0)
-            {
-                missing_approval++;
-            }
-        }
-
         if (missing_approval > 0)
         {
             std::cout << "Warning: " << missing_approval
                       << " records with missing approval status" << std::endl;
         }
+    }
+
+    void Dataset::impute_missing_values()
+    {
+        ProfileMetric metric("impute_missing");
 
+        impute_columns(columns);
+
+        std::cout << "Missing value imputation complete" << std::endl;
         metric.end();
         profile_data.push_back(metric);
     }
 
-    void Dataset::impute_missing_values()
+    void Dataset::impute_columns(LoanColumns &rows, bool parallel) const
     {
-        ProfileMetric metric("impute_missing");
+        // Numerical columns take the column mean; credit scores are rounded
+        // to an integer in the valid credit score range
+        const int credit_fill = std::max(300, std::min(850, static_cast<int>(std::round(LoanRecord::column_means[1]))));
+        impute_column(rows.income, rows.income_valid, LoanRecord::column_means[0], parallel);
+        impute_column<int32_t>(rows.credit_score, rows.credit_score_valid, credit_fill, parallel);
+        impute_column(rows.loan_amount, rows.loan_amount_valid, LoanRecord::column_means[2], parallel);
+        impute_column(rows.dti_ratio, rows.dti_ratio_valid, LoanRecord::column_means[3], parallel);
+
+        // Missing employment defaults to employed (most common), missing
+        // approval to rejected (safer assumption)
+        impute_column<int32_t>(rows.employment_status, rows.employment_status_valid, 1, parallel);
+        impute_column<int32_t>(rows.approval, rows.approval_valid, 0, parallel);
+    }
+    
+    void Dataset::save_binary(const std::string &filename) const
+    {
+        binary_dataset::DatasetWriter writer(filename, loan_columns(), columns.size(), LABEL_COLUMN);
+        append_binary(writer, columns);
+        writer.finish();
+    }
 
-// Impute missing values in parallel
-#pragma omp parallel for
-        for (size_t i = 0; i < records.size(); i++)
+    void Dataset::save_transform(const std::string &filename) const
+    {
+        if (feature_stats.size() != static_cast<size_t>(NUM_STAT_FEATURES))
         {
-            LoanRecord &record = records[i];
-
-            // Impute income if missing
-            if (std::isnan(record.income) || record.income <= 0)
-            {
-                record.income = LoanRecord::column_means[0];
-            }
+            throw std::runtime_error("No statistics to save. Preprocess data first.");
+        }
 
-            // Impute credit score if missing
-            if (record.credit_score <= 0)
+        // One entry per output feature, in output column order (the label is
+        // not a feature)
+        std::vector<feature_transform::FeatureParams> features(loan_columns().size() - 1);
+        for (int j = 0; j < NUM_STAT_FEATURES; j++)
+        {
+            features[j].offset = static_cast<float>(LoanRecord::column_means[j]);
+            features[j].scale = static_cast<float>(1.0 / LoanRecord::column_stddevs[j]);
+            if (feature_stats[j].count() > 0)
             {
-                // Round to nearest integer since credit scores are integers
-                record.credit_score = static_cast<int>(std::round(LoanRecord::column_means[1]));
-                // Ensure it's in a valid range for credit scores
-                record.credit_score = std::max(300, std::min(850, record.credit_score));
+                features[j].lower = static_cast<float>(feature_stats[j].min());
+                features[j].upper = static_cast<float>(feature_stats[j].max());
             }
+        }
 
-            // Impute loan amount if missing
-            if (std::isnan(record.loan_amount) || record.loan_amount <= 0)
-            {
-                record.loan_amount = LoanRecord::column_means[2];
-            }
+        feature_transform::writeTransform(filename, features, stats_rows);
+        std::cout << "Saved feature transform for " << features.size() << " features to " << filename << std::endl;
+    }
 
-            // Impute DTI ratio if missing
-            if (std::isnan(record.dti_ratio) || record.dti_ratio <= 0)
-            {
-                record.dti_ratio = LoanRecord::column_means[3];
-            }
+    void Dataset::append_binary(binary_dataset::DatasetWriter &writer, const LoanColumns &rows) const
+    {
+        // Continuous values are stored as float32; the int32 columns go out
+        // as they are, so the label and categorical codes stay exact
+        const size_t n = rows.size();
+        std::vector<float> income(rows.income.begin(), rows.income.end());
+        std::vector<float> loan_amount(rows.loan_amount.begin(), rows.loan_amount.end());
+        std::vector<float> dti_ratio(rows.dti_ratio.begin(), rows.dti_ratio.end());
+
+        writer.append({income.data(), rows.credit_score.data(), loan_amount.data(),
+                       dti_ratio.data(), rows.employment_status.data(), rows.approval.data()},
+                      n);
+    }
 
-            // Impute employment status if missing - use most common value
-            if (record.employment_status < 0)
-            {
-                record.employment_status = 1; // Default to employed (most common)
-            }
+    void Dataset::write_csv_header(std::ostream &out) const
+    {
+        out << "Income,Credit_Score,Loan_Amount,DTI_Ratio,Employment_Status,Approval\n";
+    }
 
-            // Impute approval if missing
-            if (record.approval < 0)
-            {
-                record.approval = 0; // Default to rejected (safer assumption)
-            }
+    void Dataset::write_csv_rows(std::ostream &out, const LoanColumns &rows) const
+    {
+        // Format a block of rows at a time and hand it over in one write
+        std::string block;
+        for (size_t begin = 0; begin < rows.size(); begin += CSV_BLOCK_ROWS)
+        {
+            block.clear();
+            format_csv_rows(rows, begin, std::min(rows.size(), begin + CSV_BLOCK_ROWS), block);
+            out.write(block.data(), static_cast<std::streamsize>(block.size()));
         }
-
-        std::cout << "Missing value imputation complete" << std::endl;
-        metric.end();
-        profile_data.push_back(metric);
     }
-    
-    void Dataset::save_to_file(const std::string &filename)
+
+    void Dataset::save_to_file(const std::string &filename, OutputFormat format)
     {
         ProfileMetric metric("save_file");
     
         try
         {
+            if (format == OutputFormat::Binary)
+            {
+                save_binary(filename);
+                std::cout << "Saved " << columns.size() << " records to " << filename
+                          << " (binary columnar format)" << std::endl;
+
+                metric.end();
+                std::cout << "Save file time: " << (metric.end_time - metric.start_time) << " seconds" << std::endl;
+                return;
+            }
+
             std::ofstream file(filename);
             if (!file.is_open())
             {
                 throw std::runtime_error("Could not open output file: " + filename);
             }
     
-            // Write header
-            file << "Income,Credit_Score,Loan_Amount,DTI_Ratio,Employment_Status,Approval";
-            file << std::endl;
+            write_csv_header(file);
+            write_csv_rows(file, columns);
     
-            // Write data rows with numeric values (ideal for model training)
-            for (const auto &record : records)
-            {
-                file << std::fixed << std::setprecision(6)
-                     << record.income << ","
-                     << record.credit_score << ","
-                     << record.loan_amount << ","
-                     << record.dti_ratio << ","
-                     << record.employment_status << ","
-                     << record.approval;
-                
-                file << std::endl;
-            }
-    
-            std::cout << "Saved " << records.size() << " records to " << filename << std::endl;
+            std::cout << "Saved " << columns.size() << " records to " << filename << std::endl;
     
             metric.end();
             std::cout << "Save file time: " << (metric.end_time - metric.start_time) << " seconds" << std::endl;
@@ -422,15 +637,403 @@ bool Dataset::load_from_file(const std::string &filename)
         }
     }
 
+    bool Dataset::stream_to_file(const std::string &input_file, const std::string &output_file,
+                                 OutputFormat format, size_t chunk_rows)
+    {
+        chunk_rows = std::max<size_t>(1, chunk_rows);
+
+        std::string employment_status, approval_status;
+        double income, loan_amount, dti_ratio;
+        int credit_score;
+
+        // Refill columns with the next chunk_rows rows; false at end of input
+        auto read_chunk = [&](LoanCsvReader &reader)
+        {
+            columns.clear();
+            while (columns.size() < chunk_rows &&
+                   reader.read_row(income, credit_score, loan_amount, dti_ratio, employment_status, approval_status))
+            {
+                LoanRecord record;
+                record.income = income;
+                record.credit_score = credit_score;
+                record.loan_amount = loan_amount;
+                record.dti_ratio = dti_ratio;
+
+                encode_categorical_vars(record, employment_status, approval_status);
+                columns.append(record);
+            }
+            return !columns.empty();
+        };
+
+        try
+        {
+            columns.reserve(chunk_rows);
+
+            // Pass 1: merge per-chunk statistics and count the rows
+            ProfileMetric stats_metric("stream_statistics");
+            std::vector<column_stats::ColumnStats> stats(NUM_STAT_FEATURES);
+            size_t total_rows = 0;
+            int missing_employment = 0;
+            int missing_approval = 0;
+            {
+                auto reader = open_loan_csv(input_file);
+                while (read_chunk(*reader))
+                {
+                    accumulate_statistics(columns, stats);
+
+                    int chunk_employment = 0, chunk_approval = 0;
+                    count_missing_categorical(columns, chunk_employment, chunk_approval);
+                    missing_employment += chunk_employment;
+                    missing_approval += chunk_approval;
+                    total_rows += columns.size();
+                }
+            }
+            if (total_rows == 0)
+            {
+                throw std::runtime_error("No data to preprocess in " + input_file);
+            }
+
+            std::cout << "Scanned " << total_rows << " records in chunks of " << chunk_rows << std::endl;
+            finalize_statistics(stats, total_rows);
+            report_missing_categorical(missing_employment, missing_approval);
+            stats_metric.end();
+            profile_data.push_back(stats_metric);
+
+            // Pass 2: impute and write each chunk
+            ProfileMetric write_metric("stream_impute_write");
+            std::unique_ptr<binary_dataset::DatasetWriter> writer;
+            std::ofstream csv_file;
+            if (format == OutputFormat::Binary)
+            {
+                writer = std::make_unique<binary_dataset::DatasetWriter>(output_file, loan_columns(), total_rows, LABEL_COLUMN);
+            }
+            else
+            {
+                csv_file.open(output_file);
+                if (!csv_file.is_open())
+                {
+                    throw std::runtime_error("Could not open output file: " + output_file);
+                }
+                write_csv_header(csv_file);
+            }
+
+            size_t written = 0;
+            auto reader = open_loan_csv(input_file);
+            while (read_chunk(*reader))
+            {
+                impute_columns(columns);
+                if (writer)
+                {
+                    append_binary(*writer, columns);
+                }
+                else
+                {
+                    write_csv_rows(csv_file, columns);
+                }
+                written += columns.size();
+            }
+            if (written != total_rows)
+            {
+                throw std::runtime_error("Input file changed between passes: " + input_file);
+            }
+
+            if (writer)
+            {
+                writer->finish();
+            }
+            else if (!csv_file.flush())
+            {
+                throw std::runtime_error("Failed writing output file: " + output_file);
+            }
+            columns.clear();
+
+            std::cout << "Missing value imputation complete" << std::endl;
+            std::cout << "Saved " << written << " records to " << output_file
+                      << (writer ? " (binary columnar format)" : "") << std::endl;
+
+            write_metric.end();
+            profile_data.push_back(write_metric);
+            return true;
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Error streaming " << input_file << ": " << e.what() << std::endl;
+            columns.clear();
+            return false;
+        }
+    }
+
+    bool Dataset::pipeline_to_file(const std::string &input_file, const std::string &output_file,
+                                   OutputFormat format, size_t chunk_rows)
+    {
+        chunk_rows = std::max<size_t>(1, chunk_rows);
+
+        // First failure in any stage; aborting every queue unblocks the rest
+        std::mutex error_mutex;
+        std::exception_ptr error;
+        std::vector<std::function<void()>> abort_queues;
+        auto guarded = [&](std::function<void()> body)
+        {
+            return [&, body]()
+            {
+                try
+                {
+                    body();
+                }
+                catch (...)
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(error_mutex);
+                        if (!error)
+                        {
+                            error = std::current_exception();
+                        }
+                    }
+                    for (auto &abort_queue : abort_queues)
+                    {
+                        abort_queue();
+                    }
+                }
+            };
+        };
+
+        // Source stage: parse raw rows into chunks
+        auto parse = [&](BoundedQueue<RawChunk> &out, ProfileMetric &metric)
+        {
+            auto reader = open_loan_csv(input_file);
+            while (true)
+            {
+                double started = omp_get_wtime();
+                RawChunk chunk(chunk_rows);
+                size_t rows = 0;
+                while (rows < chunk_rows)
+                {
+                    RawLoanRow &row = chunk[rows];
+                    if (!reader->read_row(row.income, row.credit_score, row.loan_amount, row.dti_ratio,
+                                          row.employment_status, row.approval))
+                    {
+                        break;
+                    }
+                    rows++;
+                }
+                chunk.resize(rows);
+                double finished = omp_get_wtime();
+                metric.busy_time += finished - started;
+
+                if (rows == 0 || !out.push(std::move(chunk)))
+                {
+                    break;
+                }
+                metric.stall_time += omp_get_wtime() - finished;
+            }
+            out.close();
+        };
+
+        auto encode = [this](RawChunk chunk)
+        {
+            RecordChunk rows;
+            rows.reserve(chunk.size());
+            for (const RawLoanRow &row : chunk)
+            {
+                LoanRecord record;
+                record.income = row.income;
+                record.credit_score = row.credit_score;
+                record.loan_amount = row.loan_amount;
+                record.dti_ratio = row.dti_ratio;
+                encode_categorical_vars(record, row.employment_status, row.approval);
+                rows.append(record);
+            }
+            return rows;
+        };
+
+        auto make_metric = [](const std::string &name)
+        {
+            ProfileMetric metric(name);
+            metric.tracks_stalls = true;
+            return metric;
+        };
+
+        auto report = [&](std::vector<ProfileMetric> &metrics)
+        {
+            for (auto &metric : metrics)
+            {
+                metric.end();
+                // Formatted locally so std::cout keeps its default float format
+                std::ostringstream line;
+                line << "  " << std::left << std::setw(22) << metric.stage_name << std::right
+                     << std::fixed << std::setprecision(3)
+                     << " busy " << std::setw(8) << metric.busy_time << " s"
+                     << "  stall " << std::setw(8) << metric.stall_time << " s";
+                std::cout << line.str() << std::endl;
+                profile_data.push_back(metric);
+            }
+        };
+
+        try
+        {
+            // Pass 1: parse -> encode -> statistics
+            std::vector<column_stats::ColumnStats> stats(NUM_STAT_FEATURES);
+            size_t total_rows = 0;
+            int missing_employment = 0;
+            int missing_approval = 0;
+            {
+                BoundedQueue<RawChunk> raw(PIPELINE_QUEUE_DEPTH);
+                BoundedQueue<RecordChunk> encoded(PIPELINE_QUEUE_DEPTH);
+                abort_queues = {[&]() { raw.abort(); }, [&]() { encoded.abort(); }};
+                std::vector<ProfileMetric> metrics = {make_metric("pass1_parse"), make_metric("pass1_encode"),
+                                                      make_metric("pass1_statistics")};
+
+                std::thread parse_thread(guarded([&]() { parse(raw, metrics[0]); }));
+                std::thread encode_thread(guarded([&]() { run_pipeline_stage(raw, encoded, metrics[1], encode); }));
+                guarded([&]()
+                {
+                    run_pipeline_sink(encoded, metrics[2], [&](const RecordChunk &chunk)
+                    {
+                        accumulate_statistics(chunk, stats, false);
+
+                        int chunk_employment = 0, chunk_approval = 0;
+                        count_missing_categorical(chunk, chunk_employment, chunk_approval);
+                        missing_employment += chunk_employment;
+                        missing_approval += chunk_approval;
+                        total_rows += chunk.size();
+                    });
+                })();
+                parse_thread.join();
+                encode_thread.join();
+                abort_queues.clear();
+                if (error)
+                {
+                    std::rethrow_exception(error);
+                }
+
+                if (total_rows == 0)
+                {
+                    throw std::runtime_error("No data to preprocess in " + input_file);
+                }
+                std::cout << "Scanned " << total_rows << " records in chunks of " << chunk_rows << std::endl;
+                std::cout << "Pass 1 stages:" << std::endl;
+                report(metrics);
+            }
+
+            finalize_statistics(stats, total_rows);
+            report_missing_categorical(missing_employment, missing_approval);
+
+            // Pass 2: parse -> encode -> impute -> format -> write
+            std::unique_ptr<binary_dataset::DatasetWriter> writer;
+            std::ofstream csv_file;
+            if (format == OutputFormat::Binary)
+            {
+                writer = std::make_unique<binary_dataset::DatasetWriter>(output_file, loan_columns(), total_rows, LABEL_COLUMN);
+            }
+            else
+            {
+                csv_file.open(output_file);
+                if (!csv_file.is_open())
+                {
+                    throw std::runtime_error("Could not open output file: " + output_file);
+                }
+                write_csv_header(csv_file);
+            }
+
+            size_t written = 0;
+            {
+                BoundedQueue<RawChunk> raw(PIPELINE_QUEUE_DEPTH);
+                BoundedQueue<RecordChunk> encoded(PIPELINE_QUEUE_DEPTH);
+                BoundedQueue<RecordChunk> imputed(PIPELINE_QUEUE_DEPTH);
+                BoundedQueue<FormattedChunk> formatted(PIPELINE_QUEUE_DEPTH);
+                abort_queues = {[&]() { raw.abort(); }, [&]() { encoded.abort(); },
+                                [&]() { imputed.abort(); }, [&]() { formatted.abort(); }};
+                std::vector<ProfileMetric> metrics = {make_metric("pass2_parse"), make_metric("pass2_encode"),
+                                                      make_metric("pass2_impute"), make_metric("pass2_format"),
+                                                      make_metric("pass2_write")};
+
+                auto impute = [this](RecordChunk chunk)
+                {
+                    impute_columns(chunk, false);
+                    return chunk;
+                };
+                auto format_chunk = [&](RecordChunk chunk)
+                {
+                    FormattedChunk result;
+                    result.rows = chunk.size();
+                    if (writer)
+                    {
+                        result.records = std::move(chunk);
+                    }
+                    else
+                    {
+                        format_csv_rows(chunk, 0, chunk.size(), result.text);
+                    }
+                    return result;
+                };
+
+                std::thread parse_thread(guarded([&]() { parse(raw, metrics[0]); }));
+                std::thread encode_thread(guarded([&]() { run_pipeline_stage(raw, encoded, metrics[1], encode); }));
+                std::thread impute_thread(guarded([&]() { run_pipeline_stage(encoded, imputed, metrics[2], impute); }));
+                std::thread format_thread(guarded([&]() { run_pipeline_stage(imputed, formatted, metrics[3], format_chunk); }));
+                guarded([&]()
+                {
+                    run_pipeline_sink(formatted, metrics[4], [&](const FormattedChunk &chunk)
+                    {
+                        if (writer)
+                        {
+                            append_binary(*writer, chunk.records);
+                        }
+                        else
+                        {
+                            csv_file.write(chunk.text.data(), static_cast<std::streamsize>(chunk.text.size()));
+                        }
+                        written += chunk.rows;
+                    });
+                })();
+                parse_thread.join();
+                encode_thread.join();
+                impute_thread.join();
+                format_thread.join();
+                abort_queues.clear();
+                if (error)
+                {
+                    std::rethrow_exception(error);
+                }
+
+                std::cout << "Pass 2 stages:" << std::endl;
+                report(metrics);
+            }
+
+            if (written != total_rows)
+            {
+                throw std::runtime_error("Input file changed between passes: " + input_file);
+            }
+            if (writer)
+            {
+                writer->finish();
+            }
+            else if (!csv_file.flush())
+            {
+                throw std::runtime_error("Failed writing output file: " + output_file);
+            }
+
+            std::cout << "Missing value imputation complete" << std::endl;
+            std::cout << "Saved " << written << " records to " << output_file
+                      << (writer ? " (binary columnar format)" : "") << std::endl;
+            return true;
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Error in pipeline for " << input_file << ": " << e.what() << std::endl;
+            return false;
+        }
+    }
+
     void Dataset::print_sample(int sample_size) const
     {
-        if (records.empty())
+        if (columns.empty())
         {
             std::cout << "No data to display." << std::endl;
             return;
         }
 
-        int max_rows = std::min(static_cast<size_t>(sample_size), records.size());
+        int max_rows = std::min(static_cast<size_t>(sample_size), columns.size());
 
         std::cout << "\nDataset Sample (first " << max_rows << " records):" << std::endl;
         std::cout << "-------------------------------------------------------------------------" << std::endl;
@@ -447,15 +1050,13 @@ bool Dataset::load_from_file(const std::string &filename)
 
         for (int i = 0; i < max_rows; i++)
         {
-            const auto &record = records[i];
-
             std::cout << std::fixed << std::setprecision(2)
-                      << std::setw(12) << record.income
-                      << std::setw(10) << record.credit_score
-                      << std::setw(12) << record.loan_amount
-                      << std::setw(10) << record.dti_ratio
-                      << std::setw(12) << (record.employment_status == 1 ? "employed" : "unemployed")
-                      << std::setw(10) << (record.approval == 1 ? "Approved" : "Rejected");
+                      << std::setw(12) << columns.income[i]
+                      << std::setw(10) << columns.credit_score[i]
+                      << std::setw(12) << columns.loan_amount[i]
+                      << std::setw(10) << columns.dti_ratio[i]
+                      << std::setw(12) << (columns.employment_status[i] == 1 ? "employed" : "unemployed")
+                      << std::setw(10) << (columns.approval[i] == 1 ? "Approved" : "Rejected");
             std::cout << std::endl;
         }
         std::cout << "-------------------------------------------------------------------------" << std::endl;
@@ -463,13 +1064,13 @@ bool Dataset::load_from_file(const std::string &filename)
     
     void Dataset::print_preprocessed_sample(int sample_size) const
     {
-        if (records.empty())
+        if (columns.empty())
         {
             std::cout << "No data to display." << std::endl;
             return;
         }
     
-        int max_rows = std::min(static_cast<size_t>(sample_size), records.size());
+        int max_rows = std::min(static_cast<size_t>(sample_size), columns.size());
     
         std::cout << "\nPreprocessed Dataset Sample (first " << max_rows << " records) - NUMERIC VALUES:" << std::endl;
         std::cout << "-------------------------------------------------------------------------" << std::endl;
@@ -489,15 +1090,13 @@ bool Dataset::load_from_file(const std::string &filename)
         // Print rows with all numeric values
         for (int i = 0; i < max_rows; i++)
         {
-            const auto &record = records[i];
-    
             std::cout << std::fixed << std::setprecision(2)
-                      << std::setw(12) << record.income
-                      << std::setw(10) << record.credit_score
-                      << std::setw(12) << record.loan_amount
-                      << std::setw(10) << record.dti_ratio
-                      << std::setw(12) << record.employment_status
-                      << std::setw(10) << record.approval;
+                      << std::setw(12) << columns.income[i]
+                      << std::setw(10) << columns.credit_score[i]
+                      << std::setw(12) << columns.loan_amount[i]
+                      << std::setw(10) << columns.dti_ratio[i]
+                      << std::setw(12) << columns.employment_status[i]
+                      << std::setw(10) << columns.approval[i];
     
             std::cout << std::endl;
         }
@@ -515,21 +1114,26 @@ bool Dataset::load_from_file(const std::string &filename)
         int missing_values = 0;
         int invalid_categorical = 0;
         
-        // Check for missing values or invalid categorical encodings
-        #pragma omp parallel for reduction(+:missing_values,invalid_categorical)
-        for (size_t i = 0; i < records.size(); i++)
-        {
-            const auto& record = records[i];
-            
-            // Check numeric fields
-            if (std::isnan(record.income) || record.income <= 0) missing_values++;
-            if (record.credit_score <= 0) missing_values++;
-            if (std::isnan(record.loan_amount) || record.loan_amount <= 0) missing_values++;
-            if (std::isnan(record.dti_ratio) || record.dti_ratio <= 0) missing_values++;
-            
-            // Check categorical fields
-            if (record.employment_status < 0 || record.employment_status > 1) invalid_categorical++;
-            if (record.approval < 0 || record.approval > 1) invalid_categorical++;
+        const size_t n = columns.size();
+
+        // Missing entries are the clear bits of each validity bitmap
+        for (const ValidityBitmap *valid : {&columns.income_valid, &columns.credit_score_valid,
+                                            &columns.loan_amount_valid, &columns.dti_ratio_valid})
+        {
+            missing_values += static_cast<int>(n - valid->count());
+        }
+        for (const ValidityBitmap *valid : {&columns.employment_status_valid, &columns.approval_valid})
+        {
+            invalid_categorical += static_cast<int>(n - valid->count());
+        }
+
+        // Categorical codes must be 0 or 1
+        const int32_t *employment = columns.employment_status.data();
+        const int32_t *approval = columns.approval.data();
+        #pragma omp parallel for simd reduction(+:invalid_categorical)
+        for (size_t i = 0; i < n; i++)
+        {
+            invalid_categorical += (employment[i] < 0 || employment[i] > 1) + (approval[i] < 0 || approval[i] > 1);
         }
         
         if (missing_values > 0 || invalid_categorical > 0) {
@@ -553,7 +1157,7 @@ bool Dataset::load_from_file(const std::string &filename)
             }
 
             // Write header
-            file << "Stage,ThreadID,ThreadCount,StartTime,EndTime,Duration" << std::endl;
+            file << "Stage,ThreadID,ThreadCount,StartTime,EndTime,Duration,BusyTime,StallTime" << std::endl;
 
             // Write profiling data
             for (const auto &metric : profile_data)
@@ -564,7 +1168,9 @@ bool Dataset::load_from_file(const std::string &filename)
                      << std::fixed << std::setprecision(6)
                      << metric.start_time << ","
                      << metric.end_time << ","
-                     << (metric.end_time - metric.start_time) << std::endl;
+                     << (metric.end_time - metric.start_time) << ","
+                     << metric.busy_time << ","
+                     << metric.stall_time << std::endl;
             }
 
             std::cout << "Exported profiling data to " << filename << std::endl;
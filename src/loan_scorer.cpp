@@ -0,0 +1,143 @@
+/**
+ * loan_scorer.cpp - Ensemble loan decision over the three trained models
+ */
+
+ #include "./include/loan_scorer.h"
+ #include "./include/random_forest.h"
+ #include "./include/mlp.h"
+ #include "./include/logistic_regression.h"
+ #include <fstream>
+ #include <iostream>
+ #include <stdexcept>
+
+ using namespace std;
+
+ static string modelPath(const string& dir, const string& name) {
+     return dir.empty() || dir == "." ? name : dir + "/" + name;
+ }
+
+ // Add model to the ensemble if load succeeds; returns its member index or -1
+ template <typename Model, typename Load>
+ static int addModel(Ensemble& ensemble, const string& name, unique_ptr<Model> model, float weight, Load load) {
+     try {
+         load(*model);
+     } catch (const exception& e) {
+         cerr << "Error loading " << name << " model: " << e.what() << endl;
+         return -1;
+     }
+     ensemble.addMember(name, move(model), weight);
+     return ensemble.size() - 1;
+ }
+
+ // Architectures match the training configuration in main_model.cpp
+ LoanScorer::LoanScorer(const string& modelDir, const ScorerOptions& options)
+     : borderlineMargin(options.borderlineMargin) {
+     rfMember = addModel(ensemble, "Random Forest", make_unique<RandomForest>(5, 10, 5, LOAN_FEATURES),
+                         options.rfWeight, [&](RandomForest& rf) {
+         rf.loadModel(modelPath(modelDir, "random_forest_model.bin"), 0);
+     });
+     mlpMember = addModel(ensemble, "MLP", make_unique<MLP>(LOAN_FEATURES, vector<int>{16, 8}, 2),
+                          options.mlpWeight, [&](MLP& mlp) {
+         mlp.loadModel(modelPath(modelDir, "mlp_model.bin"));
+     });
+     lrMember = addModel(ensemble, "Logistic Regression", make_unique<LogisticRegression>(LOAN_FEATURES),
+                         options.lrWeight, [&](LogisticRegression& lr) {
+         // loadModel only reports a missing file, so check first
+         const string path = modelPath(modelDir, "logistic_regression_model.bin");
+         if (!ifstream(path, ios::binary)) {
+             throw runtime_error("Cannot open " + path);
+         }
+         lr.loadModel(path);
+     });
+
+     // Loaded models whose weights are all zero would leave nothing to average
+     if (anyModelLoaded()) {
+         vector<float> weights = ensemble.weights();
+         try {
+             ensemble.setWeights(weights);
+         } catch (const exception& e) {
+             cerr << "Warning: " << e.what() << "; using equal weights" << endl;
+             ensemble.setWeights(vector<float>(weights.size(), 1.0f));
+         }
+     }
+
+     const string stackerFile = modelPath(modelDir, DEFAULT_STACKER_FILE);
+     if (options.useStacker && anyModelLoaded() && ifstream(stackerFile, ios::binary)) {
+         try {
+             ensemble.loadStacker(stackerFile);
+         } catch (const exception& e) {
+             cerr << "Warning: " << e.what() << "; using weighted soft voting" << endl;
+         }
+     }
+
+     // Without the preprocessor's transform the models get raw feature
+     // values, which is what hybrid_ml_trainer trains on with --transform none
+     const string transformFile = modelPath(modelDir, feature_transform::DEFAULT_TRANSFORM_FILE);
+     try {
+         transform = make_unique<feature_transform::FeatureTransform>(transformFile);
+         if (transform->numFeatures() != LOAN_FEATURES) {
+             throw runtime_error(transformFile + " has " + to_string(transform->numFeatures()) +
+                                 " features, expected " + to_string(LOAN_FEATURES));
+         }
+     } catch (const exception& e) {
+         cerr << "Warning: " << e.what() << "; using raw feature values" << endl;
+         transform.reset();
+     }
+ }
+
+ vector<float> LoanScorer::transformed(const float* raw, int n) const {
+     vector<float> features(raw, raw + static_cast<size_t>(n) * LOAN_FEATURES);
+     if (transform) {
+         transform->apply(features.data(), features.data(), n);
+     }
+     return features;
+ }
+
+ vector<LoanDecision> LoanScorer::scoreBatch(const float* raw, int n) {
+     vector<LoanDecision> decisions(n);
+     if (n <= 0 || !anyModelLoaded()) {
+         return decisions;
+     }
+
+     // One inference per model gives both the votes and the combined score
+     const int M = ensemble.size();
+     vector<float> features = transformed(raw, n);
+     vector<float> combined(n), memberProbs(static_cast<size_t>(n) * M);
+     ensemble.predictProba(features.data(), n, LOAN_FEATURES, combined.data(), memberProbs.data());
+
+     auto vote = [](const float* probs, int member) {
+         return member < 0 ? -1 : probs[member] > 0.5f ? 1 : 0;
+     };
+     for (int i = 0; i < n; ++i) {
+         LoanDecision& d = decisions[i];
+         const float* probs = memberProbs.data() + static_cast<size_t>(i) * M;
+         d.rfVote = vote(probs, rfMember);
+         d.mlpVote = vote(probs, mlpMember);
+         d.lrVote = vote(probs, lrMember);
+
+         const float p = combined[i];
+         d.outcome = p > 0.5f + borderlineMargin ? LoanOutcome::Approved
+                   : p < 0.5f - borderlineMargin ? LoanOutcome::NotApproved
+                   : LoanOutcome::Borderline;
+         d.riskScore = p * 100.0f;
+     }
+     return decisions;
+ }
+
+ void LoanScorer::fitStacker(const float* raw, const int* labels, int n, const string& filename) {
+     if (!anyModelLoaded()) {
+         throw runtime_error("No models loaded to stack");
+     }
+     vector<float> features = transformed(raw, n);
+     ensemble.fitStacker(features.data(), labels, n, LOAN_FEATURES);
+     ensemble.saveStacker(filename);
+ }
+
+ string outcomeText(LoanOutcome outcome) {
+     switch (outcome) {
+         case LoanOutcome::Approved: return "Approved";
+         case LoanOutcome::Borderline: return "Borderline - Additional Review Required";
+         case LoanOutcome::NotApproved: return "Not Approved";
+         default: return "Could not make predictions with available models";
+     }
+ }
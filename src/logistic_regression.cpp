@@ -8,11 +8,26 @@
  #include "./include/omp_config.h"
  #include <algorithm>
  #include <cassert>
+ #include <stdexcept>
+ #include <string>
+ #include "./include/simd_kernels.h"
  
  using namespace std;
  
- LogisticRegression::LogisticRegression(int numFeatures, float learningRate, int maxIterations)
-     : numFeatures(numFeatures), learningRate(learningRate), maxIterations(maxIterations), bias(0.0f) {
+ // Rows per batched logit/sigmoid call; sized so a block of logits and its
+ // rows stay in L1/L2
+ static constexpr int LOGIT_BLOCK = 256;
+ 
+ // L-BFGS settings: correction pairs kept, backtracking steps per line
+ // search and the Armijo sufficient-decrease constant
+ static constexpr int LBFGS_HISTORY = 5;
+ static constexpr int LBFGS_MAX_LINE_SEARCH = 20;
+ static constexpr float LBFGS_ARMIJO = 1e-4f;
+ 
+ LogisticRegression::LogisticRegression(int numFeatures, float learningRate, int maxIterations,
+                                        LRSolver solver, float tolerance)
+     : numFeatures(numFeatures), learningRate(learningRate), maxIterations(maxIterations),
+       solver(solver), tolerance(tolerance), bias(0.0f) {
  
      setup_openmp_threads();
      
@@ -31,93 +46,164 @@
  }
  
  float LogisticRegression::sigmoid(float x) {
-     return 1.0f / (1.0f + exp(-x));
+     return kernels::sigmoid(x);
+ }
+ 
+ // Size the per-thread arena: each slot holds numFeatures gradient
+ // entries, the bias gradient and the loss, rounded up to a whole number of
+ // cache lines so neighbouring threads never write to the same line
+ void LogisticRegression::allocateGradientArena(int numThreads) {
+     const int floatsPerLine = 64 / sizeof(float);
+     arenaStride = (numFeatures + 2 + floatsPerLine - 1) / floatsPerLine * floatsPerLine;
+     arenaThreads = numThreads;
+     gradientArena.assign(static_cast<size_t>(arenaStride) * numThreads, 0.0f);
+     gradient.assign(numFeatures + 1, 0.0f);
  }
  
- vector<float> LogisticRegression::computeGradient(const vector<float>& X, const vector<int>& y, 
-                                                int numSamples, int numFeatures) {
-     vector<float> gradient(numFeatures, 0.0f);
-     float biasGradient = 0.0f;
+ const float* LogisticRegression::accumulateGradient(FloatSpan X, LabelSpan y,
+                                                    int numSamples, int numFeatures, bool withLoss) {
+     const int maxThreads = omp_get_max_threads();
+     if (arenaThreads < maxThreads || static_cast<int>(gradient.size()) != numFeatures + 1) {
+         allocateGradientArena(maxThreads);
+     }
      
      // Parallelize the gradient computation over samples
      #pragma omp parallel
      {
-         vector<float> threadGradient(numFeatures, 0.0f);
+         const int tid = omp_get_thread_num();
+         const int numThreads = omp_get_num_threads();
+         float* slot = gradientArena.data() + static_cast<size_t>(tid) * arenaStride;
+         fill(slot, slot + arenaStride, 0.0f);
          float threadBiasGradient = 0.0f;
+         double threadLoss = 0.0;
+         float logits[LOGIT_BLOCK];
+         float predictions[LOGIT_BLOCK];
          
-         #pragma omp for
-         for (int i = 0; i < numSamples; ++i) {
-             // Compute prediction
-             float logit = bias;
-             for (int j = 0; j < numFeatures; ++j) {
-                 logit += weights[j] * X[i * numFeatures + j];
-             }
-             float prediction = sigmoid(logit);
+         #pragma omp for nowait
+         for (int start = 0; start < numSamples; start += LOGIT_BLOCK) {
+             const int count = min(LOGIT_BLOCK, numSamples - start);
+             const float* block = X.data() + static_cast<size_t>(start) * numFeatures;
              
-             // Compute error
-             float error = prediction - y[i];
+             // Compute predictions for the whole block
+             kernels::logits(block, count, numFeatures, weights.data(), bias, logits);
+             kernels::sigmoid(logits, predictions, count);
              
-             // Accumulate gradients
-             threadBiasGradient += error;
-             for (int j = 0; j < numFeatures; ++j) {
-                 threadGradient[j] += error * X[i * numFeatures + j];
+             for (int i = 0; i < count; ++i) {
+                 // Compute error and binary cross-entropy loss in the same pass
+                 const int label = y[start + i];
+                 float error = predictions[i] - label;
+                 if (withLoss) {
+                     // -log(sigmoid(+-z)) written as softplus(-+z), so the loss
+                     // stays smooth and consistent with the gradient for large |z|
+                     float z = label == 1 ? -logits[i] : logits[i];
+                     threadLoss += max(z, 0.0f) + log1p(exp(-fabs(z)));
+                 }
+                 
+                 // Accumulate gradients
+                 threadBiasGradient += error;
+                 kernels::axpy(error, block + static_cast<size_t>(i) * numFeatures, slot, numFeatures);
              }
          }
+         slot[numFeatures] = threadBiasGradient;
+         slot[numFeatures + 1] = threadLoss;
          
-         #pragma omp critical
-         {
-             biasGradient += threadBiasGradient;
+         // Pairwise tree reduction of the slots into slot 0, once every
+         // thread has finished writing its own slot
+         #pragma omp barrier
+         for (int step = 1; step < numThreads; step *= 2) {
+             if (tid % (2 * step) == 0 && tid + step < numThreads) {
+                 const float* other = slot + static_cast<size_t>(step) * arenaStride;
+                 kernels::axpy(1.0f, other, slot, numFeatures + 2);
+             }
+             #pragma omp barrier
          }
+     }
+     
+     return gradientArena.data();
+ }
  
-         // Atomically accumulate each feature element
-         for (int j = 0; j < numFeatures; ++j) {
-             #pragma omp atomic
-             gradient[j] += threadGradient[j];
+ float LogisticRegression::computeGradient(FloatSpan X, LabelSpan y, 
+                                           int numSamples, int numFeatures, bool withLoss) {
+     // The sums come from elsewhere: normalize them like the collective case
+     if (gradientSource) {
+         vector<float> theta(weights.begin(), weights.end());
+         theta.push_back(bias);
+         vector<double> sums = gradientSource(theta);
+         const double invSamples = 1.0 / sums[numFeatures + 2];
+         gradient.resize(numFeatures + 1);
+         for (int j = 0; j <= numFeatures; ++j) {
+             gradient[j] = static_cast<float>(sums[j] * invSamples);
          }
+         return static_cast<float>(sums[numFeatures + 1] * invSamples);
      }
      
-     // Normalize by number of samples
-     biasGradient /= numSamples;
-     for (int j = 0; j < numFeatures; ++j) {
-         gradient[j] /= numSamples;
+     const float* total = accumulateGradient(X, y, numSamples, numFeatures, withLoss);
+     
+     // Data-parallel: sum the gradient, the loss and the sample count over
+     // the ranks, in double so large global counts stay exact
+     if (comm != MPI_COMM_NULL) {
+         vector<double> sums(total, total + numFeatures + 2);
+         sums.push_back(numSamples);
+         MPI_Allreduce(MPI_IN_PLACE, sums.data(), numFeatures + 3, MPI_DOUBLE, MPI_SUM, comm);
+         const double invSamples = 1.0 / sums[numFeatures + 2];
+         for (int j = 0; j <= numFeatures; ++j) {
+             gradient[j] = static_cast<float>(sums[j] * invSamples);
+         }
+         return static_cast<float>(sums[numFeatures + 1] * invSamples);
      }
      
-     // Update bias (store in the last element of gradient)
-     gradient.push_back(biasGradient);
+     // Normalize by number of samples (bias stays in the last element)
+     const float invSamples = 1.0f / numSamples;
+     for (int j = 0; j <= numFeatures; ++j) {
+         gradient[j] = total[j] * invSamples;
+     }
      
-     return gradient;
+     return total[numFeatures + 1] * invSamples;
  }
  
- float LogisticRegression::computeLoss(const vector<float>& X, const vector<int>& y, 
-                                    int numSamples, int numFeatures) {
-     float loss = 0.0f;
-     
-     #pragma omp parallel for reduction(+:loss)
-     for (int i = 0; i < numSamples; ++i) {
-         // Compute logit
-         float logit = bias;
-         for (int j = 0; j < numFeatures; ++j) {
-             logit += weights[j] * X[i * numFeatures + j];
-         }
-         
-         // Compute binary cross-entropy loss
-         if (y[i] == 1) {
-             loss -= log(max(sigmoid(logit), 1e-7f));
-         } else {
-             loss -= log(max(1.0f - sigmoid(logit), 1e-7f));
-         }
-     }
-     
-     return loss / numSamples;
+ void LogisticRegression::setCommunicator(MPI_Comm comm) {
+     this->comm = comm;
+ }
+ 
+ void LogisticRegression::setGradientSource(GradientSource source) {
+     gradientSource = std::move(source);
+ }
+ 
+ vector<double> LogisticRegression::gradientSums(FloatSpan X, LabelSpan y, int numSamples, int numFeatures,
+                                                 const vector<float>& theta) {
+     copy(theta.begin(), theta.begin() + numFeatures, weights.begin());
+     bias = theta[numFeatures];
+     const float* total = accumulateGradient(X, y, numSamples, numFeatures, true);
+     vector<double> sums(total, total + numFeatures + 2);
+     sums.push_back(numSamples);
+     return sums;
  }
  
- void LogisticRegression::train(const vector<float>& X, const vector<int>& y, 
+ // Start every rank from rank 0's weights and bias
+ void LogisticRegression::broadcastParameters() {
+     vector<float> theta(weights.begin(), weights.end());
+     theta.push_back(bias);
+     MPI_Bcast(theta.data(), numFeatures + 1, MPI_FLOAT, 0, comm);
+     copy(theta.begin(), theta.begin() + numFeatures, weights.begin());
+     bias = theta[numFeatures];
+ }
+ 
+ void LogisticRegression::train(FloatSpan X, LabelSpan y, 
                              int numSamples, int numFeatures) {
+     if (comm != MPI_COMM_NULL) {
+         broadcastParameters();
+     }
+     if (solver == LRSolver::LBFGS) {
+         trainLBFGS(X, y, numSamples, numFeatures);
+         return;
+     }
+     
      cout << "Starting Logistic Regression training with " << numSamples << " samples..." << endl;
      
      for (int iter = 0; iter < maxIterations; ++iter) {
-         // Compute gradient
-         vector<float> gradient = computeGradient(X, y, numSamples, numFeatures);
+         // Compute gradient, plus the loss at the current weights on logging iterations
+         bool logProgress = (iter + 1) % 10 == 0 || iter == 0 || iter == maxIterations - 1;
+         float loss = computeGradient(X, y, numSamples, numFeatures, logProgress);
          
          // Update weights
          for (int j = 0; j < numFeatures; ++j) {
@@ -128,8 +214,7 @@
          bias -= learningRate * gradient[numFeatures];
          
          // Print progress
-         if ((iter + 1) % 10 == 0 || iter == 0 || iter == maxIterations - 1) {
-             float loss = computeLoss(X, y, numSamples, numFeatures);
+         if (logProgress) {
              cout << "Logistic Regression Iteration " << (iter + 1) << "/" << maxIterations 
                   << ", Loss: " << loss << endl;
          }
@@ -138,12 +223,164 @@
      cout << "Logistic Regression training completed." << endl;
  }
  
+ void LogisticRegression::trainLBFGS(FloatSpan X, LabelSpan y,
+                                     int numSamples, int numFeatures) {
+     cout << "Starting Logistic Regression L-BFGS training with " << numSamples << " samples..." << endl;
+     
+     // Parameters are optimized as one vector theta = [weights..., bias],
+     // matching the layout of `gradient`
+     const int numParams = numFeatures + 1;
+     auto setParameters = [&](const vector<float>& theta) {
+         copy(theta.begin(), theta.begin() + numFeatures, weights.begin());
+         bias = theta[numFeatures];
+     };
+     
+     vector<float> theta(weights.begin(), weights.end());
+     theta.push_back(bias);
+     vector<float> trial(numParams), direction(numParams), step(numParams), gradChange(numParams);
+     
+     // Correction pairs s = theta_{k+1} - theta_k, y = g_{k+1} - g_k, oldest first
+     vector<vector<float>> sHistory, yHistory;
+     vector<float> rhoHistory;
+     vector<float> alpha(LBFGS_HISTORY);
+     
+     float loss = computeGradient(X, y, numSamples, numFeatures, true);
+     vector<float> grad = gradient;
+     int passes = 1;
+     bool converged = false;
+     int iter = 0;
+     
+     for (; iter < maxIterations; ++iter) {
+         float gradMax = 0.0f;
+         for (float g : grad) {
+             gradMax = max(gradMax, fabs(g));
+         }
+         if (gradMax < tolerance) {
+             converged = true;
+             break;
+         }
+         
+         // Two-loop recursion: direction = -H * grad
+         for (int j = 0; j < numParams; ++j) {
+             direction[j] = -grad[j];
+         }
+         const int historySize = sHistory.size();
+         for (int k = historySize - 1; k >= 0; --k) {
+             alpha[k] = rhoHistory[k] * kernels::dot(sHistory[k].data(), direction.data(), numParams);
+             kernels::axpy(-alpha[k], yHistory[k].data(), direction.data(), numParams);
+         }
+         
+         // Initial Hessian scaling; before any curvature is known take a
+         // unit-length first step
+         float gamma;
+         if (historySize > 0) {
+             const vector<float>& yLast = yHistory.back();
+             gamma = kernels::dot(sHistory.back().data(), yLast.data(), numParams) /
+                     kernels::dot(yLast.data(), yLast.data(), numParams);
+         } else {
+             gamma = 1.0f / sqrt(kernels::dot(grad.data(), grad.data(), numParams));
+         }
+         for (float& d : direction) {
+             d *= gamma;
+         }
+         
+         for (int k = 0; k < historySize; ++k) {
+             float beta = rhoHistory[k] * kernels::dot(yHistory[k].data(), direction.data(), numParams);
+             kernels::axpy(alpha[k] - beta, sHistory[k].data(), direction.data(), numParams);
+         }
+         
+         // Fall back to steepest descent if the direction is not a descent direction
+         float slope = kernels::dot(grad.data(), direction.data(), numParams);
+         if (slope >= 0.0f) {
+             sHistory.clear();
+             yHistory.clear();
+             rhoHistory.clear();
+             float gradNorm = sqrt(kernels::dot(grad.data(), grad.data(), numParams));
+             for (int j = 0; j < numParams; ++j) {
+                 direction[j] = -grad[j] / gradNorm;
+             }
+             slope = -gradNorm;
+         }
+         
+         // Backtracking line search on the Armijo condition; each trial is
+         // one fused loss + gradient pass. Rejected steps shrink to the
+         // minimizer of the quadratic through loss, slope and the trial loss,
+         // kept within [0.1, 0.5] of the previous step
+         float stepSize = 1.0f;
+         float newLoss = loss;
+         bool accepted = false;
+         for (int ls = 0; ls < LBFGS_MAX_LINE_SEARCH; ++ls) {
+             for (int j = 0; j < numParams; ++j) {
+                 trial[j] = theta[j] + stepSize * direction[j];
+             }
+             setParameters(trial);
+             newLoss = computeGradient(X, y, numSamples, numFeatures, true);
+             ++passes;
+             if (newLoss <= loss + LBFGS_ARMIJO * stepSize * slope) {
+                 accepted = true;
+                 break;
+             }
+             float curvatureTerm = newLoss - loss - slope * stepSize;
+             float next = curvatureTerm > 0.0f ? -slope * stepSize * stepSize / (2.0f * curvatureTerm)
+                                               : 0.5f * stepSize;
+             stepSize = min(max(next, 0.1f * stepSize), 0.5f * stepSize);
+         }
+         if (!accepted) {
+             // No further decrease along this direction at float precision
+             setParameters(theta);
+             converged = true;
+             break;
+         }
+         
+         // Store the new correction pair if it carries positive curvature
+         for (int j = 0; j < numParams; ++j) {
+             step[j] = trial[j] - theta[j];
+             gradChange[j] = gradient[j] - grad[j];
+         }
+         float curvature = kernels::dot(step.data(), gradChange.data(), numParams);
+         if (curvature > 1e-10f) {
+             if (static_cast<int>(sHistory.size()) == LBFGS_HISTORY) {
+                 sHistory.erase(sHistory.begin());
+                 yHistory.erase(yHistory.begin());
+                 rhoHistory.erase(rhoHistory.begin());
+             }
+             sHistory.push_back(step);
+             yHistory.push_back(gradChange);
+             rhoHistory.push_back(1.0f / curvature);
+         }
+         
+         float relativeDecrease = (loss - newLoss) / max(fabs(loss), 1.0f);
+         theta = trial;
+         grad = gradient;
+         loss = newLoss;
+         
+         cout << "Logistic Regression L-BFGS Iteration " << (iter + 1) << "/" << maxIterations
+              << ", Loss: " << loss << endl;
+         
+         // A stalled step taken with a curvature model may just mean the
+         // model is stale: restart from steepest descent before giving up
+         if (relativeDecrease < tolerance) {
+             if (stepSize < 1.0f && historySize > 0) {
+                 sHistory.clear();
+                 yHistory.clear();
+                 rhoHistory.clear();
+                 continue;
+             }
+             ++iter;
+             converged = true;
+             break;
+         }
+     }
+     
+     setParameters(theta);
+     cout << "Logistic Regression training " << (converged ? "converged" : "stopped") << " after "
+          << iter << " iterations (" << passes << " passes over the data), Loss: " << loss << endl;
+ }
+ 
  // ModelInterface implementation: single-sample prediction
  int LogisticRegression::predict(const std::vector<float>& features) {
      assert((int)features.size() == numFeatures);
-     float logit = bias;
-     for (int j = 0; j < numFeatures; ++j)
-         logit += weights[j] * features[j];
+     float logit = bias + kernels::dot(weights.data(), features.data(), numFeatures);
      return sigmoid(logit) >= 0.5f ? 1 : 0;
  }
  
@@ -154,34 +391,51 @@
  
  vector<int> LogisticRegression::predict(const vector<float>& X, int numSamples, int numFeatures) {
      vector<int> predictions(numSamples);
-     
-     #pragma omp parallel for
-     for (int i = 0; i < numSamples; ++i) {
-         float logit = bias;
-         for (int j = 0; j < numFeatures; ++j) {
-             logit += weights[j] * X[i * numFeatures + j];
-         }
+     predictBatch(X.data(), numSamples, numFeatures, predictions.data());
+     return predictions;
+ }
+ 
+ // ModelInterface implementation: batch prediction on a row-major matrix
+ void LogisticRegression::predictBatch(const float* X, int N, int D, int* out) {
+     if (D != numFeatures) {
+         throw invalid_argument("Feature count " + to_string(D) + " does not match model input size " +
+                                to_string(numFeatures));
+     }
+     #pragma omp parallel
+     {
+         float logits[LOGIT_BLOCK];
          
-         predictions[i] = sigmoid(logit) >= 0.5 ? 1 : 0;
+         #pragma omp for
+         for (int start = 0; start < N; start += LOGIT_BLOCK) {
+             const int count = min(LOGIT_BLOCK, N - start);
+             kernels::logits(X + static_cast<size_t>(start) * D, count, D, weights.data(), bias, logits);
+             
+             // sigmoid(z) >= 0.5 exactly when z >= 0
+             for (int i = 0; i < count; ++i) {
+                 out[start + i] = logits[i] >= 0.0f ? 1 : 0;
+             }
+         }
      }
-     
-     return predictions;
  }
  
  vector<float> LogisticRegression::predictProbabilities(const vector<float>& X, int numSamples, int numFeatures) {
      vector<float> probabilities(numSamples);
-     
+     predictProbaBatch(X.data(), numSamples, numFeatures, probabilities.data());
+     return probabilities;
+ }
+ 
+ void LogisticRegression::predictProbaBatch(const float* X, int N, int D, float* out) {
+     if (D != numFeatures) {
+         throw invalid_argument("Feature count " + to_string(D) + " does not match model input size " +
+                                to_string(numFeatures));
+     }
      #pragma omp parallel for
-     for (int i = 0; i < numSamples; ++i) {
-         float logit = bias;
-         for (int j = 0; j < numFeatures; ++j) {
-             logit += weights[j] * X[i * numFeatures + j];
-         }
-         
-         probabilities[i] = sigmoid(logit);
+     for (int start = 0; start < N; start += LOGIT_BLOCK) {
+         const int count = min(LOGIT_BLOCK, N - start);
+         float* probs = out + start;
+         kernels::logits(X + static_cast<size_t>(start) * D, count, D, weights.data(), bias, probs);
+         kernels::sigmoid(probs, probs, count);
      }
-     
-     return probabilities;
  }
  
  void LogisticRegression::saveModel(const string& filename) {
@@ -1,6 +1,7 @@
 
 
 #include "./include/loan_data_preprocessor.h"
+#include "./include/feature_transform.h"
 #include <iostream>
 #include <string>
 #include <chrono>
@@ -17,6 +18,11 @@ void print_usage() {
     cout << "  --help             Display this help message" << endl;
     cout << "  --sample <n>       Display a sample of n records after processing" << endl;
     cout << "  --profile <file>   Export profiling data to the specified file" << endl;
+    cout << "  --format <fmt>     Output format: csv (default) or binary" << endl;
+    cout << "  --transform <file> Feature transform artifact to write (default " << feature_transform::DEFAULT_TRANSFORM_FILE << ")" << endl;
+    cout << "  --stream           Process the input in two chunked passes with bounded memory" << endl;
+    cout << "  --pipeline         Like --stream, with parse/encode/impute/format/write as concurrent stages" << endl;
+    cout << "  --chunk-rows <n>   Rows per chunk in --stream/--pipeline mode (default " << DEFAULT_STREAM_CHUNK_ROWS << ")" << endl;
     cout << endl;
 }
 
@@ -26,6 +32,11 @@ int main(int argc, char* argv[]) {
     string output_file;
     int sample_size = 0;
     string profile_file;
+    OutputFormat output_format = OutputFormat::Csv;
+    bool stream = false;
+    bool pipeline = false;
+    size_t chunk_rows = DEFAULT_STREAM_CHUNK_ROWS;
+    string transform_file = feature_transform::DEFAULT_TRANSFORM_FILE;
     
     // Parse command line arguments
     for (int i = 1; i < argc; i++) {
@@ -57,6 +68,49 @@ int main(int argc, char* argv[]) {
                 cerr << "Error: --profile requires a filename argument." << endl;
                 return 1;
             }
+        } else if (arg == "--format") {
+            if (i + 1 < argc) {
+                string format = argv[++i];
+                if (format == "csv") {
+                    output_format = OutputFormat::Csv;
+                } else if (format == "binary") {
+                    output_format = OutputFormat::Binary;
+                } else {
+                    cerr << "Error: Unknown output format: " << format << endl;
+                    return 1;
+                }
+            } else {
+                cerr << "Error: --format requires csv or binary." << endl;
+                return 1;
+            }
+        } else if (arg == "--transform") {
+            if (i + 1 < argc) {
+                transform_file = argv[++i];
+            } else {
+                cerr << "Error: --transform requires a filename argument." << endl;
+                return 1;
+            }
+        } else if (arg == "--stream") {
+            stream = true;
+        } else if (arg == "--pipeline") {
+            pipeline = true;
+        } else if (arg == "--chunk-rows") {
+            if (i + 1 < argc) {
+                try {
+                    long long rows = stoll(argv[++i]);
+                    if (rows <= 0) {
+                        cerr << "Error: Chunk size must be a positive integer." << endl;
+                        return 1;
+                    }
+                    chunk_rows = static_cast<size_t>(rows);
+                } catch (const exception& e) {
+                    cerr << "Error: Invalid chunk size." << endl;
+                    return 1;
+                }
+            } else {
+                cerr << "Error: --chunk-rows requires a numeric argument." << endl;
+                return 1;
+            }
         } else if (input_file.empty()) {
             input_file = arg;
         } else if (output_file.empty()) {
@@ -87,6 +141,31 @@ int main(int argc, char* argv[]) {
         int num_threads = omp_get_max_threads();
         cout << "Using " << num_threads << " threads for processing." << endl;
         
+        // Streaming mode never holds the whole dataset, so there is no
+        // sample to show afterwards
+        if (stream || pipeline) {
+            if (sample_size > 0) {
+                cout << "Note: --sample is ignored with --stream and --pipeline." << endl;
+            }
+            Dataset dataset;
+            bool ok = pipeline ? dataset.pipeline_to_file(input_file, output_file, output_format, chunk_rows)
+                               : dataset.stream_to_file(input_file, output_file, output_format, chunk_rows);
+            if (!ok) {
+                return 1;
+            }
+            dataset.save_transform(transform_file);
+            if (!profile_file.empty()) {
+                dataset.export_profiling_data(profile_file);
+            }
+
+            auto end_time = chrono::high_resolution_clock::now();
+            chrono::duration<double> elapsed = end_time - start_time;
+            cout << "\nPreprocessing completed successfully!" << endl;
+            cout << "Total execution time: " << fixed << setprecision(2)
+                 << elapsed.count() << " seconds" << endl;
+            return 0;
+        }
+
         // Load and preprocess the data
         unique_ptr<Dataset> dataset;
         try {
@@ -102,7 +181,8 @@ int main(int argc, char* argv[]) {
         }
 
         // Save the preprocessed data
-        dataset->save_to_file(output_file);
+        dataset->save_to_file(output_file, output_format);
+        dataset->save_transform(transform_file);
         
         // Export profiling data if requested
         if (!profile_file.empty()) {
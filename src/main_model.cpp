@@ -3,6 +3,10 @@
  * 
  * This file manages the MPI communication and coordinates the training of three
  * classification algorithms in parallel: Random Forest, MLP, and Logistic Regression.
+ * By default each of exactly 3 ranks trains one model on its third of the data;
+ * with --data-parallel any number of ranks train every model together on all
+ * of it, and with --scheduled rank 0 hands the ensemble out as small tasks to
+ * whichever rank is free.
  */
 
  #include <mpi.h>
@@ -10,68 +14,438 @@
  #include <fstream>
  #include <sstream>
  #include <vector>
+ #include <deque>
  #include <string>
  #include <chrono>
  #include <algorithm>
  #include <numeric>
+ #include <memory>
+ #include <stdexcept>
  #include <iomanip>
+ #include <cstdlib>
+ #include <cstring>
+ #include <functional>
  #include "./include/omp_config.h"
  #include "./include/random_forest.h"
  #include "./include/mlp.h"
  #include "./include/logistic_regression.h"
+ #include "./include/binary_dataset.h"
+ #include "./include/csv_loader.h"
+ #include "./include/feature_transform.h"
+ #include "./include/task_scheduler.h"
  
  using namespace std;
  
- // Function to load data from CSV
+ // Function to load data from CSV or a binary columnar dataset
  void loadData(const string& filename, vector<float>& X, vector<int>& y, int& numSamples, int& numFeatures) {
-     ifstream file(filename);
-     if (!file.is_open()) {
-         cerr << "Error: Unable to open file " << filename << endl;
+     if (binary_dataset::isBinaryDataset(filename)) {
+         try {
+             binary_dataset::loadDataset(filename, X, y, numSamples, numFeatures);
+         } catch (const exception& e) {
+             cerr << "Error: " << e.what() << endl;
+             MPI_Abort(MPI_COMM_WORLD, 1);
+         }
+         return;
+     }
+ 
+     // Label in the last column, every other column a feature
+     try {
+         csv_loader::loadCsv(filename, X, y, numSamples, numFeatures);
+     } catch (const exception& e) {
+         cerr << "Error: " << e.what() << endl;
          MPI_Abort(MPI_COMM_WORLD, 1);
      }
+ }
  
-     string line;
-     vector<vector<float>> dataList;
-     vector<int> labelList;
+ // --stream: rows per chunk rank 0 parses and sends at a time
+ static const int STREAM_CHUNK_ROWS = 4096;
+ static const int STREAM_TAG = 1;
+ 
+ // Stream messages are a ChunkHeader followed by the rows' features and
+ // labels; a header with no rows ends the stream
+ struct ChunkHeader {
+     int32_t rows;
+     int32_t numFeatures;
+ };
+ 
+ // --stream: rank 0 parses the CSV a chunk at a time and deals the chunks out
+ // round-robin with MPI_Isend as soon as each one is parsed, so every rank
+ // transforms its rows (and, with binned, sorts them into bin columns) while
+ // the rest of the file is still being read. Appends this rank's rows to
+ // localX (transformed when transform is set) and localY, sets numFeatures
+ // and returns the number of rows in the file on rank 0.
+ static int streamDistribute(const string& filename, const feature_transform::FeatureTransform* transform,
+                             vector<float>& localX, vector<int>& localY, int& numFeatures,
+                             BinnedFeatures* binned) {
+     int rank, worldSize;
+     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+     MPI_Comm_size(MPI_COMM_WORLD, &worldSize);
  
-     // Skip the header (if present)
-     getline(file, line);
+     auto consume = [&](const float* X, const int* y, int rows, int D) {
+         if (transform && transform->numFeatures() != D) {
+             throw runtime_error("Transform has " + to_string(transform->numFeatures()) +
+                                 " features, dataset has " + to_string(D));
+         }
+         const size_t offset = localX.size();
+         localX.resize(offset + static_cast<size_t>(rows) * D);
+         if (transform) {
+             transform->apply(X, localX.data() + offset, rows);
+         } else {
+             copy(X, X + static_cast<size_t>(rows) * D, localX.begin() + offset);
+         }
+         localY.insert(localY.end(), y, y + rows);
+         if (binned) {
+             binned->addChunk(localX.data() + offset, localY.data() + localY.size() - rows, rows, D);
+         }
+     };
  
-     // Read the data
-     while (getline(file, line)) {
-         stringstream ss(line);
-         string value;
-         vector<float> row;
-         int label = -1;
-         int colIndex = 0;
+     if (rank != 0) {
+         vector<char> message;
+         while (true) {
+             MPI_Status status;
+             MPI_Probe(0, STREAM_TAG, MPI_COMM_WORLD, &status);
+             int bytes;
+             MPI_Get_count(&status, MPI_CHAR, &bytes);
+             message.resize(bytes);
+             MPI_Recv(message.data(), bytes, MPI_CHAR, 0, STREAM_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+             ChunkHeader header;
+             memcpy(&header, message.data(), sizeof(header));
+             numFeatures = header.numFeatures;
+             if (header.rows == 0) {
+                 return 0;
+             }
+             const size_t values = static_cast<size_t>(header.rows) * header.numFeatures;
+             vector<float> X(values);
+             vector<int> y(header.rows);
+             memcpy(X.data(), message.data() + sizeof(header), values * sizeof(float));
+             memcpy(y.data(), message.data() + sizeof(header) + values * sizeof(float), y.size() * sizeof(int));
+             consume(X.data(), y.data(), header.rows, header.numFeatures);
+         }
+     }
  
-         while (getline(ss, value, ',')) {
-             float val = stof(value);
-             if (colIndex == 5) { // Assuming label is the 6th column
-                 label = static_cast<int>(val);
+     // Isend buffers live until the send completes
+     deque<pair<MPI_Request, vector<char>>> sends;
+     auto send = [&](int dest, vector<char>&& message) {
+         sends.emplace_back(MPI_REQUEST_NULL, move(message));
+         MPI_Isend(sends.back().second.data(), static_cast<int>(sends.back().second.size()), MPI_CHAR, dest,
+                   STREAM_TAG, MPI_COMM_WORLD, &sends.back().first);
+     };
+     auto reap = [&](bool wait) {
+         while (!sends.empty()) {
+             int finished = 1;
+             if (wait) {
+                 MPI_Wait(&sends.front().first, MPI_STATUS_IGNORE);
              } else {
-                 row.push_back(val);
+                 MPI_Test(&sends.front().first, &finished, MPI_STATUS_IGNORE);
+             }
+             if (!finished) {
+                 return;
              }
-             colIndex++;
+             sends.pop_front();
          }
+     };
  
-         dataList.push_back(row);
-         labelList.push_back(label);
+     int numSamples = 0;
+     int chunk = 0;
+     csv_loader::streamCsv(filename, STREAM_CHUNK_ROWS, [&](const float* X, const int* y, int rows, int D) {
+         numFeatures = D;
+         numSamples += rows;
+         const int dest = chunk++ % worldSize;
+         if (dest == 0) {
+             consume(X, y, rows, D);
+         } else {
+             const ChunkHeader header{rows, D};
+             const size_t values = static_cast<size_t>(rows) * D;
+             vector<char> message(sizeof(header) + values * sizeof(float) + rows * sizeof(int));
+             memcpy(message.data(), &header, sizeof(header));
+             memcpy(message.data() + sizeof(header), X, values * sizeof(float));
+             memcpy(message.data() + sizeof(header) + values * sizeof(float), y, rows * sizeof(int));
+             send(dest, move(message));
+         }
+         reap(false);
+     });
+     for (int dest = 1; dest < worldSize; ++dest) {
+         const ChunkHeader header{0, numFeatures};
+         vector<char> message(sizeof(header));
+         memcpy(message.data(), &header, sizeof(header));
+         send(dest, move(message));
      }
+     reap(true);
+     return numSamples;
+ }
  
-     numSamples = dataList.size();
-     numFeatures = dataList[0].size();
+ // Training configuration shared by both modes
+ static const int DEFAULT_RF_TREES = 5;
+ static const int MLP_EPOCHS = 5;
+ static const int MLP_BATCH_SIZE = 32;
  
-     // Flatten the data
-     X.resize(numSamples * numFeatures);
-     y.resize(numSamples);
+ // Data-parallel mode: every rank holds one shard and takes part in training
+ // each model in turn. LR and MLP sum their gradients (or average the MLP
+ // parameters every syncEvery steps) over MPI_COMM_WORLD, and each rank
+ // grows its share of the forest's trees on its shard; rank 0 gathers them
+ // and saves the forest. With globalTrees every tree is instead grown by all
+ // ranks together over all of the data, merging the split histograms with
+ // MPI_Allreduce. binned, when set, holds this rank's shard already binned
+ // for its trees. Returns the wall time of each model (RF, MLP, LR) on this
+ // rank.
+ static vector<double> trainDataParallel(FloatSpan localX, LabelSpan localY, int localRows, int numFeatures,
+                                         int rfTrees, bool globalTrees, int syncEvery,
+                                         const BinnedFeatures* binned) {
+     int rank, worldSize;
+     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+     MPI_Comm_size(MPI_COMM_WORLD, &worldSize);
+     vector<double> timings;
+     auto startTime = chrono::high_resolution_clock::now();
+     auto lap = [&]() {
+         MPI_Barrier(MPI_COMM_WORLD);
+         auto now = chrono::high_resolution_clock::now();
+         timings.push_back(chrono::duration<double>(now - startTime).count());
+         startTime = now;
+     };
  
-     for (int i = 0; i < numSamples; ++i) {
-         for (int j = 0; j < numFeatures; ++j) {
-             X[i * numFeatures + j] = dataList[i][j];
+     // Trees [firstTree, firstTree + treeCount) of the forest, in rank
+     // order, all seeded from rank 0's base seed
+     const int treeCount = rfTrees / worldSize + (rank < rfTrees % worldSize ? 1 : 0);
+     const int firstTree = rank * (rfTrees / worldSize) + min(rank, rfTrees % worldSize);
+     unsigned int forestSeed = chrono::system_clock::now().time_since_epoch().count();
+     MPI_Bcast(&forestSeed, 1, MPI_UNSIGNED, 0, MPI_COMM_WORLD);
+     cout << "Training Random Forest: " << rfTrees << " trees over " << worldSize << " ranks..." << endl;
+     if (globalTrees) {
+         RandomForest rf(rfTrees, 5, 2, numFeatures, SplitMode::Histogram);
+         rf.setSeed(forestSeed);
+         rf.trainDistributed(localX, localY, localRows, numFeatures, MPI_COMM_WORLD);
+         if (rank == 0) {
+             rf.saveModel("random_forest_model.bin");
+         }
+     } else {
+         RandomForest rf(treeCount, 5, 2, numFeatures, SplitMode::Histogram);
+         rf.setSeed(forestSeed);
+         rf.setForestSlice(firstTree, rfTrees);
+         if (treeCount > 0) {
+             rf.train(localX, localY, localRows, numFeatures, binned);
          }
-         y[i] = labelList[i];
+         rf.gatherForest(MPI_COMM_WORLD);
+         if (rank == 0) {
+             rf.saveModel("random_forest_model.bin");
+         }
+     }
+     lap();
+ 
+     // Synchronous SGD on a global batch of MLP_BATCH_SIZE rows per rank:
+     // scaling the rate with the rank count keeps the step per sample (and
+     // the single-rank behaviour) of the classic mode
+     cout << "Training MLP Neural Network..." << endl;
+     MLP mlp(numFeatures, {16, 8}, 2);
+     mlp.setCommunicator(MPI_COMM_WORLD, syncEvery);
+     const float mlpRate = 0.01f * MLP_BATCH_SIZE * (syncEvery == 1 ? worldSize : 1);
+     mlp.train(localX, localY, localRows, numFeatures, MLP_EPOCHS, mlpRate, MLP_BATCH_SIZE);
+     if (rank == 0) {
+         mlp.saveModel("mlp_model.bin");
+     }
+     lap();
+ 
+     cout << "Training Logistic Regression..." << endl;
+     LogisticRegression lr(numFeatures, 0.01, 100, LRSolver::LBFGS, 1e-6f);
+     lr.setCommunicator(MPI_COMM_WORLD);
+     lr.train(localX, localY, localRows, numFeatures);
+     if (rank == 0) {
+         lr.saveModel("logistic_regression_model.bin");
      }
+     lap();
+     return timings;
+ }
+ 
+ // Scheduled mode: rank 0 splits the ensemble into tasks and hands them to
+ // whichever rank is free (task_scheduler.h). Every rank holds all rows.
+ //  - one task per Random Forest tree, grown on a bootstrap of all rows;
+ //  - each MLP epoch is one task per shard, run in turn, each continuing
+ //    from the parameters the previous one returned;
+ //  - Logistic Regression runs L-BFGS on rank 0 and every gradient it needs
+ //    is summed from one task per shard.
+ // The MLP and LR chains outrank the independent trees, which fill the gaps.
+ enum TrainingTask { RF_TREE_TASK, MLP_EPOCH_TASK, LR_GRADIENT_TASK };
+ 
+ template <typename T>
+ static void appendValues(TaskScheduler::Payload& payload, const T* values, size_t count) {
+     const char* bytes = reinterpret_cast<const char*>(values);
+     payload.insert(payload.end(), bytes, bytes + count * sizeof(T));
+ }
+ 
+ template <typename T>
+ static vector<T> readValues(const TaskScheduler::Payload& payload, size_t offset = 0) {
+     vector<T> values((payload.size() - offset) / sizeof(T));
+     memcpy(values.data(), payload.data() + offset, values.size() * sizeof(T));
+     return values;
+ }
+ 
+ // Task bodies reuse the models' training code, whose progress output would
+ // interleave with rank 0's report
+ struct QuietOutput {
+     ios::iostate saved = cout.rdstate();
+     QuietOutput() { cout.setstate(ios::failbit); }
+     ~QuietOutput() { cout.clear(saved); }
+ };
+ 
+ // Returns when each model (RF, MLP, LR) finished, in seconds from the start;
+ // all zero on the worker ranks
+ static vector<double> trainScheduled(FloatSpan X, LabelSpan y, int numSamples, int numFeatures, int rfTrees) {
+     int rank, worldSize;
+     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+     MPI_Comm_size(MPI_COMM_WORLD, &worldSize);
+     const int shards = worldSize;
+     auto shardBegin = [&](int shard) {
+         return static_cast<int>(static_cast<long long>(shard) * numSamples / shards);
+     };
+     const float mlpRate = 0.01f * MLP_BATCH_SIZE;
+ 
+     // Per-rank state for the task bodies, created on first use
+     BinnedFeatures binned;
+     unique_ptr<MLP> shardMlp;
+     unique_ptr<LogisticRegression> shardLr;
+ 
+     auto execute = [&](int kind, const TaskScheduler::Payload& input) {
+         QuietOutput quiet;
+         TaskScheduler::Payload output;
+         if (kind == RF_TREE_TASK) {
+             if (binned.numSamples != numSamples) {
+                 binned.build(X, y, numSamples, numFeatures);
+             }
+             unsigned int seed;
+             memcpy(&seed, input.data(), sizeof(seed));
+             DecisionTree tree(5, 2, numFeatures, seed);
+             tree.train(X, y, numSamples, numFeatures, SplitMode::Histogram, &binned);
+             ostringstream out(ios::binary);
+             tree.serialize(out);
+             const string bytes = out.str();
+             output.assign(bytes.begin(), bytes.end());
+             return output;
+         }
+ 
+         int shard;
+         memcpy(&shard, input.data(), sizeof(shard));
+         const int begin = shardBegin(shard);
+         const int count = shardBegin(shard + 1) - begin;
+         FloatSpan shardX = X.subspan(static_cast<size_t>(begin) * numFeatures, static_cast<size_t>(count) * numFeatures);
+         LabelSpan shardY = y.subspan(begin, count);
+ 
+         if (kind == MLP_EPOCH_TASK) {
+             if (!shardMlp) {
+                 shardMlp = make_unique<MLP>(numFeatures, vector<int>{16, 8}, 2);
+             }
+             shardMlp->setParameters(readValues<float>(input, sizeof(shard)));
+             shardMlp->train(shardX, shardY, count, numFeatures, 1, mlpRate, MLP_BATCH_SIZE);
+             vector<float> params;
+             shardMlp->getParameters(params);
+             appendValues(output, params.data(), params.size());
+         } else {
+             if (!shardLr) {
+                 shardLr = make_unique<LogisticRegression>(numFeatures, 0.01, 100, LRSolver::LBFGS, 1e-6f);
+             }
+             vector<double> sums = shardLr->gradientSums(shardX, shardY, count, numFeatures,
+                                                         readValues<float>(input, sizeof(shard)));
+             appendValues(output, sums.data(), sums.size());
+         }
+         return output;
+     };
+ 
+     TaskScheduler scheduler(MPI_COMM_WORLD, execute);
+     if (!scheduler.isMaster()) {
+         scheduler.serve();
+         return vector<double>(3, 0.0);
+     }
+ 
+     vector<double> timings(3, 0.0);
+     auto startTime = chrono::high_resolution_clock::now();
+     auto elapsed = [&]() {
+         return chrono::duration<double>(chrono::high_resolution_clock::now() - startTime).count();
+     };
+     cout << "Scheduling " << rfTrees << " trees, " << MLP_EPOCHS << " MLP epochs and the LR gradients in "
+          << shards << " shards over " << worldSize << " ranks..." << endl;
+ 
+     // Random Forest: every tree is an independent task
+     vector<shared_ptr<DecisionTree>> forest(rfTrees);
+     int treesLeft = rfTrees;
+     const unsigned int forestSeed = chrono::system_clock::now().time_since_epoch().count();
+     for (int i = 0; i < rfTrees; ++i) {
+         TaskScheduler::Payload input;
+         const unsigned int seed = forestSeed + i;
+         appendValues(input, &seed, 1);
+         scheduler.submit(RF_TREE_TASK, 0, move(input), [&, i](TaskScheduler::Payload&& result) {
+             istringstream in(string(result.begin(), result.end()), ios::binary);
+             forest[i] = make_shared<DecisionTree>(5, 2, numFeatures, i);
+             forest[i]->deserialize(in);
+             if (--treesLeft == 0) {
+                 RandomForest rf(rfTrees, 5, 2, numFeatures, SplitMode::Histogram);
+                 rf.setTrees(move(forest));
+                 rf.saveModel("random_forest_model.bin");
+                 timings[0] = elapsed();
+             }
+         });
+     }
+ 
+     // MLP: the parameters go through the shards one task at a time, so the
+     // chain takes the same steps as one rank would while its tasks land on
+     // whichever rank is free
+     MLP mlp(numFeatures, {16, 8}, 2);
+     int epochsDone = 0;
+     function<void(int, const vector<float>&)> trainShard = [&](int shard, const vector<float>& params) {
+         TaskScheduler::Payload input;
+         appendValues(input, &shard, 1);
+         appendValues(input, params.data(), params.size());
+         scheduler.submit(MLP_EPOCH_TASK, 1, move(input), [&, shard](TaskScheduler::Payload&& result) {
+             vector<float> next = readValues<float>(result);
+             if (shard + 1 < shards) {
+                 trainShard(shard + 1, next);
+                 return;
+             }
+             cout << "MLP epoch " << ++epochsDone << "/" << MLP_EPOCHS << " done" << endl;
+             if (epochsDone < MLP_EPOCHS) {
+                 trainShard(0, next);
+             } else {
+                 mlp.setParameters(next);
+                 mlp.saveModel("mlp_model.bin");
+                 timings[1] = elapsed();
+             }
+         });
+     };
+     vector<float> initialParams;
+     mlp.getParameters(initialParams);
+     trainShard(0, initialParams);
+ 
+     // Logistic Regression: the solver waits for its gradients here while
+     // the scheduler keeps every rank busy with the other tasks
+     LogisticRegression lr(numFeatures, 0.01, 100, LRSolver::LBFGS, 1e-6f);
+     lr.setGradientSource([&](const vector<float>& theta) {
+         vector<double> sums(numFeatures + 3, 0.0);
+         int pending = shards;
+         for (int shard = 0; shard < shards; ++shard) {
+             TaskScheduler::Payload input;
+             appendValues(input, &shard, 1);
+             appendValues(input, theta.data(), theta.size());
+             scheduler.submit(LR_GRADIENT_TASK, 2, move(input), [&](TaskScheduler::Payload&& result) {
+                 vector<double> part = readValues<double>(result);
+                 for (size_t k = 0; k < sums.size(); ++k) {
+                     sums[k] += part[k];
+                 }
+                 --pending;
+             });
+         }
+         scheduler.runUntil([&] { return pending == 0; });
+         return sums;
+     });
+     lr.train(X, y, numSamples, numFeatures);
+     lr.saveModel("logistic_regression_model.bin");
+     timings[2] = elapsed();
+ 
+     scheduler.runUntil([&] { return treesLeft == 0 && epochsDone == MLP_EPOCHS; });
+     scheduler.shutdown();
+ 
+     cout << "Tasks run per rank:";
+     for (int r = 0; r < worldSize; ++r) {
+         cout << " " << scheduler.tasksRun()[r];
+     }
+     cout << endl;
+     return timings;
  }
  
  int main(int argc, char* argv[]) {
@@ -85,33 +459,129 @@
         setup_openmp_threads();
         cout << "Rank " << rank << " is using " << OMP_NUM_THREADS << " OpenMP threads." << std::endl;
 
-     // Check if we have the required number of processes
-     if (world_size != 3) {
+     // Data file and the preprocessor's feature transform (default
+     // feature_transform.bin when present, "none" to train on raw values)
+     string filename;
+     string transformFile;
+     bool dataParallel = false;
+     bool globalTrees = false;
+     bool scheduled = false;
+     bool stream = false;
+     int syncEvery = 1;
+     int rfTrees = DEFAULT_RF_TREES;
+     bool badArgs = false;
+     for (int i = 1; i < argc; ++i) {
+         string arg = argv[i];
+         if (arg == "--transform" && i + 1 < argc) {
+             transformFile = argv[++i];
+         } else if (arg == "--data-parallel") {
+             dataParallel = true;
+         } else if (arg == "--scheduled") {
+             scheduled = true;
+         } else if (arg == "--stream") {
+             stream = true;
+         } else if (arg == "--global-trees") {
+             globalTrees = true;
+         } else if (arg == "--sync-every" && i + 1 < argc) {
+             syncEvery = atoi(argv[++i]);
+             badArgs |= syncEvery < 1;
+         } else if (arg == "--trees" && i + 1 < argc) {
+             rfTrees = atoi(argv[++i]);
+             badArgs |= rfTrees < 1;
+         } else if (filename.empty() && arg.rfind("--", 0) != 0) {
+             filename = arg;
+         } else {
+             badArgs = true;
+         }
+     }
+     if (badArgs || filename.empty() || (globalTrees && !dataParallel) || (scheduled && dataParallel) ||
+         (scheduled && stream)) {
          if (rank == 0) {
-             cerr << "Error: This program requires exactly 3 MPI processes." << endl;
-             cerr << "Please run with: mpirun -np 3 " << argv[0] << " processed_data.csv" << endl;
+             cerr << "Usage: " << argv[0] << " [--transform <file>|none] [--trees <n>] [--stream]"
+                  << " [--data-parallel [--sync-every <k>] [--global-trees] | --scheduled] <data_file.csv>" << endl;
          }
          MPI_Finalize();
          return 1;
      }
  
-     // Check if filename is provided
-     if (argc != 2) {
+     // Check if we have the required number of processes
+     if (!dataParallel && !scheduled && world_size != 3) {
          if (rank == 0) {
-             cerr << "Usage: " << argv[0] << " <data_file.csv>" << endl;
+             cerr << "Error: This program requires exactly 3 MPI processes without --data-parallel or --scheduled."
+                  << endl;
+             cerr << "Please run with: mpirun -np 3 " << argv[0] << " processed_data.csv" << endl;
          }
          MPI_Finalize();
          return 1;
      }
- 
-     string filename = argv[1];
+     // Like ml_predictor, pick up the preprocessor's default artifact unless told otherwise
+     if (transformFile.empty() && ifstream(feature_transform::DEFAULT_TRANSFORM_FILE).good()) {
+         transformFile = feature_transform::DEFAULT_TRANSFORM_FILE;
+     } else if (transformFile == "none") {
+         transformFile.clear();
+     }
      vector<float> X;
      vector<int> y;
+     vector<float> local_X;
+     vector<int> local_y;
      int numSamples = 0;
      int numFeatures = 0;
  
-     // Rank 0 loads the data
-     if (rank == 0) {
+     // A binary dataset is memory-mapped by every rank, which then trains on
+     // its own row range in place; CSV input is parsed on rank 0 and scattered,
+     // or with --stream sent out chunk by chunk while it is parsed
+     const bool mappedInput = binary_dataset::isBinaryDataset(filename);
+     unique_ptr<binary_dataset::MappedDataset> mapped;
+     if (stream && mappedInput) {
+         if (rank == 0) {
+             cout << "Note: --stream has no effect on a mapped binary dataset." << endl;
+         }
+         stream = false;
+     }
+ 
+     // A streamed rank that grows forest trees on its own rows bins them
+     // chunk by chunk as they arrive (--global-trees bins collectively later)
+     const bool binTrees = stream && !globalTrees && (dataParallel ? rank < rfTrees : rank == 0);
+     BinnedFeatures binned;
+ 
+     if (mappedInput) {
+         try {
+             mapped = make_unique<binary_dataset::MappedDataset>(filename);
+         } catch (const exception& e) {
+             cerr << "Error: " << e.what() << endl;
+             MPI_Abort(MPI_COMM_WORLD, 1);
+         }
+         numSamples = mapped->numRows();
+         numFeatures = mapped->numFeatures();
+         if (rank == 0) {
+             cout << "Mapped dataset " << filename << " with " << numSamples << " samples and "
+                  << numFeatures << " features" << (mapped->isZeroCopy() ? " (zero-copy)." : ".") << endl;
+         }
+     } else if (stream) {
+         if (rank == 0) {
+             cout << "Streaming dataset from " << filename << " in chunks of " << STREAM_CHUNK_ROWS
+                  << " rows..." << endl;
+         }
+         try {
+             unique_ptr<feature_transform::FeatureTransform> transform;
+             if (!transformFile.empty()) {
+                 transform = make_unique<feature_transform::FeatureTransform>(transformFile);
+             }
+             numSamples = streamDistribute(filename, transform.get(), local_X, local_y, numFeatures,
+                                           binTrees ? &binned : nullptr);
+             if (binTrees) {
+                 binned.finish(local_X);
+             }
+         } catch (const exception& e) {
+             cerr << "Error: " << e.what() << endl;
+             MPI_Abort(MPI_COMM_WORLD, 1);
+         }
+         if (rank == 0) {
+             cout << "Dataset streamed with " << numSamples << " samples and " << numFeatures << " features"
+                  << (transformFile.empty() ? "." : ", transformed with " + transformFile + ".") << endl;
+         }
+     } else if (rank == 0) {
+         // Rank 0 loads the data
          cout << "Loading dataset from " << filename << "..." << endl;
          loadData(filename, X, y, numSamples, numFeatures);
          cout << "Dataset loaded with " << numSamples << " samples and " 
@@ -130,13 +600,20 @@
      vector<int> counts_y(world_size);
      vector<int> displs_y(world_size);
  
-     for (int i = 0; i < world_size; ++i) {
-         rows[i] = numSamples / world_size + (i < numSamples % world_size ? 1 : 0);
+     // Scheduled tasks may run on any rank, so there every rank holds all
+     // rows; streamed rows are wherever their chunks were dealt
+     if (stream) {
+         int localRows = static_cast<int>(local_y.size());
+         MPI_Allgather(&localRows, 1, MPI_INT, rows.data(), 1, MPI_INT, MPI_COMM_WORLD);
+     } else {
+         for (int i = 0; i < world_size; ++i) {
+             rows[i] = scheduled ? numSamples : numSamples / world_size + (i < numSamples % world_size ? 1 : 0);
+         }
      }
  
      displs_rows[0] = 0;
      for (int i = 1; i < world_size; ++i) {
-         displs_rows[i] = displs_rows[i-1] + rows[i-1];
+         displs_rows[i] = scheduled ? 0 : displs_rows[i-1] + rows[i-1];
      }
  
      for (int i = 0; i < world_size; ++i) {
@@ -147,48 +624,113 @@
      }
  
      // Allocate local data
-     vector<float> local_X(counts_X[rank]);
-     vector<int> local_y(counts_y[rank]);
+     FloatSpan localX;
+     LabelSpan localY;
  
-     // Scatter the data
-     MPI_Scatterv(X.data(), counts_X.data(), displs_X.data(), MPI_FLOAT,
-                  local_X.data(), counts_X[rank], MPI_FLOAT, 0, MPI_COMM_WORLD);
-     MPI_Scatterv(y.data(), counts_y.data(), displs_y.data(), MPI_INT,
-                  local_y.data(), counts_y[rank], MPI_INT, 0, MPI_COMM_WORLD);
- 
-     // Train the appropriate model based on rank
-     double trainingTime = 0.0;
-     auto startTime = chrono::high_resolution_clock::now();
+     if (mappedInput) {
+         // Views into the mapping; nothing is copied or sent
+         localX = mapped->features().subspan(displs_X[rank], counts_X[rank]);
+         localY = mapped->labels().subspan(displs_y[rank], counts_y[rank]);
+     } else if (scheduled) {
+         if (rank == 0) {
+             local_X.swap(X);
+             local_y.swap(y);
+         } else {
+             local_X.resize(counts_X[rank]);
+             local_y.resize(counts_y[rank]);
+         }
+         MPI_Bcast(local_X.data(), counts_X[rank], MPI_FLOAT, 0, MPI_COMM_WORLD);
+         MPI_Bcast(local_y.data(), counts_y[rank], MPI_INT, 0, MPI_COMM_WORLD);
+         localX = local_X;
+         localY = local_y;
+     } else if (stream) {
+         // Already here, and already transformed
+         localX = local_X;
+         localY = local_y;
+     } else {
+         local_X.resize(counts_X[rank]);
+         local_y.resize(counts_y[rank]);
  
-     if (rank == 0) {
-         // Random Forest
-         cout << "Rank 0: Training Random Forest..." << endl;
-         RandomForest rf(5, 5, 2, numFeatures);
-         rf.train(local_X, local_y, rows[rank], numFeatures);
-         rf.saveModel("random_forest_model.bin");
-     } 
-     else if (rank == 1) {
-         // MLP (Neural Network)
-         cout << "Rank 1: Training MLP Neural Network..." << endl;
-         vector<int> hiddenLayers = {16, 8};
-         MLP mlp(numFeatures, hiddenLayers, 2); // Assuming binary classification for now
-         mlp.train(local_X, local_y, rows[rank], numFeatures, 5, 0.01);
-         mlp.saveModel("mlp_model.bin");
-     } 
-     else if (rank == 2) {
-         // Logistic Regression
-         cout << "Rank 2: Training Logistic Regression..." << endl;
-         LogisticRegression lr(numFeatures, 0.01, 10);
-         lr.train(local_X, local_y, rows[rank], numFeatures);
-         lr.saveModel("logistic_regression_model.bin");
+         // Scatter the data
+         MPI_Scatterv(X.data(), counts_X.data(), displs_X.data(), MPI_FLOAT,
+                      local_X.data(), counts_X[rank], MPI_FLOAT, 0, MPI_COMM_WORLD);
+         MPI_Scatterv(y.data(), counts_y.data(), displs_y.data(), MPI_INT,
+                      local_y.data(), counts_y[rank], MPI_INT, 0, MPI_COMM_WORLD);
+         localX = local_X;
+         localY = local_y;
+     }
+
+     // Train on the same transformed features the evaluator and predictor
+     // score; mapped rows are read-only, so they are transformed into a copy
+     if (!transformFile.empty() && !stream) {
+         try {
+             feature_transform::FeatureTransform transform(transformFile);
+             if (transform.numFeatures() != numFeatures) {
+                 throw runtime_error("Transform " + transformFile + " has " + to_string(transform.numFeatures()) +
+                                     " features, dataset has " + to_string(numFeatures));
+             }
+             local_X.resize(localX.size());
+             transform.apply(localX.data(), local_X.data(), rows[rank]);
+             localX = local_X;
+         } catch (const exception& e) {
+             cerr << "Error: " << e.what() << endl;
+             MPI_Abort(MPI_COMM_WORLD, 1);
+         }
+         if (rank == 0) {
+             cout << "Applied feature transform " << transformFile << endl;
+         }
      }
  
-     auto endTime = chrono::high_resolution_clock::now();
-     trainingTime = chrono::duration<double>(endTime - startTime).count();
+     // RF, MLP and LR training times
+     vector<double> timings(3);
  
-     // Gather timing results
-     vector<double> timings(world_size);
-     MPI_Gather(&trainingTime, 1, MPI_DOUBLE, timings.data(), 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+     if (dataParallel || scheduled) {
+         // Only rank 0 reports progress
+         if (rank != 0) {
+             cout.setstate(ios::failbit);
+         }
+         vector<double> local = scheduled
+             ? trainScheduled(localX, localY, rows[rank], numFeatures, rfTrees)
+             : trainDataParallel(localX, localY, rows[rank], numFeatures, rfTrees, globalTrees, syncEvery,
+                                 binTrees ? &binned : nullptr);
+         cout.clear();
+         MPI_Reduce(local.data(), timings.data(), 3, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+     } else {
+         // Train the appropriate model based on rank
+         double trainingTime = 0.0;
+         auto startTime = chrono::high_resolution_clock::now();
+ 
+         if (rank == 0) {
+             // Random Forest
+             cout << "Rank 0: Training Random Forest..." << endl;
+             RandomForest rf(rfTrees, 5, 2, numFeatures, SplitMode::Histogram);
+             rf.train(localX, localY, rows[rank], numFeatures, binTrees ? &binned : nullptr);
+             rf.saveModel("random_forest_model.bin");
+         } 
+         else if (rank == 1) {
+             // MLP (Neural Network)
+             cout << "Rank 1: Training MLP Neural Network..." << endl;
+             vector<int> hiddenLayers = {16, 8};
+             MLP mlp(numFeatures, hiddenLayers, 2); // Assuming binary classification for now
+             // Mini-batches of 32; the learning rate is scaled by the batch size
+             // so each sample still contributes the same step as per-sample SGD at 0.01
+             mlp.train(localX, localY, rows[rank], numFeatures, MLP_EPOCHS, 0.01f * MLP_BATCH_SIZE, MLP_BATCH_SIZE);
+             mlp.saveModel("mlp_model.bin");
+         } 
+         else if (rank == 2) {
+             // Logistic Regression
+             cout << "Rank 2: Training Logistic Regression..." << endl;
+             LogisticRegression lr(numFeatures, 0.01, 100, LRSolver::LBFGS, 1e-6f);
+             lr.train(localX, localY, rows[rank], numFeatures);
+             lr.saveModel("logistic_regression_model.bin");
+         }
+ 
+         auto endTime = chrono::high_resolution_clock::now();
+         trainingTime = chrono::duration<double>(endTime - startTime).count();
+ 
+         // Gather timing results
+         MPI_Gather(&trainingTime, 1, MPI_DOUBLE, timings.data(), 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+     }
  
      // Print results
      if (rank == 0) {
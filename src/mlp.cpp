@@ -377,6 +377,10 @@
 #include "./include/omp_config.h"
 #include <cassert>
 #include <random>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include "./include/simd_kernels.h"
 
 using namespace std;
 
@@ -391,58 +395,79 @@ MLP::MLP(int inputSize, const vector<int>& hiddenSizes, int outputSize)
     rng = mt19937(rd());
     uniform_real_distribution<float> dist(-0.5, 0.5);
     
-    // Setup network architecture
-    vector<int> layerSizes;
+    // Setup network architecture and buffers
+    allocateLayers();
+    
+    // Initialize weights with small random values (biases start at zero)
+    for (size_t i = 0; i + 1 < layerSizes.size(); ++i) {
+        int currentLayerSize = layerSizes[i];
+        for (float& w : weights[i]) {
+            w = dist(rng) / sqrt(currentLayerSize);
+        }
+    }
+    refreshTransposedWeights();
+    
+    cout << "Initialized MLP with structure: ";
+    for (size_t i = 0; i < layerSizes.size(); ++i) {
+        cout << layerSizes[i];
+        if (i < layerSizes.size() - 1) cout << "->";
+    }
+    cout << endl;
+}
+
+// Size every per-layer buffer from inputSize/hiddenSizes/outputSize
+void MLP::allocateLayers() {
+    layerSizes.clear();
     layerSizes.push_back(inputSize);
     layerSizes.insert(layerSizes.end(), hiddenSizes.begin(), hiddenSizes.end());
     layerSizes.push_back(outputSize);
     
     int numLayers = layerSizes.size();
     
-    // Initialize weights and biases
-    weights.resize(numLayers-1);
-    biases.resize(numLayers-1);
-    activations.resize(numLayers);
-    deltas.resize(numLayers);
+    weights.assign(numLayers-1, AlignedFloatVector());
+    weightsT.assign(numLayers-1, AlignedFloatVector());
+    biases.assign(numLayers-1, vector<float>());
+    activations.assign(numLayers, vector<float>());
+    deltas.assign(numLayers, vector<float>());
     
-    // For each layer (except input)
     for (int i = 0; i < numLayers-1; ++i) {
-        int currentLayerSize = layerSizes[i];
-        int nextLayerSize = layerSizes[i+1];
-        
-        // Initialize weights with small random values
-        weights[i].resize(nextLayerSize);
-        for (int j = 0; j < nextLayerSize; ++j) {
-            weights[i][j].resize(currentLayerSize);
-            for (int k = 0; k < currentLayerSize; ++k) {
-                weights[i][j][k] = dist(rng) / sqrt(currentLayerSize);
-            }
+        weights[i].assign(static_cast<size_t>(layerSizes[i+1]) * layerSizes[i], 0.0f);
+        biases[i].assign(layerSizes[i+1], 0.0f);
+    }
+    for (int i = 0; i < numLayers; ++i) {
+        activations[i].assign(layerSizes[i], 0.0f);
+        deltas[i].assign(layerSizes[i], 0.0f);
+    }
+}
+
+// Rebuild the [input x neuron] copy used by the per-sample backward pass
+void MLP::refreshTransposedWeights() {
+    if (!useTransposedWeights) {
+        for (auto& t : weightsT) {
+            AlignedFloatVector().swap(t);
         }
-        
-        // Initialize biases with zeros
-        biases[i].resize(nextLayerSize, 0.0f);
-        
-        // Initialize activations
-        activations[i].resize(currentLayerSize, 0.0f);
-        
-        // Initialize deltas
-        deltas[i].resize(currentLayerSize, 0.0f);
+        return;
     }
     
-    // Initialize final layer activations and deltas
-    activations[numLayers-1].resize(layerSizes[numLayers-1], 0.0f);
-    deltas[numLayers-1].resize(layerSizes[numLayers-1], 0.0f);
-    
-    cout << "Initialized MLP with structure: ";
-    for (size_t i = 0; i < layerSizes.size(); ++i) {
-        cout << layerSizes[i];
-        if (i < layerSizes.size() - 1) cout << "->";
+    for (size_t layer = 0; layer < weights.size(); ++layer) {
+        int numNeurons = layerSizes[layer+1];
+        int prevLayerSize = layerSizes[layer];
+        weightsT[layer].resize(weights[layer].size());
+        for (int j = 0; j < numNeurons; ++j) {
+            for (int i = 0; i < prevLayerSize; ++i) {
+                weightsT[layer][static_cast<size_t>(i) * numNeurons + j] = weights[layer][static_cast<size_t>(j) * prevLayerSize + i];
+            }
+        }
     }
-    cout << endl;
+}
+
+void MLP::setUseTransposedWeights(bool enabled) {
+    useTransposedWeights = enabled;
+    refreshTransposedWeights();
 }
 
 float MLP::sigmoid(float x) {
-    return 1.0f / (1.0f + exp(-x));
+    return kernels::sigmoid(x);
 }
 
 float MLP::sigmoidDerivative(float x) {
@@ -458,21 +483,20 @@ void MLP::forwardPass(const vector<float>& input) {
     
     // For each layer (except input)
     for (size_t layer = 0; layer < weights.size(); ++layer) {
-        int numNeurons = weights[layer].size();
+        int numNeurons = layerSizes[layer+1];
+        int prevLayerSize = layerSizes[layer];
         
         // Parallel computation of activations for each neuron in the current layer
         #pragma omp parallel for
         for (int j = 0; j < numNeurons; ++j) {
-            float sum = biases[layer][j];
+            const float* w = &weights[layer][static_cast<size_t>(j) * prevLayerSize];
             
             // Sum of (weight * prev_activation) for each input to this neuron
-            for (size_t k = 0; k < weights[layer][j].size(); ++k) {
-                sum += weights[layer][j][k] * activations[layer][k];
-            }
-            
-            // Apply activation function
-            activations[layer+1][j] = sigmoid(sum);
+            activations[layer+1][j] = biases[layer][j] + kernels::dot(w, activations[layer].data(), prevLayerSize);
         }
+        
+        // Apply activation function to the whole layer
+        kernels::sigmoid(activations[layer+1].data(), activations[layer+1].data(), numNeurons);
     }
 }
 
@@ -496,14 +520,23 @@ void MLP::backwardPass(const vector<float>& input, const vector<float>& target)
     
     // Compute hidden layer deltas
     for (int layer = outputLayer - 1; layer > 0; --layer) {
-        int numNeurons = activations[layer].size();
-        int nextLayerSize = weights[layer].size();
+        int numNeurons = layerSizes[layer];
+        int nextLayerSize = layerSizes[layer+1];
+        const float* nextDeltas = deltas[layer+1].data();
         
         #pragma omp parallel for
         for (int i = 0; i < numNeurons; ++i) {
             float errorSum = 0.0f;
-            for (int j = 0; j < nextLayerSize; ++j) {
-                errorSum += weights[layer][j][i] * deltas[layer+1][j];
+            if (useTransposedWeights) {
+                // Row i of W^T is contiguous
+                const float* wt = &weightsT[layer][static_cast<size_t>(i) * nextLayerSize];
+                errorSum = kernels::dot(wt, nextDeltas, nextLayerSize);
+            } else {
+                // Column i of W, strided by the row length
+                const float* w = &weights[layer][i];
+                for (int j = 0; j < nextLayerSize; ++j) {
+                    errorSum += w[static_cast<size_t>(j) * numNeurons] * nextDeltas[j];
+                }
             }
             deltas[layer][i] = errorSum * activations[layer][i] * (1.0f - activations[layer][i]);
         }
@@ -512,14 +545,24 @@ void MLP::backwardPass(const vector<float>& input, const vector<float>& target)
 
 void MLP::updateWeights(const vector<float>& input, float learningRate) {
    for (size_t layer = 0; layer < weights.size(); ++layer) {
-       int numNeurons    = weights[layer].size();
-       int prevLayerSize = activations[layer].size();
+       int numNeurons    = layerSizes[layer+1];
+       int prevLayerSize = layerSizes[layer];
+       float* w = weights[layer].data();
+       const float* a = activations[layer].data();
+       const float* d = deltas[layer+1].data();
 
-       // Parallelize the full grid of (j,i) updates
-       #pragma omp parallel for collapse(2)
+       // Row j of W moves by -lr * delta_j * a (one axpy per neuron)
+       #pragma omp parallel for
        for (int j = 0; j < numNeurons; ++j) {
+           kernels::axpy(-learningRate * d[j], a, w + static_cast<size_t>(j) * prevLayerSize, prevLayerSize);
+       }
+
+       // Keep W^T in sync: row i moves by -lr * a_i * delta
+       if (useTransposedWeights) {
+           float* wt = weightsT[layer].data();
+           #pragma omp parallel for
            for (int i = 0; i < prevLayerSize; ++i) {
-               weights[layer][j][i] -= learningRate * deltas[layer+1][j] * activations[layer][i];
+               kernels::axpy(-learningRate * a[i], d, wt + static_cast<size_t>(i) * numNeurons, numNeurons);
            }
        }
 
@@ -531,8 +574,13 @@ void MLP::updateWeights(const vector<float>& input, float learningRate) {
    }
 }
 
-void MLP::train(const vector<float>& X, const vector<int>& y, int numSamples, int numFeatures, 
-               int epochs, float learningRate) {
+void MLP::train(FloatSpan X, LabelSpan y, int numSamples, int numFeatures, 
+               int epochs, float learningRate, int batchSize) {
+    if (batchSize > 1 || comm != MPI_COMM_NULL) {
+        trainMiniBatch(X, y, numSamples, numFeatures, epochs, learningRate, batchSize);
+        return;
+    }
+    
     cout << "Starting MLP training with " << numSamples << " samples..." << endl;
     
     vector<int> indices(numSamples);
@@ -584,37 +632,349 @@ void MLP::train(const vector<float>& X, const vector<int>& y, int numSamples, in
     cout << "MLP training completed." << endl;
 }
 
-vector<int> MLP::predict(const vector<float>& X, int numSamples, int numFeatures) {
-    vector<int> predictions(numSamples);
-    
-    for (int i = 0; i < numSamples; ++i) {
-        // Extract current sample
-        vector<float> input(numFeatures);
-        for (int j = 0; j < numFeatures; ++j) {
-            input[j] = X[i * numFeatures + j];
+// Blocked GEMM kernels for mini-batch training. All matrices are row-major
+// and each kernel must be called from inside a parallel region: the
+// orphaned "omp for" splits the output rows across the enclosing team.
+static const int GEMM_BLOCK = 32;
+
+// Elements per kernels::sigmoid call when a whole batch layer is activated
+static const int SIGMOID_BLOCK = 256;
+
+// C[M x N] = A[M x K] * B[N x K]^T + bias[N]
+static void gemmABtBias(const float* A, const float* B, const float* bias, float* C, int M, int N, int K) {
+    #pragma omp for schedule(static)
+    for (int i0 = 0; i0 < M; i0 += GEMM_BLOCK) {
+        int iEnd = min(i0 + GEMM_BLOCK, M);
+        for (int j0 = 0; j0 < N; j0 += GEMM_BLOCK) {
+            int jEnd = min(j0 + GEMM_BLOCK, N);
+            for (int i = i0; i < iEnd; ++i) {
+                const float* a = A + static_cast<size_t>(i) * K;
+                for (int j = j0; j < jEnd; ++j) {
+                    const float* b = B + static_cast<size_t>(j) * K;
+                    C[static_cast<size_t>(i) * N + j] = bias[j] + kernels::dot(a, b, K);
+                }
+            }
+        }
+    }
+}
+
+// C[M x N] = A[M x K] * B[K x N]
+static void gemmAB(const float* A, const float* B, float* C, int M, int N, int K) {
+    #pragma omp for schedule(static)
+    for (int i0 = 0; i0 < M; i0 += GEMM_BLOCK) {
+        int iEnd = min(i0 + GEMM_BLOCK, M);
+        for (int i = i0; i < iEnd; ++i) {
+            float* c = C + static_cast<size_t>(i) * N;
+            fill(c, c + N, 0.0f);
+            for (int k0 = 0; k0 < K; k0 += GEMM_BLOCK) {
+                int kEnd = min(k0 + GEMM_BLOCK, K);
+                for (int k = k0; k < kEnd; ++k) {
+                    kernels::axpy(A[static_cast<size_t>(i) * K + k], B + static_cast<size_t>(k) * N, c, N);
+                }
+            }
+        }
+    }
+}
+
+// C[M x N] = A[K x M]^T * B[K x N]
+static void gemmAtB(const float* A, const float* B, float* C, int M, int N, int K) {
+    #pragma omp for schedule(static)
+    for (int i = 0; i < M; ++i) {
+        float* c = C + static_cast<size_t>(i) * N;
+        fill(c, c + N, 0.0f);
+        for (int k0 = 0; k0 < K; k0 += GEMM_BLOCK) {
+            int kEnd = min(k0 + GEMM_BLOCK, K);
+            for (int k = k0; k < kEnd; ++k) {
+                kernels::axpy(A[static_cast<size_t>(k) * M + i], B + static_cast<size_t>(k) * N, c, N);
+            }
         }
+    }
+}
+
+void MLP::setCommunicator(MPI_Comm comm, int syncEvery) {
+    this->comm = comm;
+    this->syncEvery = max(1, syncEvery);
+}
+
+void MLP::packParameters(vector<float>& buffer) const {
+    buffer.clear();
+    for (size_t l = 0; l < weights.size(); ++l) {
+        buffer.insert(buffer.end(), weights[l].begin(), weights[l].end());
+        buffer.insert(buffer.end(), biases[l].begin(), biases[l].end());
+    }
+}
+
+void MLP::unpackParameters(const float* buffer, float scale) {
+    for (size_t l = 0; l < weights.size(); ++l) {
+        for (float& w : weights[l]) w = *buffer++ * scale;
+        for (float& b : biases[l]) b = *buffer++ * scale;
+    }
+}
+
+void MLP::getParameters(vector<float>& buffer) const {
+    packParameters(buffer);
+}
+
+void MLP::setParameters(const vector<float>& buffer) {
+    unpackParameters(buffer.data(), 1.0f);
+    refreshTransposedWeights();
+}
+
+void MLP::averageParameters(vector<float>& buffer) {
+    int worldSize;
+    MPI_Comm_size(comm, &worldSize);
+    packParameters(buffer);
+    MPI_Allreduce(MPI_IN_PLACE, buffer.data(), buffer.size(), MPI_FLOAT, MPI_SUM, comm);
+    unpackParameters(buffer.data(), 1.0f / worldSize);
+}
+
+void MLP::trainMiniBatch(FloatSpan X, LabelSpan y, int numSamples, int numFeatures,
+                         int epochs, float learningRate, int batchSize) {
+    cout << "Starting MLP mini-batch training with " << numSamples << " samples, batch size "
+         << batchSize << "..." << endl;
+    
+    const int numLayers = weights.size();
+    
+    // Data-parallel: every rank runs as many steps per epoch as the largest
+    // shard needs (a rank whose shard is used up contributes empty batches),
+    // so the collectives line up
+    const bool distributed = comm != MPI_COMM_NULL;
+    int maxSamples = numSamples;
+    vector<float> syncBuffer;
+    if (distributed) {
+        MPI_Allreduce(&numSamples, &maxSamples, 1, MPI_INT, MPI_MAX, comm);
+        packParameters(syncBuffer);
+        MPI_Bcast(syncBuffer.data(), syncBuffer.size(), MPI_FLOAT, 0, comm);
+        unpackParameters(syncBuffer.data(), 1.0f);
+    }
+    const int stepsPerEpoch = (maxSamples + batchSize - 1) / batchSize;
+    const bool syncGradients = distributed && syncEvery == 1;
+    
+    // Per-batch buffers, allocated once: activations and deltas are
+    // [batch x layerSize], gradients are [out x in] like the weights
+    vector<vector<float>> batchActs(numLayers + 1), batchDeltas(numLayers + 1);
+    for (int l = 0; l <= numLayers; ++l) {
+        batchActs[l].resize(static_cast<size_t>(batchSize) * layerSizes[l]);
+        batchDeltas[l].resize(static_cast<size_t>(batchSize) * layerSizes[l]);
+    }
+    vector<vector<float>> weightGrads(numLayers), biasGrads(numLayers);
+    for (int l = 0; l < numLayers; ++l) {
+        weightGrads[l].resize(weights[l].size());
+        biasGrads[l].resize(layerSizes[l + 1]);
+    }
+    
+    vector<int> indices(numSamples);
+    iota(indices.begin(), indices.end(), 0);
+    
+    for (int epoch = 0; epoch < epochs; ++epoch) {
+        shuffle(indices.begin(), indices.end(), rng);
         
-        // Forward pass
-        forwardPass(input);
+        float epochLoss = 0.0f;
         
-        // Get the class with highest probability
-        int outputLayer = weights.size();
-        int predictedClass = 0;
-        float maxProb = activations[outputLayer][0];
+        for (int stepIndex = 0; stepIndex < stepsPerEpoch; ++stepIndex) {
+            const int start = stepIndex * batchSize;
+            const int B = max(0, min(batchSize, numSamples - start));
+            float batchLoss = 0.0f;
+            
+            // One parallel region per batch; the GEMM kernels share the team
+            #pragma omp parallel
+            {
+                // Gather the batch rows
+                #pragma omp for schedule(static)
+                for (int b = 0; b < B; ++b) {
+                    const float* row = &X[static_cast<size_t>(indices[start + b]) * numFeatures];
+                    copy(row, row + inputSize, &batchActs[0][static_cast<size_t>(b) * inputSize]);
+                }
+                
+                // Forward: A[l+1] = sigmoid(A[l] * W[l]^T + b[l])
+                for (int l = 0; l < numLayers; ++l) {
+                    gemmABtBias(batchActs[l].data(), weights[l].data(), biases[l].data(),
+                                batchActs[l + 1].data(), B, layerSizes[l + 1], layerSizes[l]);
+                    
+                    const int count = B * layerSizes[l + 1];
+                    float* act = batchActs[l + 1].data();
+                    #pragma omp for schedule(static)
+                    for (int i = 0; i < count; i += SIGMOID_BLOCK) {
+                        kernels::sigmoid(act + i, act + i, min(SIGMOID_BLOCK, count - i));
+                    }
+                }
+                
+                // Output deltas and cross-entropy loss
+                const float* out = batchActs[numLayers].data();
+                float* outDelta = batchDeltas[numLayers].data();
+                #pragma omp for schedule(static) reduction(+:batchLoss)
+                for (int b = 0; b < B; ++b) {
+                    int label = y[indices[start + b]];
+                    for (int j = 0; j < outputSize; ++j) {
+                        size_t k = static_cast<size_t>(b) * outputSize + j;
+                        float target = (j == label) ? 1.0f : 0.0f;
+                        outDelta[k] = (out[k] - target) * out[k] * (1.0f - out[k]);
+                        if (target > 0) {
+                            batchLoss -= log(max(out[k], 1e-7f));
+                        }
+                    }
+                }
+                
+                // Backward: delta[l] = (delta[l+1] * W[l]) .* A[l] .* (1 - A[l])
+                for (int l = numLayers - 1; l > 0; --l) {
+                    gemmAB(batchDeltas[l + 1].data(), weights[l].data(), batchDeltas[l].data(),
+                           B, layerSizes[l], layerSizes[l + 1]);
+                    
+                    const int count = B * layerSizes[l];
+                    const float* act = batchActs[l].data();
+                    float* delta = batchDeltas[l].data();
+                    #pragma omp for schedule(static)
+                    for (int i = 0; i < count; ++i) {
+                        delta[i] *= act[i] * (1.0f - act[i]);
+                    }
+                }
+                
+                // Gradients: dW[l] = delta[l+1]^T * A[l], db[l] = column sums of delta[l+1]
+                for (int l = 0; l < numLayers; ++l) {
+                    gemmAtB(batchDeltas[l + 1].data(), batchActs[l].data(), weightGrads[l].data(),
+                            layerSizes[l + 1], layerSizes[l], B);
+                    
+                    const float* delta = batchDeltas[l + 1].data();
+                    #pragma omp for schedule(static) nowait
+                    for (int j = 0; j < layerSizes[l + 1]; ++j) {
+                        float sum = 0.0f;
+                        for (int b = 0; b < B; ++b) {
+                            sum += delta[static_cast<size_t>(b) * layerSizes[l + 1] + j];
+                        }
+                        biasGrads[l][j] = sum;
+                    }
+                }
+            }
+            
+            // Synchronous SGD: sum the batch gradients and row counts over the
+            // ranks and step with the global batch mean
+            int rowsInStep = B;
+            if (syncGradients) {
+                syncBuffer.clear();
+                for (int l = 0; l < numLayers; ++l) {
+                    syncBuffer.insert(syncBuffer.end(), weightGrads[l].begin(), weightGrads[l].end());
+                    syncBuffer.insert(syncBuffer.end(), biasGrads[l].begin(), biasGrads[l].end());
+                }
+                syncBuffer.push_back(static_cast<float>(B));
+                MPI_Allreduce(MPI_IN_PLACE, syncBuffer.data(), syncBuffer.size(), MPI_FLOAT, MPI_SUM, comm);
+                const float* p = syncBuffer.data();
+                for (int l = 0; l < numLayers; ++l) {
+                    copy(p, p + weightGrads[l].size(), weightGrads[l].begin());
+                    p += weightGrads[l].size();
+                    copy(p, p + biasGrads[l].size(), biasGrads[l].begin());
+                    p += biasGrads[l].size();
+                }
+                rowsInStep = static_cast<int>(*p);
+            }
+            
+            // Apply the averaged batch gradient
+            const float scale = rowsInStep > 0 ? learningRate / rowsInStep : 0.0f;
+            for (int l = 0; l < numLayers && rowsInStep > 0; ++l) {
+                kernels::axpy(-scale, weightGrads[l].data(), weights[l].data(), weights[l].size());
+                for (int j = 0; j < layerSizes[l + 1]; ++j) {
+                    biases[l][j] -= scale * biasGrads[l][j];
+                }
+            }
+            
+            epochLoss += batchLoss;
+            
+            // Local SGD: average the parameters every syncEvery steps
+            if (distributed && !syncGradients && (stepIndex + 1) % syncEvery == 0) {
+                averageParameters(syncBuffer);
+            }
+        }
         
-        for (int j = 1; j < outputSize; ++j) {
-            if (activations[outputLayer][j] > maxProb) {
-                maxProb = activations[outputLayer][j];
-                predictedClass = j;
+        int epochSamples = numSamples;
+        if (distributed) {
+            if (!syncGradients) {
+                averageParameters(syncBuffer);
             }
+            MPI_Allreduce(MPI_IN_PLACE, &epochLoss, 1, MPI_FLOAT, MPI_SUM, comm);
+            MPI_Allreduce(MPI_IN_PLACE, &epochSamples, 1, MPI_INT, MPI_SUM, comm);
         }
         
-        predictions[i] = predictedClass;
+        if ((epoch + 1) % 10 == 0 || epoch == 0 || epoch == epochs - 1) {
+            cout << "MLP Epoch " << (epoch + 1) << "/" << epochs 
+                 << ", Loss: " << (epochLoss / epochSamples) << endl;
+        }
     }
     
+    refreshTransposedWeights();
+    cout << "MLP training completed." << endl;
+}
+
+vector<int> MLP::predict(const vector<float>& X, int numSamples, int numFeatures) {
+    vector<int> predictions(numSamples);
+    predictBatch(X.data(), numSamples, numFeatures, predictions.data());
     return predictions;
 }
 
+// Implementation of ModelInterface::predictBatch on a row-major matrix
+template <typename Visit>
+void MLP::forwardBatch(const float* X, int N, int D, Visit visit) const {
+    // Rows are copied inputSize values at a time, so D has to match exactly
+    if (D != inputSize) {
+        throw invalid_argument("Feature count " + to_string(D) + " does not match model input size " +
+                               to_string(inputSize));
+    }
+    
+    size_t maxLayerSize = 0;
+    for (const auto& layer : activations) {
+        maxLayerSize = max(maxLayerSize, layer.size());
+    }
+    
+    // Rows are independent, so each thread runs whole forward passes with
+    // its own scratch buffers instead of sharing the member activations
+    #pragma omp parallel
+    {
+        vector<float> current(maxLayerSize), next(maxLayerSize);
+        
+        #pragma omp for schedule(static)
+        for (int i = 0; i < N; ++i) {
+            const float* row = X + static_cast<size_t>(i) * D;
+            copy(row, row + inputSize, current.begin());
+            
+            for (size_t layer = 0; layer < weights.size(); ++layer) {
+                int numNeurons = layerSizes[layer+1];
+                int prevLayerSize = layerSizes[layer];
+                for (int j = 0; j < numNeurons; ++j) {
+                    const float* w = &weights[layer][static_cast<size_t>(j) * prevLayerSize];
+                    next[j] = biases[layer][j] + kernels::dot(w, current.data(), prevLayerSize);
+                }
+                kernels::sigmoid(next.data(), next.data(), numNeurons);
+                swap(current, next);
+            }
+            visit(i, current.data());
+        }
+    }
+}
+
+void MLP::predictBatch(const float* X, int N, int D, int* out) {
+    forwardBatch(X, N, D, [&](int i, const float* outputs) {
+        // Get the class with highest probability
+        int predictedClass = 0;
+        for (int j = 1; j < outputSize; ++j) {
+            if (outputs[j] > outputs[predictedClass]) {
+                predictedClass = j;
+            }
+        }
+        out[i] = predictedClass;
+    });
+}
+
+void MLP::predictProbaBatch(const float* X, int N, int D, float* out) {
+    // The output units are independent sigmoids, so normalize them to sum
+    // to 1; with two outputs class 1 wins the argmax exactly when this is
+    // above 0.5
+    forwardBatch(X, N, D, [&](int i, const float* outputs) {
+        float total = 0.0f;
+        for (int j = 0; j < outputSize; ++j) {
+            total += outputs[j];
+        }
+        out[i] = outputSize > 1 && total > 0.0f ? outputs[1] / total : 0.0f;
+    });
+}
+
 // Implementation of ModelInterface::predict for single sample prediction
 int MLP::predict(const vector<float>& features) {
     // Verify that the input has the right size
@@ -664,15 +1024,10 @@ void MLP::saveModel(const string& filename) {
     
     // Write weights and biases
     for (size_t layer = 0; layer < weights.size(); ++layer) {
-        int numNeurons = weights[layer].size();
-        int prevLayerSize = layer == 0 ? inputSize : hiddenSizes[layer-1];
+        int numNeurons = layerSizes[layer+1];
         
-        // Write weights
-        for (int j = 0; j < numNeurons; ++j) {
-            for (int i = 0; i < prevLayerSize; ++i) {
-                outFile.write(reinterpret_cast<char*>(&weights[layer][j][i]), sizeof(float));
-            }
-        }
+        // Write weights (row-major [neuron][input], same order as before)
+        outFile.write(reinterpret_cast<const char*>(weights[layer].data()), weights[layer].size() * sizeof(float));
         
         // Write biases
         for (int j = 0; j < numNeurons; ++j) {
@@ -706,50 +1061,14 @@ void MLP::loadModel(const string& filename) {
     inFile.read(reinterpret_cast<char*>(&outputSize), sizeof(outputSize));
     
     // Setup network architecture
-    vector<int> layerSizes;
-    layerSizes.push_back(inputSize);
-    layerSizes.insert(layerSizes.end(), hiddenSizes.begin(), hiddenSizes.end());
-    layerSizes.push_back(outputSize);
-    
-    int numLayers = layerSizes.size();
-    
-    // Initialize weights and biases
-    weights.resize(numLayers-1);
-    biases.resize(numLayers-1);
-    activations.resize(numLayers);
-    deltas.resize(numLayers);
-    
-    // For each layer (except input)
-    for (int i = 0; i < numLayers-1; ++i) {
-        int currentLayerSize = layerSizes[i];
-        int nextLayerSize = layerSizes[i+1];
-        
-        weights[i].resize(nextLayerSize);
-        for (int j = 0; j < nextLayerSize; ++j) {
-            weights[i][j].resize(currentLayerSize);
-        }
-        
-        biases[i].resize(nextLayerSize);
-        
-        activations[i].resize(currentLayerSize, 0.0f);
-        deltas[i].resize(currentLayerSize, 0.0f);
-    }
-    
-    // Initialize final layer activations and deltas
-    activations[numLayers-1].resize(layerSizes[numLayers-1], 0.0f);
-    deltas[numLayers-1].resize(layerSizes[numLayers-1], 0.0f);
+    allocateLayers();
     
     // Read weights and biases
     for (size_t layer = 0; layer < weights.size(); ++layer) {
-        int numNeurons = weights[layer].size();
-        int prevLayerSize = layer == 0 ? inputSize : hiddenSizes[layer-1];
+        int numNeurons = layerSizes[layer+1];
         
         // Read weights
-        for (int j = 0; j < numNeurons; ++j) {
-            for (int i = 0; i < prevLayerSize; ++i) {
-                inFile.read(reinterpret_cast<char*>(&weights[layer][j][i]), sizeof(float));
-            }
-        }
+        inFile.read(reinterpret_cast<char*>(weights[layer].data()), weights[layer].size() * sizeof(float));
         
         // Read biases
         for (int j = 0; j < numNeurons; ++j) {
@@ -758,5 +1077,6 @@ void MLP::loadModel(const string& filename) {
     }
     
     inFile.close();
+    refreshTransposedWeights();
     cout << "MLP model loaded from " << filename << endl;
 }
\ No newline at end of file
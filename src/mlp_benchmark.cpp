@@ -0,0 +1,239 @@
+/**
+ * mlp_benchmark.cpp - Microbenchmark for MLP weight storage layouts
+ *
+ * Times the per-sample forward and backward kernels used by MLP with the
+ * original nested layout (one heap vector per neuron) against the
+ * contiguous 64-byte aligned row-major layout, with and without the
+ * transposed copy used by the backward pass. Inputs are rows of a
+ * processed dataset; the kernels mirror MLP::forwardPass/backwardPass
+ * without the OpenMP regions so only the memory layout differs.
+ */
+
+ #include <mpi.h>
+ #include <iostream>
+ #include <sstream>
+ #include <string>
+ #include <vector>
+ #include <random>
+ #include <chrono>
+ #include <cmath>
+ #include <iomanip>
+ #include "./include/evaluate.h"
+ #include "./include/aligned_allocator.h"
+
+ using namespace std;
+
+ static inline float sigmoid(float x) {
+     return 1.0f / (1.0f + exp(-x));
+ }
+
+ // Original layout: weights[layer][neuron][input]
+ struct NestedNet {
+     vector<vector<vector<float>>> weights;
+     vector<vector<float>> biases;
+     vector<vector<float>> activations;
+     vector<vector<float>> deltas;
+
+     void forward(const float* x) {
+         copy(x, x + activations[0].size(), activations[0].begin());
+         for (size_t l = 0; l < weights.size(); ++l) {
+             for (size_t j = 0; j < weights[l].size(); ++j) {
+                 float sum = biases[l][j];
+                 for (size_t k = 0; k < weights[l][j].size(); ++k) {
+                     sum += weights[l][j][k] * activations[l][k];
+                 }
+                 activations[l + 1][j] = sigmoid(sum);
+             }
+         }
+     }
+
+     void backward() {
+         for (size_t l = weights.size() - 1; l > 0; --l) {
+             for (size_t i = 0; i < activations[l].size(); ++i) {
+                 float errorSum = 0.0f;
+                 for (size_t j = 0; j < weights[l].size(); ++j) {
+                     errorSum += weights[l][j][i] * deltas[l + 1][j];
+                 }
+                 deltas[l][i] = errorSum * activations[l][i] * (1.0f - activations[l][i]);
+             }
+         }
+     }
+ };
+
+ // Current layout: one aligned [neuron x input] buffer per layer plus W^T
+ struct FlatNet {
+     vector<int> sizes;
+     vector<AlignedFloatVector> weights;
+     vector<AlignedFloatVector> weightsT;
+     vector<vector<float>> biases;
+     vector<vector<float>> activations;
+     vector<vector<float>> deltas;
+
+     void forward(const float* x) {
+         copy(x, x + sizes[0], activations[0].begin());
+         for (size_t l = 0; l < weights.size(); ++l) {
+             const int in = sizes[l], out = sizes[l + 1];
+             const float* a = activations[l].data();
+             for (int j = 0; j < out; ++j) {
+                 const float* w = &weights[l][static_cast<size_t>(j) * in];
+                 float sum = biases[l][j];
+                 for (int k = 0; k < in; ++k) {
+                     sum += w[k] * a[k];
+                 }
+                 activations[l + 1][j] = sigmoid(sum);
+             }
+         }
+     }
+
+     void backward(bool transposed) {
+         for (size_t l = weights.size() - 1; l > 0; --l) {
+             const int n = sizes[l], next = sizes[l + 1];
+             const float* d = deltas[l + 1].data();
+             for (int i = 0; i < n; ++i) {
+                 float errorSum = 0.0f;
+                 if (transposed) {
+                     const float* wt = &weightsT[l][static_cast<size_t>(i) * next];
+                     for (int j = 0; j < next; ++j) {
+                         errorSum += wt[j] * d[j];
+                     }
+                 } else {
+                     const float* w = &weights[l][i];
+                     for (int j = 0; j < next; ++j) {
+                         errorSum += w[static_cast<size_t>(j) * n] * d[j];
+                     }
+                 }
+                 deltas[l][i] = errorSum * activations[l][i] * (1.0f - activations[l][i]);
+             }
+         }
+     }
+ };
+
+ int main(int argc, char* argv[]) {
+     MPI_Init(&argc, &argv);
+
+     if (argc < 2) {
+         cerr << "Usage: " << argv[0] << " <data_file.csv> [hidden_sizes e.g. 16,8] [repeats]" << endl;
+         MPI_Finalize();
+         return 1;
+     }
+
+     vector<int> hidden;
+     stringstream hs(argc > 2 ? argv[2] : "16,8");
+     string tok;
+     while (getline(hs, tok, ',')) {
+         hidden.push_back(stoi(tok));
+     }
+     int repeats = argc > 3 ? stoi(argv[3]) : 5;
+
+     vector<float> X;
+     vector<int> y;
+     int N = 0, D = 0;
+     loadTestData(argv[1], X, y, N, D);
+
+     vector<int> sizes = {D};
+     sizes.insert(sizes.end(), hidden.begin(), hidden.end());
+     sizes.push_back(2);
+     const int numLayers = sizes.size() - 1;
+
+     // Same random weights in both layouts
+     mt19937 rng(42);
+     uniform_real_distribution<float> dist(-0.5f, 0.5f);
+     NestedNet nested;
+     FlatNet flat;
+     flat.sizes = sizes;
+     nested.weights.resize(numLayers);
+     flat.weights.resize(numLayers);
+     flat.weightsT.resize(numLayers);
+     for (int l = 0; l < numLayers; ++l) {
+         const int in = sizes[l], out = sizes[l + 1];
+         nested.weights[l].assign(out, vector<float>(in));
+         flat.weights[l].resize(static_cast<size_t>(out) * in);
+         flat.weightsT[l].resize(static_cast<size_t>(out) * in);
+         for (int j = 0; j < out; ++j) {
+             for (int k = 0; k < in; ++k) {
+                 float w = dist(rng) / sqrt(static_cast<float>(in));
+                 nested.weights[l][j][k] = w;
+                 flat.weights[l][static_cast<size_t>(j) * in + k] = w;
+                 flat.weightsT[l][static_cast<size_t>(k) * out + j] = w;
+             }
+         }
+         nested.biases.emplace_back(out, 0.0f);
+         flat.biases.emplace_back(out, 0.0f);
+     }
+     for (int size : sizes) {
+         nested.activations.emplace_back(size, 0.0f);
+         nested.deltas.emplace_back(size, 0.0f);
+         flat.activations.emplace_back(size, 0.0f);
+         flat.deltas.emplace_back(size, 0.0f);
+     }
+
+     auto seedDeltas = [&](vector<vector<float>>& deltas, const vector<vector<float>>& acts, int label) {
+         for (int j = 0; j < sizes.back(); ++j) {
+             float a = acts[numLayers][j];
+             deltas[numLayers][j] = (a - (j == label ? 1.0f : 0.0f)) * a * (1.0f - a);
+         }
+     };
+
+     // Forward-only passes are timed on their own; backward throughput is
+     // the extra time of forward+backward passes over the same rows
+     using clk = chrono::high_resolution_clock;
+     auto timeLoop = [&](auto&& body) {
+         auto start = clk::now();
+         for (int r = 0; r < repeats; ++r) {
+             for (int i = 0; i < N; ++i) {
+                 body(&X[static_cast<size_t>(i) * D], y[i]);
+             }
+         }
+         return chrono::duration<double>(clk::now() - start).count();
+     };
+
+     double tNestedFwd = timeLoop([&](const float* x, int) { nested.forward(x); });
+     double tFlatFwd = timeLoop([&](const float* x, int) { flat.forward(x); });
+     double tNestedBoth = timeLoop([&](const float* x, int label) {
+         nested.forward(x);
+         seedDeltas(nested.deltas, nested.activations, label);
+         nested.backward();
+     });
+     double tFlatStridedBoth = timeLoop([&](const float* x, int label) {
+         flat.forward(x);
+         seedDeltas(flat.deltas, flat.activations, label);
+         flat.backward(false);
+     });
+     double tFlatTBoth = timeLoop([&](const float* x, int label) {
+         flat.forward(x);
+         seedDeltas(flat.deltas, flat.activations, label);
+         flat.backward(true);
+     });
+     double tNestedBwd = tNestedBoth - tNestedFwd;
+     double tFlatBwdStrided = tFlatStridedBoth - tFlatFwd;
+     double tFlatBwdT = tFlatTBoth - tFlatFwd;
+
+     // Both layouts hold the same weights, so the last deltas must agree
+     float checksum = 0.0f;
+     for (int l = 1; l < numLayers; ++l) {
+         for (int i = 0; i < sizes[l]; ++i) {
+             checksum += fabs(nested.deltas[l][i] - flat.deltas[l][i]);
+         }
+     }
+
+     double samples = static_cast<double>(N) * repeats;
+     cout << "==================================================" << endl;
+     cout << "MLP LAYOUT MICROBENCHMARK (single thread)" << endl;
+     cout << "Network: ";
+     for (size_t i = 0; i < sizes.size(); ++i) {
+         cout << sizes[i] << (i + 1 < sizes.size() ? "->" : "");
+     }
+     cout << ", " << N << " samples x " << repeats << " repeats" << endl;
+     cout << "--------------------------------------------------" << endl;
+     cout << fixed << setprecision(0);
+     cout << "Forward  nested:            " << samples / tNestedFwd << " samples/s" << endl;
+     cout << "Forward  contiguous:        " << samples / tFlatFwd << " samples/s" << endl;
+     cout << "Backward nested:            " << samples / tNestedBwd << " samples/s" << endl;
+     cout << "Backward contiguous stride: " << samples / tFlatBwdStrided << " samples/s" << endl;
+     cout << "Backward contiguous W^T:    " << samples / tFlatBwdT << " samples/s" << endl;
+     cout << setprecision(6) << "Delta difference (last sample): " << checksum << endl;
+     cout << "==================================================" << endl;
+
+     MPI_Finalize();
+     return 0;
+ }
@@ -6,11 +6,16 @@
  #include "../include/evaluate.h"
  #include "../include/common.h"
  #include "../include/csv.h"
+ #include "../include/binary_dataset.h"
+ #include "../include/feature_transform.h"
  #include <mpi.h>
  #include <iostream>
+ #include <fstream>
  #include <string>
  #include <vector>
  #include <algorithm>
+ #include <memory>
+ #include <stdexcept>
  
  int main(int argc, char* argv[]) {
      // Initialize MPI
@@ -19,21 +24,34 @@
      MPI_Comm_rank(MPI_COMM_WORLD, &rank);
      MPI_Comm_size(MPI_COMM_WORLD, &size);
  
-     // Parse command line arguments
-     if (argc < 3) {
+     // Parse command line arguments: test data, then model paths, with an
+     // optional --transform <file>|none anywhere
+     std::string testDataFile;
+     std::string transformFile;
+     std::vector<std::string> modelPaths;
+     for (int i = 1; i < argc; i++) {
+         std::string arg = argv[i];
+         if (arg == "--transform" && i + 1 < argc) {
+             transformFile = argv[++i];
+         } else if (testDataFile.empty()) {
+             testDataFile = arg;
+         } else {
+             modelPaths.push_back(arg);
+         }
+     }
+
+     if (testDataFile.empty() || modelPaths.empty()) {
          if (rank == 0) {
-             std::cerr << "Usage: " << argv[0] << " <test_data.csv> <model1_path> [model2_path] ...\n";
+             std::cerr << "Usage: " << argv[0] << " [--transform <file>|none] <test_data.csv> <model1_path> [model2_path] ...\n";
          }
          MPI_Finalize();
          return 1;
      }
- 
-     const std::string testDataFile = argv[1];
-     std::vector<std::string> modelPaths;
-     
-     // Collect all model paths
-     for (int i = 2; i < argc; i++) {
-         modelPaths.push_back(argv[i]);
+     // Same default as hybrid_ml_trainer, so models are scored on what they were trained on
+     if (transformFile.empty() && std::ifstream(feature_transform::DEFAULT_TRANSFORM_FILE).good()) {
+         transformFile = feature_transform::DEFAULT_TRANSFORM_FILE;
+     } else if (transformFile == "none") {
+         transformFile.clear();
      }
  
      // Distribute models among MPI ranks
@@ -47,20 +65,61 @@
                    << size << " MPI processes\n";
      }
  
-     // Load test data (everyone loads the same data)
+     // Load test data (everyone loads the same data). A binary dataset is
+     // memory-mapped, so ranks on one node share the page cache instead of
+     // each holding a parsed copy
      std::vector<float> X;
      std::vector<int> y;
+     std::unique_ptr<binary_dataset::MappedDataset> mapped;
+     FloatSpan features;
+     LabelSpan labels;
      int N, D;
      
      if (rank == 0) {
          std::cout << "Loading test data from " << testDataFile << "...\n";
      }
      
-     loadTestData(testDataFile, X, y, N, D);
+     if (binary_dataset::isBinaryDataset(testDataFile)) {
+         try {
+             mapped = std::make_unique<binary_dataset::MappedDataset>(testDataFile);
+         } catch (const std::exception& e) {
+             std::cerr << "Error: " << e.what() << std::endl;
+             MPI_Abort(MPI_COMM_WORLD, 1);
+         }
+         N = mapped->numRows();
+         D = mapped->numFeatures();
+         features = mapped->features();
+         labels = mapped->labels();
+     } else {
+         loadTestData(testDataFile, X, y, N, D);
+         features = X;
+         labels = y;
+     }
      
      if (rank == 0) {
          std::cout << "Loaded " << N << " samples with " << D << " features\n";
      }
+
+     // Score the features the models were trained on
+     std::vector<float> transformedX;
+     if (!transformFile.empty()) {
+         try {
+             feature_transform::FeatureTransform transform(transformFile);
+             if (transform.numFeatures() != D) {
+                 throw std::runtime_error("Transform " + transformFile + " has " + std::to_string(transform.numFeatures()) +
+                                          " features, test data has " + std::to_string(D));
+             }
+             transformedX.resize(features.size());
+             transform.apply(features.data(), transformedX.data(), N);
+         } catch (const std::exception& e) {
+             std::cerr << "Error: " << e.what() << std::endl;
+             MPI_Abort(MPI_COMM_WORLD, 1);
+         }
+         features = transformedX;
+         if (rank == 0) {
+             std::cout << "Applied feature transform " << transformFile << "\n";
+         }
+     }
  
      // Evaluate each local model
      for (const auto& modelPath : localModelPaths) {
@@ -68,7 +127,7 @@
              std::cout << "Evaluating model: " << modelPath << std::endl;
          }
          
-         Metrics metrics = evaluateModel(modelPath, X, y, N, D);
+         Metrics metrics = evaluateModel(modelPath, features, labels, N, D);
          
          // Gather and print metrics from all processes
          MPI_Barrier(MPI_COMM_WORLD);
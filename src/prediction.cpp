@@ -3,53 +3,26 @@
  * 
  * This file implements a command-line application that loads the trained
  * models (Random Forest, MLP, and Logistic Regression) and uses them to
- * make predictions on loan approval based on user input.
+ * make predictions on loan approval based on user input. With --serve or
+ * --socket it stays up, keeps the models loaded and scores a stream of
+ * requests (see scoring_server.h).
  */
 
  #include <iostream>
- #include <fstream>
  #include <vector>
  #include <string>
- #include <algorithm>
  #include <iomanip>
- #include "./include/random_forest.h"
- #include "./include/mlp.h"
- #include "./include/logistic_regression.h"
+ #include <chrono>
+ #include <stdexcept>
+ #include <cstdio>
+ #include <unistd.h>
+ #include "./include/loan_scorer.h"
+ #include "./include/scoring_server.h"
+ #include "./include/csv_loader.h"
  
  using namespace std;
  
- // Function to normalize input features based on training data statistics
- vector<float> normalizeInput(float income, float credit_score, float loan_amount, float dti_ratio, int employment_status) {
-     // These values should come from your training data statistics
-     // For now, using reasonable ranges as example
-     // const float income_mean = 70000.0f, income_std = 30000.0f;
-     // const float credit_score_mean = 650.0f, credit_score_std = 100.0f;
-     // const float loan_amount_mean = 150000.0f, loan_amount_std = 100000.0f;
-     // const float dti_ratio_mean = 0.35f, dti_ratio_std = 0.15f;
-        const float income_mean = 110377.55f;
-        const float income_std = 51729.68f;
-        
-        const float credit_score_mean = 575.72f;
-        const float credit_score_std = 159.23f;
-        
-        const float loan_amount_mean = 44356.15f;
-        const float loan_amount_std = 34666.60f;
-        
-        const float dti_ratio_mean = 34.72f;
-        const float dti_ratio_std = 32.32f;
-
-     
-     vector<float> normalized(5);
-     normalized[0] = (income - income_mean) / income_std;
-     normalized[1] = (credit_score - credit_score_mean) / credit_score_std;
-     normalized[2] = (loan_amount - loan_amount_mean) / loan_amount_std;
-     normalized[3] = (dti_ratio - dti_ratio_mean) / dti_ratio_std;
-     normalized[4] = static_cast<float>(employment_status); // Binary feature, no normalization needed
-     
-     return normalized;
- }
- 
- // Function to get user input
+ // Function to get user input as a raw feature row
  vector<float> getUserInput() {
      float income, credit_score, loan_amount, dti_ratio;
      int employment_status;
@@ -70,206 +43,209 @@
      cout << "Enter Employment Status (1 = Employed, 0 = Unemployed): ";
      cin >> employment_status;
      
-     return normalizeInput(income, credit_score, loan_amount, dti_ratio, employment_status);
+     return {income, credit_score, loan_amount, dti_ratio, static_cast<float>(employment_status)};
  }
  
- // Function to make ensemble prediction
- string makePrediction(const vector<float>& features) {
-     // Initialize models with proper constructors matching the training configuration
-     // From the logs, Random Forest used 5 trees, not 100
-     RandomForest rf(5, 10, 5, 5);  // 5 trees based on training output
-     
-     // From the logs, MLP used architecture 5->16->8->2
-     MLP mlp(5, {16, 8}, 2);  // Match the architecture shown in training logs
-     
-     // For Logistic Regression, we need to specify number of features
-     LogisticRegression lr(5);  // 5 input features
-     
-     // Load models - wrap each in separate try/catch to handle failures gracefully
-     bool rf_loaded = false, mlp_loaded = false, lr_loaded = false;
-     
-     try {
-         // RandomForest requires prefix and number of trees
-         rf.loadModel("random_forest_model.bin", 5);  // Match the number of trees (5)
-         rf_loaded = true;
-     } catch (const exception& e) {
-         cerr << "Error loading Random Forest model: " << e.what() << endl;
+ static void printVote(const string& model, bool available, int vote) {
+     if (!available) {
+         cout << model << ": Model not available" << endl;
+     } else if (vote < 0) {
+         cout << model << ": Failed to produce prediction" << endl;
+     } else {
+         cout << model << ": " << (vote == 1 ? "Approved" : "Not Approved") << endl;
      }
-     
-     try {
-         mlp.loadModel("mlp_model.bin");
-         mlp_loaded = true;
-     } catch (const exception& e) {
-         cerr << "Error loading MLP model: " << e.what() << endl;
+ }
+ 
+ // One interactive decision, as before the server modes existed
+ static int runInteractive(const string& modelDir, const ScorerOptions& scorerOptions) {
+     vector<float> features = getUserInput();
+     LoanScorer scorer(modelDir, scorerOptions);
+ 
+     if (!scorer.anyModelLoaded()) {
+         cerr << "Fatal error: No models could be loaded. Make sure you have trained the models first." << endl;
+         cout << "\n===== Final Decision =====" << endl;
+         cout << "Loan Application Status: Unknown" << endl;
+         cout << "Risk Assessment: Not available (models could not be loaded)" << endl;
+         return 0;
      }
-     
+ 
+     LoanDecision decision = scorer.scoreBatch(features.data(), 1)[0];
+ 
+     cout << "\n===== Model Predictions =====" << endl;
+     printVote("Random Forest", scorer.rfAvailable(), decision.rfVote);
+     printVote("Neural Network", scorer.mlpAvailable(), decision.mlpVote);
+     printVote("Logistic Regression", scorer.lrAvailable(), decision.lrVote);
+ 
+     cout << "\n===== Final Decision =====" << endl;
+     cout << "Loan Application Status: " << outcomeText(decision.outcome) << endl;
+ 
+     if (decision.riskScore >= 0.0f) {
+         cout << "Risk Assessment Score: " << fixed << setprecision(1) << decision.riskScore << "/100" << endl;
+     } else {
+         cout << "Risk Assessment: Not available (models could not be loaded)" << endl;
+     }
+     return 0;
+ }
+ 
+ // Fit the stacked meta-learner on labelled rows in the preprocessor's CSV
+ // layout and save it next to the models
+ static int runFitStacker(const string& modelDir, const string& dataFile, const ScorerOptions& scorerOptions) {
+     vector<float> X;
+     vector<int> y;
+     int N = 0, D = 0;
      try {
-         lr.loadModel("logistic_regression_model.bin");
-         lr_loaded = true;
+         csv_loader::loadCsv(dataFile, X, y, N, D);
      } catch (const exception& e) {
-         cerr << "Error loading Logistic Regression model: " << e.what() << endl;
+         cerr << "Error: " << e.what() << endl;
+         return 1;
      }
-     
-     // Check if at least one model was loaded successfully
-     if (!rf_loaded && !mlp_loaded && !lr_loaded) {
+     if (D != LOAN_FEATURES || N == 0) {
+         cerr << "Error: " << dataFile << " has " << D << " feature columns and " << N
+              << " rows; expected " << LOAN_FEATURES << " feature columns and a label" << endl;
+         return 1;
+     }
+
+     ScorerOptions weighted = scorerOptions;
+     weighted.useStacker = false;
+     LoanScorer scorer(modelDir, weighted);
+     if (!scorer.anyModelLoaded()) {
          cerr << "Fatal error: No models could be loaded. Make sure you have trained the models first." << endl;
-         return "Unknown";
+         return 1;
      }
-     
-     // Make predictions only with successfully loaded models
-     int votes_approve = 0;
-     int votes_total = 0;
-     
-     cout << "\n===== Model Predictions =====" << endl;
-     
-     // Random Forest prediction
-     if (rf_loaded) {
-         try {
-             int rf_prediction = rf.predict(features);
-             votes_approve += (rf_prediction == 1);
-             votes_total++;
-             cout << "Random Forest: " << (rf_prediction == 1 ? "Approved" : "Not Approved") << endl;
-         } catch (const exception& e) {
-             cerr << "Error during Random Forest prediction: " << e.what() << endl;
+
+     // Accuracy of each model's vote and of the combined approval probability
+     auto report = [&](const string& label) {
+         vector<LoanDecision> decisions = scorer.scoreBatch(X.data(), N);
+         int correct[4] = {0, 0, 0, 0};
+         for (int i = 0; i < N; ++i) {
+             const LoanDecision& d = decisions[i];
+             correct[0] += d.rfVote == y[i];
+             correct[1] += d.mlpVote == y[i];
+             correct[2] += d.lrVote == y[i];
+             correct[3] += (d.riskScore > 50.0f ? 1 : 0) == y[i];
          }
-     } else {
-         cout << "Random Forest: Model not available" << endl;
-     }
-     
-     // MLP prediction
-     if (mlp_loaded) {
-         try {
-             vector<int> mlp_predictions = mlp.predict(features, 1, 5);
-             if (!mlp_predictions.empty()) {
-                 int mlp_prediction = mlp_predictions[0];
-                 votes_approve += (mlp_prediction == 1);
-                 votes_total++;
-                 cout << "Neural Network: " << (mlp_prediction == 1 ? "Approved" : "Not Approved") << endl;
-             } else {
-                 cout << "Neural Network: Failed to produce prediction" << endl;
+         cout << label << " accuracy on " << N << " rows:";
+         const char* names[4] = {" RF ", ", MLP ", ", LR ", ", ensemble "};
+         const bool available[4] = {scorer.rfAvailable(), scorer.mlpAvailable(), scorer.lrAvailable(), true};
+         for (int k = 0; k < 4; ++k) {
+             if (available[k]) {
+                 cout << names[k] << fixed << setprecision(4) << static_cast<double>(correct[k]) / N;
              }
-         } catch (const exception& e) {
-             cerr << "Error during MLP prediction: " << e.what() << endl;
          }
-     } else {
-         cout << "Neural Network: Model not available" << endl;
-     }
-     
-     // Logistic Regression prediction
-     if (lr_loaded) {
-         try {
-             vector<int> lr_predictions = lr.predict(features, 1, 5);
-             if (!lr_predictions.empty()) {
-                 int lr_prediction = lr_predictions[0];
-                 votes_approve += (lr_prediction == 1);
-                 votes_total++;
-                 cout << "Logistic Regression: " << (lr_prediction == 1 ? "Approved" : "Not Approved") << endl;
-             } else {
-                 cout << "Logistic Regression: Failed to produce prediction" << endl;
-             }
-         } catch (const exception& e) {
-             cerr << "Error during Logistic Regression prediction: " << e.what() << endl;
-         }
-     } else {
-         cout << "Logistic Regression: Model not available" << endl;
-     }
-     
-     // Handle case where no predictions could be made
-     if (votes_total == 0) {
-         return "Could not make predictions with available models";
-     }
-     
-     // Ensemble voting logic
-     float approval_ratio = static_cast<float>(votes_approve) / votes_total;
-     
-     if (approval_ratio > 0.5f) {
-         return "Approved";
-     } else if (approval_ratio == 0.5f) {
-         return "Borderline - Additional Review Required";
-     } else {
-         return "Not Approved";
+         cout << endl;
+     };
+
+     report("Weighted soft vote");
+     const string stackerFile = modelDir.empty() || modelDir == "." ? DEFAULT_STACKER_FILE
+                                                                    : modelDir + "/" + DEFAULT_STACKER_FILE;
+     try {
+         scorer.fitStacker(X.data(), y.data(), N, stackerFile);
+     } catch (const exception& e) {
+         cerr << "Error: " << e.what() << endl;
+         return 1;
      }
+     report("Stacked");
+     cout << "Ensemble meta-learner saved to " << stackerFile << endl;
+     return 0;
  }
  
- // Calculate risk score based on model confidences
- float calculateRiskScore(const vector<float>& features, LogisticRegression& lr, MLP& mlp, bool lr_loaded, bool mlp_loaded) {
-     float risk_score = 50.0f;  // Default middle score
-     float weight_sum = 0.0f;
-     
-     // Get probability from Logistic Regression if loaded
-     if (lr_loaded) {
-         try {
-             vector<float> lr_probs = lr.predictProbabilities(features, 1, 5);
-             if (!lr_probs.empty()) {
-                 float lr_prob = lr_probs[0];
-                 risk_score += lr_prob * 50.0f;  // 50% weight
-                 weight_sum += 0.5f;
+ static void printUsage(const char* program) {
+     cout << "Usage: " << program << " [options]" << endl;
+     cout << "  (no options)        Read one application interactively and print the decision" << endl;
+     cout << "  --serve             Score newline-delimited requests from stdin until EOF" << endl;
+     cout << "  --socket <path>     Score requests from clients of a Unix domain socket" << endl;
+     cout << "  --max-batch <n>     Requests scored together at most (default 64)" << endl;
+     cout << "  --batch-deadline-us <n>  Longest a request waits for a batch to fill (default 200)" << endl;
+     cout << "  --models <dir>      Directory with the model files and feature_transform.bin" << endl;
+     cout << "  --weights <rf,mlp,lr>  Soft-vote weights when no meta-learner is used (default 1,1,1)" << endl;
+     cout << "  --no-stacker        Ignore ensemble_stacker.bin and use the weighted soft vote" << endl;
+     cout << "  --fit-stacker <csv> Fit the stacked meta-learner on labelled held-out rows and save it" << endl;
+     cout << "Request line: income,credit_score,loan_amount,dti_ratio,employment_status" << endl;
+     cout << "Response line: outcome,rf_vote,mlp_vote,lr_vote,risk_score" << endl;
+ }
+ 
+ int main(int argc, char* argv[]) {
+     bool serve = false;
+     string socketPath;
+     string modelDir = ".";
+     string stackerData;
+     ServerOptions options;
+     ScorerOptions scorerOptions;
+ 
+     for (int i = 1; i < argc; ++i) {
+         string arg = argv[i];
+         if (arg == "--serve") {
+             serve = true;
+         } else if (arg == "--socket" && i + 1 < argc) {
+             socketPath = argv[++i];
+         } else if (arg == "--models" && i + 1 < argc) {
+             modelDir = argv[++i];
+         } else if (arg == "--max-batch" && i + 1 < argc) {
+             try {
+                 options.batching.maxBatch = stoi(argv[++i]);
+             } catch (const exception&) {
+                 options.batching.maxBatch = 0;
              }
-         } catch (const exception& e) {
-             cerr << "Warning: Could not get probabilities from Logistic Regression: " << e.what() << endl;
-         }
-     }
-     
-     // For MLP, use the binary prediction as a proxy for confidence if loaded
-     if (mlp_loaded) {
-         try {
-             vector<int> mlp_pred = mlp.predict(features, 1, 5);
-             if (!mlp_pred.empty()) {
-                 float mlp_conf = (mlp_pred[0] == 1) ? 0.8f : 0.2f;
-                 risk_score += mlp_conf * 50.0f;  // 50% weight
-                 weight_sum += 0.5f;
+             if (options.batching.maxBatch <= 0) {
+                 cerr << "Error: --max-batch requires a positive integer." << endl;
+                 return 1;
+             }
+         } else if (arg == "--batch-deadline-us" && i + 1 < argc) {
+             int micros = -1;
+             try {
+                 micros = stoi(argv[++i]);
+             } catch (const exception&) {
+             }
+             if (micros < 0) {
+                 cerr << "Error: --batch-deadline-us requires a non-negative integer." << endl;
+                 return 1;
              }
-         } catch (const exception& e) {
-             cerr << "Warning: Could not get prediction from MLP: " << e.what() << endl;
+             options.batching.deadline = chrono::microseconds(micros);
+         } else if (arg == "--weights" && i + 1 < argc) {
+             float w[3] = {-1.0f, -1.0f, -1.0f};
+             char extra = 0;
+             if (sscanf(argv[++i], "%f,%f,%f%c", &w[0], &w[1], &w[2], &extra) != 3 ||
+                 !(w[0] >= 0.0f && w[1] >= 0.0f && w[2] >= 0.0f) || w[0] + w[1] + w[2] <= 0.0f) {
+                 cerr << "Error: --weights requires three non-negative numbers rf,mlp,lr, not all zero." << endl;
+                 return 1;
+             }
+             scorerOptions.rfWeight = w[0];
+             scorerOptions.mlpWeight = w[1];
+             scorerOptions.lrWeight = w[2];
+         } else if (arg == "--no-stacker") {
+             scorerOptions.useStacker = false;
+         } else if (arg == "--fit-stacker" && i + 1 < argc) {
+             stackerData = argv[++i];
+         } else {
+             printUsage(argv[0]);
+             return arg == "--help" ? 0 : 1;
          }
      }
-     
-     // Adjust score based on actual weights used
-     if (weight_sum > 0.0f) {
-         risk_score /= weight_sum * 2.0f;  // Normalize to 0-100 scale
+ 
+     if (!stackerData.empty()) {
+         return runFitStacker(modelDir, stackerData, scorerOptions);
+     }
+     if (!serve && socketPath.empty()) {
+         return runInteractive(modelDir, scorerOptions);
      }
-     
-     return risk_score;
- }
  
- int main() {
-     vector<float> features = getUserInput();
-     string prediction = makePrediction(features);
-     
-     cout << "\n===== Final Decision =====" << endl;
-     cout << "Loan Application Status: " << prediction << endl;
-     
-     // Create and load models for risk score
-     bool lr_loaded = false, mlp_loaded = false;
-     LogisticRegression lr(5);
-     // Use the correct architecture from training logs
-     MLP mlp(5, {16, 8}, 2);
-     
-     try {
-         lr.loadModel("logistic_regression_model.bin");
-         lr_loaded = true;
-     } catch (const exception& e) {
-         cerr << "Warning: Could not load Logistic Regression model for risk scoring: " << e.what() << endl;
+     // Responses own stdout; model and server logging goes to stderr
+     cout.rdbuf(cerr.rdbuf());
+     LoanScorer scorer(modelDir, scorerOptions);
+     if (!scorer.anyModelLoaded()) {
+         cerr << "Fatal error: No models could be loaded. Make sure you have trained the models first." << endl;
+         return 1;
      }
-     
+ 
      try {
-         mlp.loadModel("mlp_model.bin");
-         mlp_loaded = true;
-     } catch (const exception& e) {
-         cerr << "Warning: Could not load MLP model for risk scoring: " << e.what() << endl;
-     }
-     
-     // Calculate and display risk score only if at least one model is loaded
-     if (lr_loaded || mlp_loaded) {
-         try {
-             float risk_score = calculateRiskScore(features, lr, mlp, lr_loaded, mlp_loaded);
-             cout << "Risk Assessment Score: " << fixed << setprecision(1) << risk_score << "/100" << endl;
-         } catch (const exception& e) {
-             cerr << "Warning: Could not calculate risk score: " << e.what() << endl;
+         if (!socketPath.empty()) {
+             serveSocket(scorer, socketPath, options);
+         } else {
+             serveStream(scorer, STDIN_FILENO, STDOUT_FILENO, options);
          }
-     } else {
-         cout << "Risk Assessment: Not available (models could not be loaded)" << endl;
+     } catch (const exception& e) {
+         cerr << "Error: " << e.what() << endl;
+         return 1;
      }
-     
      return 0;
  }
@@ -10,9 +10,183 @@
  #include <algorithm>
  #include <numeric>
  #include <fstream>
+ #include <sstream>
+ #include <stdexcept>
+ #include <cstring>
+ #include <climits>
  #include "include/omp_config.h"
  #include <chrono>
  
+ // Quantile cut points of a sorted column, taken from the data itself;
+ // low-cardinality columns end up with one bin per distinct value
+ static std::vector<float> quantileEdges(std::vector<float>& column, int maxBins) {
+     std::vector<float> edges;
+     const size_t count = column.size();
+     if (count == 0) {
+         return edges;
+     }
+     for (int b = 1; b <= maxBins; ++b) {
+         size_t pos = static_cast<size_t>(b) * count / maxBins;
+         if (pos == 0) continue;
+         float edge = column[pos - 1];
+         if (edges.empty() || edge > edges.back()) {
+             edges.push_back(edge);
+         }
+     }
+     if (edges.empty() || edges.back() < column.back()) {
+         edges.push_back(column.back());
+     }
+ 
+     std::vector<float> distinct(column.begin(), std::unique(column.begin(), column.end()));
+     if (distinct.size() <= static_cast<size_t>(maxBins)) {
+         edges = std::move(distinct);
+     }
+     return edges;
+ }
+ 
+ // Feature binning for histogram split finding
+ void BinnedFeatures::build(FloatSpan X, LabelSpan y,
+                            int numSamples, int numFeatures, int maxBins) {
+     this->numSamples = numSamples;
+     this->numFeatures = numFeatures;
+     maxBins = std::max(1, std::min(maxBins, kMaxBins));
+ 
+     // Labels are expected to be encoded as 0..K-1
+     numClasses = 0;
+     for (int i = 0; i < numSamples; ++i) {
+         numClasses = std::max(numClasses, y[i] + 1);
+     }
+ 
+     binEdges.assign(numFeatures, std::vector<float>());
+ 
+     #pragma omp parallel for schedule(dynamic)
+     for (int f = 0; f < numFeatures; ++f) {
+         std::vector<float> column(numSamples);
+         for (int i = 0; i < numSamples; ++i) {
+             column[i] = X[static_cast<size_t>(i) * numFeatures + f];
+         }
+         std::sort(column.begin(), column.end());
+         binEdges[f] = quantileEdges(column, maxBins);
+     }
+ 
+     binColumns(X);
+ }
+ 
+ void BinnedFeatures::buildDistributed(FloatSpan X, LabelSpan y, int numSamples, int numFeatures,
+                                       MPI_Comm comm, int maxBins) {
+     int worldSize;
+     MPI_Comm_size(comm, &worldSize);
+     this->numSamples = numSamples;
+     this->numFeatures = numFeatures;
+     maxBins = std::max(1, std::min(maxBins, kMaxBins));
+ 
+     numClasses = 0;
+     for (int i = 0; i < numSamples; ++i) {
+         numClasses = std::max(numClasses, y[i] + 1);
+     }
+     MPI_Allreduce(MPI_IN_PLACE, &numClasses, 1, MPI_INT, MPI_MAX, comm);
+ 
+     binEdges.assign(numFeatures, std::vector<float>());
+     std::vector<int> counts(worldSize), displs(worldSize);
+     for (int f = 0; f < numFeatures; ++f) {
+         std::vector<float> column(numSamples);
+         for (int i = 0; i < numSamples; ++i) {
+             column[i] = X[static_cast<size_t>(i) * numFeatures + f];
+         }
+         std::sort(column.begin(), column.end());
+         std::vector<float> local = quantileEdges(column, maxBins);
+ 
+         // Every rank sees the same union of local edges, so its quantiles
+         // are the same everywhere. The union holds each shard's maximum, and
+         // it is every distinct value when no shard has more than maxBins.
+         int localCount = static_cast<int>(local.size());
+         MPI_Allgather(&localCount, 1, MPI_INT, counts.data(), 1, MPI_INT, comm);
+         int total = 0;
+         for (int r = 0; r < worldSize; ++r) {
+             displs[r] = total;
+             total += counts[r];
+         }
+         std::vector<float> merged(total);
+         MPI_Allgatherv(local.data(), localCount, MPI_FLOAT, merged.data(), counts.data(), displs.data(),
+                        MPI_FLOAT, comm);
+         std::sort(merged.begin(), merged.end());
+         binEdges[f] = quantileEdges(merged, maxBins);
+     }
+ 
+     binColumns(X);
+ }
+ 
+ void BinnedFeatures::addChunk(const float* X, const int* y, int rows, int numFeatures) {
+     if (sortedRuns.empty()) {
+         this->numSamples = 0;
+         this->numFeatures = numFeatures;
+         numClasses = 0;
+         sortedRuns.assign(numFeatures, std::vector<std::vector<float>>());
+     }
+     for (int i = 0; i < rows; ++i) {
+         numClasses = std::max(numClasses, y[i] + 1);
+     }
+     numSamples += rows;
+ 
+     // Push the chunk as a new run and merge equal-sized neighbours, like
+     // carries in a binary counter
+     #pragma omp parallel for schedule(dynamic)
+     for (int f = 0; f < numFeatures; ++f) {
+         std::vector<std::vector<float>>& runs = sortedRuns[f];
+         std::vector<float> column(rows);
+         for (int i = 0; i < rows; ++i) {
+             column[i] = X[static_cast<size_t>(i) * numFeatures + f];
+         }
+         std::sort(column.begin(), column.end());
+         runs.push_back(std::move(column));
+         while (runs.size() >= 2 && runs[runs.size() - 2].size() <= runs.back().size()) {
+             std::vector<float>& front = runs[runs.size() - 2];
+             std::vector<float> merged(front.size() + runs.back().size());
+             std::merge(front.begin(), front.end(), runs.back().begin(), runs.back().end(), merged.begin());
+             runs.pop_back();
+             runs.back() = std::move(merged);
+         }
+     }
+ }
+ 
+ void BinnedFeatures::finish(FloatSpan X, int maxBins) {
+     maxBins = std::max(1, std::min(maxBins, kMaxBins));
+     binEdges.assign(numFeatures, std::vector<float>());
+ 
+     #pragma omp parallel for schedule(dynamic)
+     for (int f = 0; f < static_cast<int>(sortedRuns.size()); ++f) {
+         std::vector<std::vector<float>>& runs = sortedRuns[f];
+         while (runs.size() >= 2) {
+             std::vector<float>& front = runs[runs.size() - 2];
+             size_t middle = front.size();
+             front.insert(front.end(), runs.back().begin(), runs.back().end());
+             std::inplace_merge(front.begin(), front.begin() + middle, front.end());
+             runs.pop_back();
+         }
+         if (!runs.empty()) {
+             binEdges[f] = quantileEdges(runs.back(), maxBins);
+         }
+     }
+     sortedRuns.clear();
+ 
+     binColumns(X);
+ }
+ 
+ // bins[i][f] is the first edge of feature f that is >= X[i][f]
+ void BinnedFeatures::binColumns(FloatSpan X) {
+     bins.resize(static_cast<size_t>(numSamples) * numFeatures);
+ 
+     #pragma omp parallel for schedule(static)
+     for (int f = 0; f < numFeatures; ++f) {
+         const std::vector<float>& edges = binEdges[f];
+         for (int i = 0; i < numSamples; ++i) {
+             float value = X[static_cast<size_t>(i) * numFeatures + f];
+             size_t b = std::lower_bound(edges.begin(), edges.end(), value) - edges.begin();
+             bins[static_cast<size_t>(i) * numFeatures + f] = static_cast<uint8_t>(b);
+         }
+     }
+ }
+ 
  // Decision Tree implementation
  DecisionTree::DecisionTree(int maxDepth, int minSamplesLeaf, int numFeatures, unsigned int seed) 
      : root(nullptr), maxDepth(maxDepth), minSamplesLeaf(minSamplesLeaf), numFeatures(numFeatures), rng(seed) {
@@ -25,8 +199,10 @@
      delete root;
  }
  
- void DecisionTree::train(const std::vector<float>& X, const std::vector<int>& y, int numSamples, int numFeatures) {
+ void DecisionTree::train(FloatSpan X, LabelSpan y, int numSamples, int numFeatures,
+                           SplitMode splitMode, const BinnedFeatures* binned) {
      this->numFeatures = numFeatures;
+     this->binned = (splitMode == SplitMode::Histogram) ? binned : nullptr;
      
      // Create bootstrap sample indices
      std::vector<int> sampleIndices(numSamples);
@@ -37,11 +213,216 @@
          sampleIndices[i] = dist(rng);
      }
      
+     if (splitMode == SplitMode::Presorted) {
+         // Labels are expected to be encoded as 0..K-1
+         numClasses = 0;
+         for (int idx : sampleIndices) {
+             numClasses = std::max(numClasses, y[idx] + 1);
+         }
+         
+         // Argsort every feature column of the bootstrap sample once per tree
+         sortedIndices.assign(numFeatures, sampleIndices);
+         for (int f = 0; f < numFeatures; ++f) {
+             std::stable_sort(sortedIndices[f].begin(), sortedIndices[f].end(), [&](int a, int b) {
+                 return X[static_cast<size_t>(a) * numFeatures + f] < X[static_cast<size_t>(b) * numFeatures + f];
+             });
+         }
+         partitionBuffer.resize(numSamples);
+ 
+         root = buildTreePresorted(X, y, 0, numSamples, 0);
+ 
+         sortedIndices.clear();
+         sortedIndices.shrink_to_fit();
+         partitionBuffer.clear();
+         partitionBuffer.shrink_to_fit();
+         flatten();
+         return;
+     }
+     
      // Build the tree recursively
      root = buildTree(X, y, sampleIndices, 0);
+     this->binned = nullptr;
+     flatten();
+ }
+ 
+ void DecisionTree::trainDistributed(LabelSpan y, int numSamples, const BinnedFeatures& binned, MPI_Comm comm) {
+     int rank;
+     MPI_Comm_rank(comm, &rank);
+     this->numFeatures = binned.numFeatures;
+     this->binned = &binned;
+ 
+     // Bootstrap within the shard. Seeding its generator from rng on every
+     // rank keeps rng, which draws the features of each node, in step.
+     std::mt19937 bootstrapRng(rng() + static_cast<unsigned int>(rank));
+     std::vector<int> sampleIndices(numSamples);
+     if (numSamples > 0) {
+         std::uniform_int_distribution<int> dist(0, numSamples - 1);
+         for (int i = 0; i < numSamples; ++i) {
+             sampleIndices[i] = dist(bootstrapRng);
+         }
+     }
+ 
+     root = buildTreeDistributed(y, sampleIndices, 0, comm);
+     this->binned = nullptr;
+     flatten();
+ }
+ 
+ // Every rank runs this recursion in the same order with the same feature
+ // draws; only the sample indices differ. A node no local row reaches still
+ // takes part in the collectives with zero counts.
+ Node* DecisionTree::buildTreeDistributed(LabelSpan y, const std::vector<int>& sampleIndices,
+                                          int depth, MPI_Comm comm) {
+     Node* node = new Node();
+     const int numClasses = binned->numClasses;
+ 
+     std::vector<int> featureIndices;
+     if (depth < maxDepth) {
+         featureIndices.resize(numFeatures);
+         std::iota(featureIndices.begin(), featureIndices.end(), 0);
+         std::shuffle(featureIndices.begin(), featureIndices.end(), rng);
+         featureIndices.resize(mtry);
+     }
+ 
+     // One buffer, so one Allreduce per node: the node's class counts, then
+     // the per-bin class counts of each candidate feature
+     std::vector<size_t> offsets;
+     size_t size = numClasses;
+     for (int featureIndex : featureIndices) {
+         offsets.push_back(size);
+         size += binned->binEdges[featureIndex].size() * numClasses;
+     }
+     std::vector<int> counts(size, 0);
+     for (int idx : sampleIndices) {
+         counts[y[idx]]++;
+     }
+     for (size_t k = 0; k < featureIndices.size(); ++k) {
+         int* histogram = counts.data() + offsets[k];
+         for (int idx : sampleIndices) {
+             int bin = binned->bins[static_cast<size_t>(idx) * numFeatures + featureIndices[k]];
+             histogram[bin * numClasses + y[idx]]++;
+         }
+     }
+     MPI_Allreduce(MPI_IN_PLACE, counts.data(), static_cast<int>(size), MPI_INT, MPI_SUM, comm);
+ 
+     const size_t n = std::accumulate(counts.begin(), counts.begin() + numClasses, size_t(0));
+     auto makeLeaf = [&]() {
+         // Most common class over all ranks; ties go to the smaller label
+         node->isLeaf = true;
+         node->classLabel = static_cast<int>(std::max_element(counts.begin(), counts.begin() + numClasses) -
+                                             counts.begin());
+         return node;
+     };
+ 
+     if (depth >= maxDepth || n <= static_cast<size_t>(minSamplesLeaf)) {
+         return makeLeaf();
+     }
+ 
+     float bestGini = std::numeric_limits<float>::max();
+     int bestFeatureIndex = -1;
+     int bestBin = -1;
+     for (size_t k = 0; k < featureIndices.size(); ++k) {
+         const int numBins = static_cast<int>(binned->binEdges[featureIndices[k]].size());
+         int bin = scanHistogram(counts.data() + offsets[k], numBins, numClasses, counts.data(), n, bestGini);
+         if (bin >= 0) {
+             bestFeatureIndex = featureIndices[k];
+             bestBin = bin;
+         }
+     }
+     // scanHistogram only accepts splits that leave rows on both sides
+     if (bestFeatureIndex == -1) {
+         return makeLeaf();
+     }
+ 
+     node->featureIndex = bestFeatureIndex;
+     node->threshold = binned->binEdges[bestFeatureIndex][bestBin];
+ 
+     std::vector<int> leftIndices, rightIndices;
+     for (int idx : sampleIndices) {
+         if (binned->bins[static_cast<size_t>(idx) * numFeatures + bestFeatureIndex] <= bestBin) {
+             leftIndices.push_back(idx);
+         } else {
+             rightIndices.push_back(idx);
+         }
+     }
+ 
+     node->left = buildTreeDistributed(y, leftIndices, depth + 1, comm);
+     node->right = buildTreeDistributed(y, rightIndices, depth + 1, comm);
+     return node;
+ }
+ 
+ Node* DecisionTree::buildTreePresorted(FloatSpan X, LabelSpan y,
+                                        int begin, int end, int depth) {
+     Node* node = new Node();
+     const std::vector<int>& nodeSamples = sortedIndices[0];
+     
+     auto makeLeaf = [&]() {
+         node->isLeaf = true;
+         
+         // Determine the most common class
+         std::unordered_map<int, int> classCounts;
+         for (int i = begin; i < end; ++i) {
+             classCounts[y[nodeSamples[i]]]++;
+         }
+         
+         int maxCount = -1;
+         for (const auto& pair : classCounts) {
+             if (pair.second > maxCount) {
+                 maxCount = pair.second;
+                 node->classLabel = pair.first;
+             }
+         }
+         
+         return node;
+     };
+     
+     // Same stopping criteria as buildTree
+     if (depth >= maxDepth || end - begin <= minSamplesLeaf) {
+         return makeLeaf();
+     }
+     
+     // Select a random subset of features to consider
+     std::vector<int> featureIndices(numFeatures);
+     std::iota(featureIndices.begin(), featureIndices.end(), 0);
+     std::shuffle(featureIndices.begin(), featureIndices.end(), rng);
+     featureIndices.resize(mtry);
+     
+     auto [featureIndex, threshold] = findBestSplitPresorted(X, y, begin, end, featureIndices);
+     if (featureIndex == -1) {
+         return makeLeaf();
+     }
+     
+     // Stable-partition every feature list around the split, so both
+     // children inherit ranges that are still sorted by feature value
+     int mid = begin;
+     for (int f = 0; f < numFeatures; ++f) {
+         std::vector<int>& list = sortedIndices[f];
+         int left = begin;
+         int right = 0;
+         for (int i = begin; i < end; ++i) {
+             int idx = list[i];
+             if (X[static_cast<size_t>(idx) * numFeatures + featureIndex] <= threshold) {
+                 list[left++] = idx;
+             } else {
+                 partitionBuffer[right++] = idx;
+             }
+         }
+         std::copy(partitionBuffer.begin(), partitionBuffer.begin() + right, list.begin() + left);
+         mid = left;
+     }
+     
+     if (mid == begin || mid == end) {
+         return makeLeaf();
+     }
+     
+     node->featureIndex = featureIndex;
+     node->threshold = threshold;
+     node->left = buildTreePresorted(X, y, begin, mid, depth + 1);
+     node->right = buildTreePresorted(X, y, mid, end, depth + 1);
+     
+     return node;
  }
  
- Node* DecisionTree::buildTree(const std::vector<float>& X, const std::vector<int>& y, 
+ Node* DecisionTree::buildTree(FloatSpan X, LabelSpan y, 
                             const std::vector<int>& sampleIndices, int depth) {
      Node* node = new Node();
      
@@ -138,8 +519,12 @@
      return node;
  }
  
- std::pair<int, float> DecisionTree::findBestSplit(const std::vector<float>& X, const std::vector<int>& y, 
+ std::pair<int, float> DecisionTree::findBestSplit(FloatSpan X, LabelSpan y, 
                                                 const std::vector<int>& sampleIndices, const std::vector<int>& featureIndices) {
+     if (binned) {
+         return findBestSplitHistogram(y, sampleIndices, featureIndices);
+     }
+ 
      float bestGini = std::numeric_limits<float>::max();
      int bestFeatureIndex = -1;
      float bestThreshold = 0.0f;
@@ -192,7 +577,142 @@
      return {bestFeatureIndex, bestThreshold};
  }
  
- float DecisionTree::calculateGini(const std::vector<int>& y, const std::vector<int>& sampleIndices) {
+ std::pair<int, float> DecisionTree::findBestSplitHistogram(LabelSpan y,
+                                                         const std::vector<int>& sampleIndices,
+                                                         const std::vector<int>& featureIndices) {
+     const int numClasses = binned->numClasses;
+     const size_t n = sampleIndices.size();
+ 
+     float bestGini = std::numeric_limits<float>::max();
+     int bestFeatureIndex = -1;
+     float bestThreshold = 0.0f;
+ 
+     std::vector<int> totalCounts(numClasses, 0);
+     for (int idx : sampleIndices) {
+         totalCounts[y[idx]]++;
+     }
+ 
+     std::vector<int> histogram;
+ 
+     for (int featureIndex : featureIndices) {
+         const std::vector<float>& edges = binned->binEdges[featureIndex];
+         const int numBins = static_cast<int>(edges.size());
+ 
+         // One linear pass builds the per-bin class counts for this node
+         histogram.assign(static_cast<size_t>(numBins) * numClasses, 0);
+         for (int idx : sampleIndices) {
+             int bin = binned->bins[static_cast<size_t>(idx) * numFeatures + featureIndex];
+             histogram[bin * numClasses + y[idx]]++;
+         }
+ 
+         int bin = scanHistogram(histogram.data(), numBins, numClasses, totalCounts.data(), n, bestGini);
+         if (bin >= 0) {
+             bestFeatureIndex = featureIndex;
+             bestThreshold = edges[bin];
+         }
+     }
+ 
+     return {bestFeatureIndex, bestThreshold};
+ }
+ 
+ // Sweep the bins left to right, keeping a running left-side count; returns
+ // the bin whose upper edge gives a split better than bestGini (updating
+ // it), or -1
+ int DecisionTree::scanHistogram(const int* histogram, int numBins, int numClasses, const int* totalCounts,
+                                 size_t n, float& bestGini) const {
+     std::vector<int> leftCounts(numClasses, 0);
+     size_t leftSize = 0;
+     int bestBin = -1;
+     for (int b = 0; b < numBins - 1; ++b) {
+         for (int c = 0; c < numClasses; ++c) {
+             leftCounts[c] += histogram[b * numClasses + c];
+             leftSize += histogram[b * numClasses + c];
+         }
+         size_t rightSize = n - leftSize;
+ 
+         if (leftSize == 0 || rightSize == 0 ||
+             leftSize < static_cast<size_t>(minSamplesLeaf) ||
+             rightSize < static_cast<size_t>(minSamplesLeaf)) {
+             continue;
+         }
+ 
+         float leftGini = 1.0f;
+         float rightGini = 1.0f;
+         for (int c = 0; c < numClasses; ++c) {
+             float pl = static_cast<float>(leftCounts[c]) / leftSize;
+             float pr = static_cast<float>(totalCounts[c] - leftCounts[c]) / rightSize;
+             leftGini -= pl * pl;
+             rightGini -= pr * pr;
+         }
+         float weightedGini = (leftSize * leftGini + rightSize * rightGini) / n;
+ 
+         if (weightedGini < bestGini) {
+             bestGini = weightedGini;
+             bestBin = b;
+         }
+     }
+     return bestBin;
+ }
+ 
+ std::pair<int, float> DecisionTree::findBestSplitPresorted(FloatSpan X, LabelSpan y,
+                                                         int begin, int end,
+                                                         const std::vector<int>& featureIndices) {
+     const int n = end - begin;
+     
+     float bestGini = std::numeric_limits<float>::max();
+     int bestFeatureIndex = -1;
+     float bestThreshold = 0.0f;
+     
+     std::vector<int> totalCounts(numClasses, 0);
+     for (int i = begin; i < end; ++i) {
+         totalCounts[y[sortedIndices[0][i]]]++;
+     }
+     
+     std::vector<int> leftCounts(numClasses);
+     for (int featureIndex : featureIndices) {
+         const std::vector<int>& list = sortedIndices[featureIndex];
+         std::fill(leftCounts.begin(), leftCounts.end(), 0);
+         
+         // Running prefix of class counts; a threshold is only scored at the
+         // last occurrence of each value, matching "x <= threshold"
+         for (int i = begin; i < end - 1; ++i) {
+             int idx = list[i];
+             leftCounts[y[idx]]++;
+             
+             float value = X[static_cast<size_t>(idx) * numFeatures + featureIndex];
+             float nextValue = X[static_cast<size_t>(list[i + 1]) * numFeatures + featureIndex];
+             if (nextValue <= value) {
+                 continue;
+             }
+             
+             int leftSize = i - begin + 1;
+             int rightSize = n - leftSize;
+             if (leftSize < minSamplesLeaf || rightSize < minSamplesLeaf) {
+                 continue;
+             }
+             
+             float leftGini = 1.0f;
+             float rightGini = 1.0f;
+             for (int c = 0; c < numClasses; ++c) {
+                 float pl = static_cast<float>(leftCounts[c]) / leftSize;
+                 float pr = static_cast<float>(totalCounts[c] - leftCounts[c]) / rightSize;
+                 leftGini -= pl * pl;
+                 rightGini -= pr * pr;
+             }
+             float weightedGini = (leftSize * leftGini + rightSize * rightGini) / n;
+             
+             if (weightedGini < bestGini) {
+                 bestGini = weightedGini;
+                 bestFeatureIndex = featureIndex;
+                 bestThreshold = value;
+             }
+         }
+     }
+     
+     return {bestFeatureIndex, bestThreshold};
+ }
+ 
+ float DecisionTree::calculateGini(LabelSpan y, const std::vector<int>& sampleIndices) {
      if (sampleIndices.empty()) {
          return 0.0f;
      }
@@ -212,6 +732,19 @@
  }
  
  int DecisionTree::predict(const std::vector<float>& x) {
+     return predict(x.data());
+ }
+ 
+ int DecisionTree::predict(const float* x) const {
+     const FlatNode* nodes = flatNodes.data();
+     uint32_t i = 0;
+     while (nodes[i].featureIndex >= 0) {
+         i = (x[nodes[i].featureIndex] <= nodes[i].threshold) ? i + 1 : nodes[i].rightChild;
+     }
+     return nodes[i].classLabel;
+ }
+ 
+ int DecisionTree::predictPointerWalk(const std::vector<float>& x) {
      int prediction = -1;
      predict(x, root, prediction);
      return prediction;
@@ -230,13 +763,41 @@
      }
  }
  
+ void DecisionTree::flatten() {
+     flatNodes.clear();
+     flattenRecursive(root);
+     flatNodes.shrink_to_fit();
+ }
+ 
+ void DecisionTree::flattenRecursive(Node* node) {
+     uint32_t index = static_cast<uint32_t>(flatNodes.size());
+     flatNodes.push_back({node->isLeaf ? -1 : node->featureIndex, node->threshold, 0, node->classLabel});
+     
+     if (!node->isLeaf) {
+         flattenRecursive(node->left);
+         flatNodes[index].rightChild = static_cast<uint32_t>(flatNodes.size());
+         flattenRecursive(node->right);
+     }
+ }
+ 
  void DecisionTree::saveTree(const std::string& filename) {
      std::ofstream file(filename, std::ios::binary);
-     saveTreeRecursive(root, file);
+     serialize(file);
      file.close();
  }
  
- void DecisionTree::saveTreeRecursive(Node* node, std::ofstream& file) {
+ void DecisionTree::serialize(std::ostream& out) const {
+     saveTreeRecursive(root, out);
+ }
+ 
+ void DecisionTree::deserialize(std::istream& in) {
+     Node* loaded = loadTreeRecursive(in);
+     delete root;
+     root = loaded;
+     flatten();
+ }
+ 
+ void DecisionTree::saveTreeRecursive(const Node* node, std::ostream& file) const {
      // Write if it's a leaf node
      file.write(reinterpret_cast<const char*>(&node->isLeaf), sizeof(bool));
      
@@ -256,12 +817,13 @@
  
  void DecisionTree::loadTree(const std::string& filename) {
      std::ifstream file(filename, std::ios::binary);
-     delete root;  // Delete the existing tree
-     root = loadTreeRecursive(file);
-     file.close();
+     if (!file) {
+         throw std::runtime_error("Cannot open tree file " + filename);
+     }
+     deserialize(file);
  }
  
- Node* DecisionTree::loadTreeRecursive(std::ifstream& file) {
+ Node* DecisionTree::loadTreeRecursive(std::istream& file) {
      Node* node = new Node();
      
      // Read if it's a leaf node
@@ -270,22 +832,32 @@
      if (node->isLeaf) {
          // Read class label
          file.read(reinterpret_cast<char*>(&node->classLabel), sizeof(int));
-     } else {
+     } else if (file) {
          // Read split information
          file.read(reinterpret_cast<char*>(&node->featureIndex), sizeof(int));
          file.read(reinterpret_cast<char*>(&node->threshold), sizeof(float));
          
          // Recursively load left and right subtrees
-         node->left = loadTreeRecursive(file);
-         node->right = loadTreeRecursive(file);
+         try {
+             node->left = loadTreeRecursive(file);
+             node->right = loadTreeRecursive(file);
+         } catch (...) {
+             delete node;
+             throw;
+         }
      }
      
+     if (!file) {
+         delete node;
+         throw std::runtime_error("Truncated decision tree data");
+     }
      return node;
  }
  
  // Random Forest implementation
- RandomForest::RandomForest(int numTrees, int maxDepth, int minSamplesLeaf, int numFeatures)
-     : numTrees(numTrees), maxDepth(maxDepth), minSamplesLeaf(minSamplesLeaf), numFeatures(numFeatures) {
+ RandomForest::RandomForest(int numTrees, int maxDepth, int minSamplesLeaf, int numFeatures, SplitMode splitMode)
+     : numTrees(numTrees), maxDepth(maxDepth), minSamplesLeaf(minSamplesLeaf), numFeatures(numFeatures),
+       splitMode(splitMode), totalTrees(numTrees) {
      // Setup OpenMP threads according to configuration
      setup_openmp_threads();
      trees.resize(numTrees);
@@ -295,19 +867,33 @@
      // No need to manually delete shared_ptr objects
  }
  
- void RandomForest::train(const std::vector<float>& X, const std::vector<int>& y, int numSamples, int numFeatures) {
+ void RandomForest::train(FloatSpan X, LabelSpan y, int numSamples, int numFeatures,
+                          const BinnedFeatures* prebinned) {
      std::cout << "Training Random Forest with " << numTrees << " trees, " 
                << numSamples << " samples, and " << numFeatures << " features..." << std::endl;
      
+     // Quantize the features once (unless the caller already has) and share
+     // the bins across all trees
+     BinnedFeatures binned;
+     if (splitMode == SplitMode::Histogram && prebinned == nullptr) {
+         binned.build(X, y, numSamples, numFeatures);
+     }
+     const BinnedFeatures* binnedPtr = nullptr;
+     if (splitMode == SplitMode::Histogram) {
+         binnedPtr = prebinned ? prebinned : &binned;
+     }
+     const unsigned int baseSeed = hasSeed ? seed
+                                           : std::chrono::system_clock::now().time_since_epoch().count();
+     
      // Using OpenMP to parallelize tree training
      #pragma omp parallel for schedule(dynamic)
      for (int i = 0; i < numTrees; ++i) {
          // Each tree gets a different random seed
-         unsigned int seed = std::chrono::system_clock::now().time_since_epoch().count() + i;
+         unsigned int treeSeed = baseSeed + firstTree + i;
          
          // Use make_shared instead of new
-         trees[i] = std::make_shared<DecisionTree>(maxDepth, minSamplesLeaf, numFeatures, seed);
-         trees[i]->train(X, y, numSamples, numFeatures);
+         trees[i] = std::make_shared<DecisionTree>(maxDepth, minSamplesLeaf, numFeatures, treeSeed);
+         trees[i]->train(X, y, numSamples, numFeatures, splitMode, binnedPtr);
          
          #pragma omp critical
          {
@@ -318,21 +904,124 @@
      std::cout << "Random Forest training completed." << std::endl;
  }
  
+ void RandomForest::trainDistributed(FloatSpan X, LabelSpan y, int numSamples, int numFeatures, MPI_Comm comm) {
+     int worldSize;
+     MPI_Comm_size(comm, &worldSize);
+     long long globalSamples = numSamples;
+     MPI_Allreduce(MPI_IN_PLACE, &globalSamples, 1, MPI_LONG_LONG, MPI_SUM, comm);
+     std::cout << "Training Random Forest with " << numTrees << " trees, " << globalSamples << " samples on "
+               << worldSize << " ranks, and " << numFeatures << " features..." << std::endl;
+     
+     // The edges are shared by all ranks, so a bin index means the same
+     // threshold everywhere; each rank only bins its own rows
+     BinnedFeatures binned;
+     binned.buildDistributed(X, y, numSamples, numFeatures, comm);
+     unsigned int baseSeed = hasSeed ? seed
+                                     : std::chrono::system_clock::now().time_since_epoch().count();
+     MPI_Bcast(&baseSeed, 1, MPI_UNSIGNED, 0, comm);
+     
+     // One tree at a time, since every node of a tree is a collective over comm
+     trees.resize(numTrees);
+     for (int i = 0; i < numTrees; ++i) {
+         trees[i] = std::make_shared<DecisionTree>(maxDepth, minSamplesLeaf, numFeatures, baseSeed + firstTree + i);
+         trees[i]->trainDistributed(y, numSamples, binned, comm);
+         std::cout << "Tree " << i + 1 << "/" << numTrees << " trained." << std::endl;
+     }
+     
+     std::cout << "Random Forest training completed." << std::endl;
+ }
+ 
  int RandomForest::predict(const std::vector<float>& x) {
+     return predict(x.data());
+ }
+ 
+ int RandomForest::predict(const float* x) const {
+     // Tally votes in a small inline table; labels are a handful of classes,
+     // so a linear scan is cheaper than hashing
+     constexpr int kMaxInlineLabels = 8;
+     int labels[kMaxInlineLabels];
+     int counts[kMaxInlineLabels];
+     int numLabels = 0;
+     std::unordered_map<int, int> overflow;
+     
+     for (const auto& tree : trees) {
+         int label = tree->predict(x);
+         int k = 0;
+         while (k < numLabels && labels[k] != label) {
+             ++k;
+         }
+         if (k < numLabels) {
+             counts[k]++;
+         } else if (numLabels < kMaxInlineLabels) {
+             labels[numLabels] = label;
+             counts[numLabels++] = 1;
+         } else {
+             overflow[label]++;
+         }
+     }
+     
+     // Find the class with the most votes; ties go to the smaller label
+     int maxVotes = -1;
+     int prediction = -1;
+     for (int k = 0; k < numLabels; ++k) {
+         if (counts[k] > maxVotes || (counts[k] == maxVotes && labels[k] < prediction)) {
+             maxVotes = counts[k];
+             prediction = labels[k];
+         }
+     }
+     for (const auto& pair : overflow) {
+         if (pair.second > maxVotes || (pair.second == maxVotes && pair.first < prediction)) {
+             maxVotes = pair.second;
+             prediction = pair.first;
+         }
+     }
+     
+     return prediction;
+ }
+ 
+ void RandomForest::predictBatch(const float* X, int N, int D, int* out) {
+     if (D != numFeatures) {
+         throw std::invalid_argument("Feature count " + std::to_string(D) + " does not match model input size " +
+                                     std::to_string(numFeatures));
+     }
+     #pragma omp parallel for schedule(static)
+     for (int i = 0; i < N; ++i) {
+         out[i] = predict(X + static_cast<size_t>(i) * D);
+     }
+ }
+ 
+ void RandomForest::predictProbaBatch(const float* X, int N, int D, float* out) {
+     if (D != numFeatures) {
+         throw std::invalid_argument("Feature count " + std::to_string(D) + " does not match model input size " +
+                                     std::to_string(numFeatures));
+     }
+     const float perTree = trees.empty() ? 0.0f : 1.0f / trees.size();
+     #pragma omp parallel for schedule(static)
+     for (int i = 0; i < N; ++i) {
+         const float* row = X + static_cast<size_t>(i) * D;
+         int votes = 0;
+         for (const auto& tree : trees) {
+             votes += tree->predict(row) == 1;
+         }
+         out[i] = votes * perTree;
+     }
+ }
+ 
+ int RandomForest::predictPointerWalk(const std::vector<float>& x) {
      std::unordered_map<int, int> votes;
      
      // Each tree votes for a class
      for (auto tree : trees) {
-         int prediction = tree->predict(x);
+         int prediction = tree->predictPointerWalk(x);
          votes[prediction]++;
      }
      
-     // Find the class with the most votes
+     // Find the class with the most votes; ties go to the smaller label
      int maxVotes = -1;
      int prediction = -1;
      
      for (const auto& pair : votes) {
-         if (pair.second > maxVotes) {
+         if (pair.second > maxVotes || (pair.second == maxVotes && pair.first < prediction)) {
              maxVotes = pair.second;
              prediction = pair.first;
          }
@@ -341,43 +1030,161 @@
      return prediction;
  }
  
- void RandomForest::saveModel(const std::string& prefix) {
-     // Save each tree to a separate file
-     for (int i = 0; i < numTrees; ++i) {
-         std::string filename = prefix + "_tree_" + std::to_string(i) + ".bin";
-         trees[i]->saveTree(filename);
+ void RandomForest::setSeed(unsigned int seed) {
+     this->seed = seed;
+     hasSeed = true;
+ }
+ 
+ void RandomForest::setForestSlice(int firstTree, int totalTrees) {
+     this->firstTree = firstTree;
+     this->totalTrees = totalTrees;
+ }
+ 
+ void RandomForest::setTrees(std::vector<std::shared_ptr<DecisionTree>> trees) {
+     this->trees = std::move(trees);
+     numTrees = totalTrees = static_cast<int>(this->trees.size());
+     firstTree = 0;
+ }
+ 
+ void RandomForest::gatherForest(MPI_Comm comm, int root) {
+     int rank, worldSize;
+     MPI_Comm_rank(comm, &rank);
+     MPI_Comm_size(comm, &worldSize);
+     
+     // This rank's trees back to back; the records are self-delimiting
+     std::ostringstream out(std::ios::binary);
+     for (const auto& tree : trees) {
+         tree->serialize(out);
+     }
+     const std::string local = out.str();
+     if (local.size() > static_cast<size_t>(INT_MAX)) {
+         std::cerr << "Error: rank " << rank << " has more than 2 GB of trees to gather" << std::endl;
+         MPI_Abort(comm, 1);
      }
+     int localBytes = static_cast<int>(local.size());
+     int localTrees = static_cast<int>(trees.size());
      
-     // Save the forest metadata
-     std::ofstream metafile(prefix + "_meta.txt");
-     metafile << numTrees << " " << maxDepth << " " << minSamplesLeaf << " " << numFeatures << std::endl;
-     metafile.close();
+     std::vector<int> bytes(worldSize), treeCounts(worldSize), displs(worldSize);
+     MPI_Gather(&localBytes, 1, MPI_INT, bytes.data(), 1, MPI_INT, root, comm);
+     MPI_Gather(&localTrees, 1, MPI_INT, treeCounts.data(), 1, MPI_INT, root, comm);
      
-     std::cout << "Random Forest model saved with prefix: " << prefix << std::endl;
+     std::vector<char> gathered;
+     if (rank == root) {
+         long long total = 0;
+         for (int r = 0; r < worldSize; ++r) {
+             displs[r] = static_cast<int>(total);
+             total += bytes[r];
+             if (total > INT_MAX) {
+                 std::cerr << "Error: the gathered forest exceeds 2 GB" << std::endl;
+                 MPI_Abort(comm, 1);
+             }
+         }
+         gathered.resize(total);
+     }
+     MPI_Gatherv(local.data(), localBytes, MPI_CHAR, gathered.data(), bytes.data(), displs.data(), MPI_CHAR,
+                 root, comm);
+     
+     if (rank != root) {
+         return;
+     }
+     const int forestSize = std::accumulate(treeCounts.begin(), treeCounts.end(), 0);
+     std::istringstream in(std::string(gathered.begin(), gathered.end()), std::ios::binary);
+     std::vector<std::shared_ptr<DecisionTree>> all(forestSize);
+     for (int i = 0; i < forestSize; ++i) {
+         all[i] = std::make_shared<DecisionTree>(maxDepth, minSamplesLeaf, numFeatures, i);
+         all[i]->deserialize(in);
+     }
+     trees = std::move(all);
+     numTrees = totalTrees = forestSize;
+     firstTree = 0;
+     std::cout << "Random Forest gathered " << forestSize << " trees from " << worldSize << " ranks" << std::endl;
+ }
+ 
+ void RandomForest::saveModel(const std::string& path) {
+     std::ofstream file(path, std::ios::binary);
+     if (!file) {
+         throw std::runtime_error("Cannot write Random Forest model " + path);
+     }
+     ForestHeader header;
+     std::memcpy(header.magic, FOREST_MAGIC, sizeof(header.magic));
+     header.version = FOREST_VERSION;
+     header.numTrees = static_cast<int32_t>(trees.size());
+     header.maxDepth = maxDepth;
+     header.minSamplesLeaf = minSamplesLeaf;
+     header.numFeatures = numFeatures;
+     file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+     for (const auto& tree : trees) {
+         tree->serialize(file);
+     }
+     if (!file) {
+         throw std::runtime_error("Failed writing Random Forest model " + path);
+     }
+     
+     std::cout << "Random Forest model saved to " << path << " (" << trees.size() << " trees)" << std::endl;
  }
  
  void RandomForest::loadModel(const std::string& path) {
      // Implementing the interface method - use the prefix-based implementation
+     // and take the tree count from the stored metadata
      modelPath = path;
-     loadModel(path, numTrees);
+     loadModel(path, 0);
  }
  
- void RandomForest::loadModel(const std::string& prefix, int numTrees) {
-     // First, clear the existing trees
-     trees.clear();
-     
-     // Load the metadata
-     std::ifstream metafile(prefix + "_meta.txt");
-     metafile >> this->numTrees >> maxDepth >> minSamplesLeaf >> numFeatures;
-     metafile.close();
+ // Single-file forest; false if path is not one (e.g. a legacy prefix)
+ bool RandomForest::loadForestFile(const std::string& path) {
+     std::ifstream file(path, std::ios::binary);
+     ForestHeader header;
+     if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+         std::memcmp(header.magic, FOREST_MAGIC, sizeof(header.magic)) != 0) {
+         return false;
+     }
+     if (header.version != FOREST_VERSION || header.numTrees < 0) {
+         throw std::runtime_error(path + " is an unsupported Random Forest model version");
+     }
+     numTrees = header.numTrees;
+     maxDepth = header.maxDepth;
+     minSamplesLeaf = header.minSamplesLeaf;
+     numFeatures = header.numFeatures;
      
-     // Load each tree
      trees.resize(numTrees);
      for (int i = 0; i < numTrees; ++i) {
-         std::string filename = prefix + "_tree_" + std::to_string(i) + ".bin";
          trees[i] = std::make_shared<DecisionTree>(maxDepth, minSamplesLeaf, numFeatures, i);
-         trees[i]->loadTree(filename);
+         trees[i]->deserialize(file);
+     }
+     return true;
+ }
+ 
+ void RandomForest::loadModel(const std::string& prefix, int numTrees) {
+     // First, clear the existing trees
+     trees.clear();
+     
+     if (loadForestFile(prefix)) {
+         if (numTrees > 0 && numTrees < this->numTrees) {
+             trees.resize(numTrees);
+             this->numTrees = numTrees;
+         }
+     } else {
+         // Older layout: metadata plus one file per tree
+         std::ifstream metafile(prefix + "_meta.txt");
+         if (!(metafile >> this->numTrees >> maxDepth >> minSamplesLeaf >> numFeatures)) {
+             throw std::runtime_error("No Random Forest model at " + prefix);
+         }
+         metafile.close();
+         
+         if (numTrees <= 0) {
+             numTrees = this->numTrees;
+         }
+         
+         // Load each tree
+         trees.resize(numTrees);
+         for (int i = 0; i < numTrees; ++i) {
+             std::string filename = prefix + "_tree_" + std::to_string(i) + ".bin";
+             trees[i] = std::make_shared<DecisionTree>(maxDepth, minSamplesLeaf, numFeatures, i);
+             trees[i]->loadTree(filename);
+         }
+         this->numTrees = numTrees;
      }
+     totalTrees = this->numTrees;
      
      std::cout << "Random Forest model loaded from prefix: " << prefix << std::endl;
  }
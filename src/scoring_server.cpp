@@ -0,0 +1,363 @@
+/**
+ * scoring_server.cpp - Long-running request loop for ml_predictor
+ */
+
+ #include "./include/scoring_server.h"
+ #include <iostream>
+ #include <vector>
+ #include <deque>
+ #include <future>
+ #include <chrono>
+ #include <memory>
+ #include <algorithm>
+ #include <stdexcept>
+ #include <cstdio>
+ #include <cstdlib>
+ #include <cstring>
+ #include <cerrno>
+ #include <csignal>
+ #include <poll.h>
+ #include <fcntl.h>
+ #include <unistd.h>
+ #include <sys/socket.h>
+ #include <sys/stat.h>
+ #include <sys/un.h>
+
+ using namespace std;
+
+ static const size_t READ_CHUNK_BYTES = 1 << 16;
+ // A client that sends this much without a newline is dropped
+ static const size_t MAX_LINE_BYTES = 1 << 12;
+
+ static volatile sig_atomic_t stopRequested = 0;
+
+ static void requestStop(int) {
+     stopRequested = 1;
+ }
+
+ // A response slot: a decision still being scored, a stats line (filled in
+ // once every reply before it is complete) or ready text
+ struct Reply {
+     future<LoanDecision> decision;
+     bool stats = false;
+     string text;
+ };
+
+ // One client: bytes read but not yet split into requests, replies in
+ // request order, and response bytes not yet written
+ struct Connection {
+     int inFd;
+     int outFd;
+     string input;
+     deque<Reply> replies;
+     string output;
+     bool eof = false;
+     bool failed = false;
+
+     bool done() const { return eof && input.empty() && replies.empty() && output.empty(); }
+ };
+
+ static bool parseRequest(const string& line, float* features, string& error) {
+     const char* p = line.c_str();
+     for (int j = 0; j < LOAN_FEATURES; ++j) {
+         char* end = nullptr;
+         errno = 0;
+         double value = strtod(p, &end);
+         if (end == p || errno == ERANGE) {
+             error = "field " + to_string(j + 1) + " is not a number";
+             return false;
+         }
+         features[j] = static_cast<float>(value);
+         while (*end == ' ' || *end == '\t') ++end;
+         if (j + 1 < LOAN_FEATURES) {
+             if (*end != ',') {
+                 error = "expected " + to_string(LOAN_FEATURES) + " comma-separated fields";
+                 return false;
+             }
+             p = end + 1;
+         } else if (*end != '\0') {
+             error = "expected " + to_string(LOAN_FEATURES) + " comma-separated fields";
+             return false;
+         }
+     }
+     return true;
+ }
+
+ static const char* outcomeToken(LoanOutcome outcome) {
+     switch (outcome) {
+         case LoanOutcome::Approved: return "approved";
+         case LoanOutcome::Borderline: return "borderline";
+         case LoanOutcome::NotApproved: return "rejected";
+         default: return "unavailable";
+     }
+ }
+
+ static void appendResponse(string& out, const LoanDecision& d) {
+     char line[96];
+     int len = snprintf(line, sizeof(line), "%s,%d,%d,%d,%.1f\n", outcomeToken(d.outcome),
+                        d.rfVote, d.mlpVote, d.lrVote, d.riskScore);
+     out.append(line, len);
+ }
+
+ static string statsLine(const BatchScheduler& scheduler) {
+     SchedulerStats stats = scheduler.stats();
+     char line[160];
+     int len = snprintf(line, sizeof(line), "stats,%llu,%llu,%.1f,%.1f,%.1f\n",
+                        static_cast<unsigned long long>(stats.requests), static_cast<unsigned long long>(stats.batches),
+                        stats.meanBatch, stats.p50Micros, stats.p99Micros);
+     return string(line, len);
+ }
+
+ // Submit the complete lines of client's input (and the trailing partial
+ // line once the input has ended) and queue a reply slot for each
+ static void submitRequests(Connection& client, BatchScheduler& scheduler) {
+     size_t start = 0;
+     while (true) {
+         size_t nl = client.input.find('\n', start);
+         if (nl == string::npos && !(client.eof && start < client.input.size())) {
+             break;
+         }
+         size_t stop = nl == string::npos ? client.input.size() : nl;
+         string line = client.input.substr(start, stop - start);
+         start = nl == string::npos ? client.input.size() : nl + 1;
+         if (!line.empty() && line.back() == '\r') {
+             line.pop_back();
+         }
+         if (line.find_first_not_of(" \t") == string::npos) {
+             continue;
+         }
+
+         Reply reply;
+         float features[LOAN_FEATURES];
+         string error;
+         if (line == "stats") {
+             reply.stats = true;
+         } else if (!parseRequest(line, features, error)) {
+             reply.text = "error," + error + "\n";
+         } else {
+             reply.decision = scheduler.submit(features);
+         }
+         client.replies.push_back(move(reply));
+     }
+     client.input.erase(0, start);
+     if (client.input.size() > MAX_LINE_BYTES) {
+         client.failed = true;
+     }
+ }
+
+ // Move the leading replies that are complete to the output, keeping order
+ static void collectReplies(Connection& client, const BatchScheduler& scheduler) {
+     while (!client.replies.empty()) {
+         Reply& reply = client.replies.front();
+         if (reply.decision.valid()) {
+             if (reply.decision.wait_for(chrono::seconds(0)) != future_status::ready) {
+                 return;
+             }
+             try {
+                 appendResponse(client.output, reply.decision.get());
+             } catch (const exception& e) {
+                 client.output += string("error,") + e.what() + "\n";
+             }
+         } else if (reply.stats) {
+             client.output += statsLine(scheduler);
+         } else {
+             client.output += reply.text;
+         }
+         client.replies.pop_front();
+     }
+ }
+
+ // Write as much pending output as the descriptor takes
+ static void flushOutput(Connection& client) {
+     while (!client.output.empty()) {
+         ssize_t written = ::write(client.outFd, client.output.data(), client.output.size());
+         if (written < 0) {
+             if (errno == EINTR) {
+                 continue;
+             }
+             if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                 client.failed = true;
+             }
+             return;
+         }
+         client.output.erase(0, static_cast<size_t>(written));
+     }
+ }
+
+ static void readInput(Connection& client) {
+     char buffer[READ_CHUNK_BYTES];
+     ssize_t got = ::read(client.inFd, buffer, sizeof(buffer));
+     if (got > 0) {
+         client.input.append(buffer, static_cast<size_t>(got));
+     } else if (got == 0) {
+         client.eof = true;
+     } else if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+         client.failed = true;
+     }
+ }
+
+ // Poll the scheduler's wake pipe, the listener (if any) and every client
+ // until stopped, or until the last client is done when there is no listener
+ static void serveLoop(BatchScheduler& scheduler, int wakeFd, int listenFd,
+                       vector<unique_ptr<Connection>>& clients) {
+     vector<pollfd> fds;
+
+     while (!stopRequested && (listenFd >= 0 || !clients.empty())) {
+         fds.clear();
+         fds.push_back({wakeFd, POLLIN, 0});
+         fds.push_back({listenFd, POLLIN, 0});
+         for (const auto& client : clients) {
+             fds.push_back({client->eof ? -1 : client->inFd, POLLIN, 0});
+             fds.push_back({client->output.empty() ? -1 : client->outFd, POLLOUT, 0});
+         }
+         if (::poll(fds.data(), fds.size(), -1) < 0) {
+             if (errno == EINTR) {
+                 continue;
+             }
+             throw runtime_error(string("poll failed: ") + strerror(errno));
+         }
+
+         if (fds[0].revents & POLLIN) {
+             char drain[256];
+             while (::read(wakeFd, drain, sizeof(drain)) > 0) {
+             }
+         }
+         if (fds[1].revents & POLLIN) {
+             int fd;
+             while ((fd = ::accept(listenFd, nullptr, nullptr)) >= 0) {
+                 ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+                 clients.push_back(make_unique<Connection>(Connection{fd, fd}));
+             }
+         }
+
+         // Hand new requests to the scheduler, which batches them across
+         // clients and poll rounds
+         for (size_t c = 0, f = 2; f < fds.size(); ++c, f += 2) {
+             Connection& client = *clients[c];
+             if (fds[f].revents & (POLLIN | POLLHUP | POLLERR)) {
+                 readInput(client);
+             }
+             submitRequests(client, scheduler);
+         }
+
+         for (auto& client : clients) {
+             collectReplies(*client, scheduler);
+             flushOutput(*client);
+         }
+
+         // Drop clients that are finished or broken
+         for (size_t c = 0; c < clients.size(); ) {
+             Connection& client = *clients[c];
+             if (client.failed || client.done()) {
+                 if (listenFd >= 0) {
+                     ::close(client.inFd);
+                 }
+                 clients.erase(clients.begin() + c);
+             } else {
+                 ++c;
+             }
+         }
+     }
+ }
+
+ static void reportStats(const SchedulerStats& stats) {
+     cerr << "Served " << stats.requests << " requests in " << stats.batches << " batches";
+     if (stats.batches > 0) {
+         cerr << " (" << stats.meanBatch << " per batch), latency p50 " << stats.p50Micros
+              << " us, p99 " << stats.p99Micros << " us, max " << stats.maxMicros << " us";
+     }
+     cerr << endl;
+ }
+
+ // Run serveLoop with a scheduler that wakes it through a pipe whenever a
+ // batch completes
+ static void serveWithScheduler(LoanScorer& scorer, int listenFd, vector<unique_ptr<Connection>>& clients,
+                                const ServerOptions& options) {
+     int wake[2];
+     if (::pipe(wake) != 0) {
+         throw runtime_error(string("Could not create pipe: ") + strerror(errno));
+     }
+     for (int fd : wake) {
+         ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+     }
+
+     SchedulerStats stats;
+     try {
+         BatchScheduler scheduler(scorer, options.batching, [&wake] {
+             // A full pipe already guarantees a wake-up, so a failed write is fine
+             char byte = 1;
+             ssize_t ignored = ::write(wake[1], &byte, 1);
+             (void)ignored;
+         });
+         serveLoop(scheduler, wake[0], listenFd, clients);
+         stats = scheduler.stats();
+     } catch (...) {
+         ::close(wake[0]);
+         ::close(wake[1]);
+         throw;
+     }
+     ::close(wake[0]);
+     ::close(wake[1]);
+     reportStats(stats);
+ }
+
+ void serveStream(LoanScorer& scorer, int inFd, int outFd, const ServerOptions& options) {
+     signal(SIGPIPE, SIG_IGN);
+     vector<unique_ptr<Connection>> clients;
+     clients.push_back(make_unique<Connection>(Connection{inFd, outFd}));
+     serveWithScheduler(scorer, -1, clients, options);
+ }
+
+ void serveSocket(LoanScorer& scorer, const string& path, const ServerOptions& options) {
+     sockaddr_un address{};
+     if (path.size() >= sizeof(address.sun_path)) {
+         throw runtime_error("Socket path too long: " + path);
+     }
+     address.sun_family = AF_UNIX;
+     strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+     // Replace a stale socket from an earlier run, but never another file
+     struct stat st;
+     if (::stat(path.c_str(), &st) == 0) {
+         if (!S_ISSOCK(st.st_mode)) {
+             throw runtime_error(path + " exists and is not a socket");
+         }
+         ::unlink(path.c_str());
+     }
+
+     int listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+     if (listenFd < 0) {
+         throw runtime_error(string("Could not create socket: ") + strerror(errno));
+     }
+     if (::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+         ::listen(listenFd, SOMAXCONN) != 0) {
+         int err = errno;
+         ::close(listenFd);
+         throw runtime_error("Could not listen on " + path + ": " + strerror(err));
+     }
+     ::fcntl(listenFd, F_SETFL, ::fcntl(listenFd, F_GETFL) | O_NONBLOCK);
+
+     // No SA_RESTART, so a signal interrupts poll and ends the loop
+     struct sigaction action{};
+     action.sa_handler = requestStop;
+     sigemptyset(&action.sa_mask);
+     sigaction(SIGINT, &action, nullptr);
+     sigaction(SIGTERM, &action, nullptr);
+     signal(SIGPIPE, SIG_IGN);
+
+     cerr << "Listening on " << path << endl;
+     vector<unique_ptr<Connection>> clients;
+     try {
+         serveWithScheduler(scorer, listenFd, clients, options);
+     } catch (...) {
+         ::close(listenFd);
+         ::unlink(path.c_str());
+         throw;
+     }
+
+     for (auto& client : clients) {
+         ::close(client->inFd);
+     }
+     ::close(listenFd);
+     ::unlink(path.c_str());
+ }
@@ -0,0 +1,355 @@
+/**
+ * simd_kernels.cpp - Runtime-dispatched AVX-512 / AVX2 / scalar kernels
+ */
+
+ #include "./include/simd_kernels.h"
+
+ // GCC 12 flags the _mm512_undefined_* placeholders inside the AVX-512
+ // intrinsic headers as uninitialized when inlined under -Wall -O3
+ #pragma GCC diagnostic push
+ #pragma GCC diagnostic ignored "-Wuninitialized"
+ #pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+ #include <immintrin.h>
+ #include <cmath>
+ #include <cstdlib>
+ #include <cstring>
+ #include <cstdint>
+
+ namespace kernels {
+ namespace {
+
+ // Cephes expf constants shared by the vector paths
+ constexpr float EXP_HI = 88.3762626647949f;
+ constexpr float EXP_LO = -88.3762626647949f;
+ constexpr float LOG2E = 1.44269504088896341f;
+ constexpr float EXP_C1 = 0.693359375f;
+ constexpr float EXP_C2 = -2.12194440e-4f;
+ constexpr float EXP_P0 = 1.9875691500e-4f;
+ constexpr float EXP_P1 = 1.3981999507e-3f;
+ constexpr float EXP_P2 = 8.3334519073e-3f;
+ constexpr float EXP_P3 = 4.1665795894e-2f;
+ constexpr float EXP_P4 = 1.6666665459e-1f;
+ constexpr float EXP_P5 = 5.0000001201e-1f;
+
+ // Rows per gather block in the small-D logit kernels
+ constexpr int GATHER_MAX_D = 16;
+
+ // ---------------------------------------------------------------------
+ // Scalar fallback
+ // ---------------------------------------------------------------------
+
+ void sigmoidScalar(const float* x, float* out, int n) {
+     for (int i = 0; i < n; ++i) {
+         out[i] = 1.0f / (1.0f + std::exp(-x[i]));
+     }
+ }
+
+ float dotScalar(const float* a, const float* b, int n) {
+     float sum = 0.0f;
+     for (int i = 0; i < n; ++i) {
+         sum += a[i] * b[i];
+     }
+     return sum;
+ }
+
+ void axpyScalar(float alpha, const float* x, float* y, int n) {
+     for (int i = 0; i < n; ++i) {
+         y[i] += alpha * x[i];
+     }
+ }
+
+ void logitsScalar(const float* X, int N, int D, const float* w, float bias, float* out) {
+     for (int i = 0; i < N; ++i) {
+         out[i] = bias + dotScalar(X + static_cast<size_t>(i) * D, w, D);
+     }
+ }
+
+ // ---------------------------------------------------------------------
+ // AVX2 + FMA
+ // ---------------------------------------------------------------------
+
+ __attribute__((target("avx2,fma")))
+ inline __m256 exp256(__m256 x) {
+     x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(EXP_LO)), _mm256_set1_ps(EXP_HI));
+
+     // x = n * ln2 + r, |r| <= ln2 / 2
+     __m256 fx = _mm256_floor_ps(_mm256_fmadd_ps(x, _mm256_set1_ps(LOG2E), _mm256_set1_ps(0.5f)));
+     x = _mm256_fnmadd_ps(fx, _mm256_set1_ps(EXP_C1), x);
+     x = _mm256_fnmadd_ps(fx, _mm256_set1_ps(EXP_C2), x);
+
+     __m256 z = _mm256_mul_ps(x, x);
+     __m256 y = _mm256_set1_ps(EXP_P0);
+     y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(EXP_P1));
+     y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(EXP_P2));
+     y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(EXP_P3));
+     y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(EXP_P4));
+     y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(EXP_P5));
+     y = _mm256_fmadd_ps(y, z, _mm256_add_ps(x, _mm256_set1_ps(1.0f)));
+
+     // Scale by 2^n
+     __m256i n = _mm256_add_epi32(_mm256_cvttps_epi32(fx), _mm256_set1_epi32(127));
+     return _mm256_mul_ps(y, _mm256_castsi256_ps(_mm256_slli_epi32(n, 23)));
+ }
+
+ __attribute__((target("avx2,fma")))
+ inline __m256 sigmoid256(__m256 x) {
+     __m256 one = _mm256_set1_ps(1.0f);
+     __m256 e = exp256(_mm256_sub_ps(_mm256_setzero_ps(), x));
+     return _mm256_div_ps(one, _mm256_add_ps(one, e));
+ }
+
+ __attribute__((target("avx2,fma")))
+ inline float hsum256(__m256 v) {
+     __m128 lo = _mm256_castps256_ps128(v);
+     __m128 hi = _mm256_extractf128_ps(v, 1);
+     lo = _mm_add_ps(lo, hi);
+     lo = _mm_add_ps(lo, _mm_movehl_ps(lo, lo));
+     lo = _mm_add_ss(lo, _mm_shuffle_ps(lo, lo, 0x55));
+     return _mm_cvtss_f32(lo);
+ }
+
+ __attribute__((target("avx2,fma")))
+ void sigmoidAvx2(const float* x, float* out, int n) {
+     int i = 0;
+     for (; i + 8 <= n; i += 8) {
+         _mm256_storeu_ps(out + i, sigmoid256(_mm256_loadu_ps(x + i)));
+     }
+     if (i < n) {
+         float tail[8] = {0};
+         std::memcpy(tail, x + i, (n - i) * sizeof(float));
+         _mm256_storeu_ps(tail, sigmoid256(_mm256_loadu_ps(tail)));
+         std::memcpy(out + i, tail, (n - i) * sizeof(float));
+     }
+ }
+
+ __attribute__((target("avx2,fma")))
+ float dotAvx2(const float* a, const float* b, int n) {
+     __m256 acc0 = _mm256_setzero_ps();
+     __m256 acc1 = _mm256_setzero_ps();
+     int i = 0;
+     for (; i + 16 <= n; i += 16) {
+         acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+         acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+     }
+     for (; i + 8 <= n; i += 8) {
+         acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+     }
+     float sum = hsum256(_mm256_add_ps(acc0, acc1));
+     for (; i < n; ++i) {
+         sum += a[i] * b[i];
+     }
+     return sum;
+ }
+
+ __attribute__((target("avx2,fma")))
+ void axpyAvx2(float alpha, const float* x, float* y, int n) {
+     __m256 va = _mm256_set1_ps(alpha);
+     int i = 0;
+     for (; i + 8 <= n; i += 8) {
+         _mm256_storeu_ps(y + i, _mm256_fmadd_ps(va, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+     }
+     for (; i < n; ++i) {
+         y[i] += alpha * x[i];
+     }
+ }
+
+ __attribute__((target("avx2,fma")))
+ void logitsAvx2(const float* X, int N, int D, const float* w, float bias, float* out) {
+     if (D > GATHER_MAX_D) {
+         for (int i = 0; i < N; ++i) {
+             out[i] = bias + dotAvx2(X + static_cast<size_t>(i) * D, w, D);
+         }
+         return;
+     }
+
+     // Narrow rows: vectorize across 8 rows at a time, gathering one
+     // feature column per step
+     const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+     const __m256i offsets = _mm256_mullo_epi32(lane, _mm256_set1_epi32(D));
+     int i = 0;
+     for (; i + 8 <= N; i += 8) {
+         const float* base = X + static_cast<size_t>(i) * D;
+         __m256 acc = _mm256_set1_ps(bias);
+         for (int j = 0; j < D; ++j) {
+             __m256 col = _mm256_i32gather_ps(base + j, offsets, 4);
+             acc = _mm256_fmadd_ps(col, _mm256_set1_ps(w[j]), acc);
+         }
+         _mm256_storeu_ps(out + i, acc);
+     }
+     for (; i < N; ++i) {
+         out[i] = bias + dotScalar(X + static_cast<size_t>(i) * D, w, D);
+     }
+ }
+
+ // ---------------------------------------------------------------------
+ // AVX-512F
+ // ---------------------------------------------------------------------
+
+ __attribute__((target("avx512f")))
+ inline __m512 exp512(__m512 x) {
+     x = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(EXP_LO)), _mm512_set1_ps(EXP_HI));
+
+     __m512 fx = _mm512_roundscale_ps(_mm512_fmadd_ps(x, _mm512_set1_ps(LOG2E), _mm512_set1_ps(0.5f)),
+                                      _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+     x = _mm512_fnmadd_ps(fx, _mm512_set1_ps(EXP_C1), x);
+     x = _mm512_fnmadd_ps(fx, _mm512_set1_ps(EXP_C2), x);
+
+     __m512 z = _mm512_mul_ps(x, x);
+     __m512 y = _mm512_set1_ps(EXP_P0);
+     y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(EXP_P1));
+     y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(EXP_P2));
+     y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(EXP_P3));
+     y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(EXP_P4));
+     y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(EXP_P5));
+     y = _mm512_fmadd_ps(y, z, _mm512_add_ps(x, _mm512_set1_ps(1.0f)));
+
+     __m512i n = _mm512_add_epi32(_mm512_cvttps_epi32(fx), _mm512_set1_epi32(127));
+     return _mm512_mul_ps(y, _mm512_castsi512_ps(_mm512_slli_epi32(n, 23)));
+ }
+
+ __attribute__((target("avx512f")))
+ inline __m512 sigmoid512(__m512 x) {
+     __m512 one = _mm512_set1_ps(1.0f);
+     __m512 e = exp512(_mm512_sub_ps(_mm512_setzero_ps(), x));
+     return _mm512_div_ps(one, _mm512_add_ps(one, e));
+ }
+
+ __attribute__((target("avx512f")))
+ inline __mmask16 tailMask(int remaining) {
+     return static_cast<__mmask16>((1u << remaining) - 1u);
+ }
+
+ __attribute__((target("avx512f")))
+ void sigmoidAvx512(const float* x, float* out, int n) {
+     int i = 0;
+     for (; i + 16 <= n; i += 16) {
+         _mm512_storeu_ps(out + i, sigmoid512(_mm512_loadu_ps(x + i)));
+     }
+     if (i < n) {
+         __mmask16 m = tailMask(n - i);
+         _mm512_mask_storeu_ps(out + i, m, sigmoid512(_mm512_maskz_loadu_ps(m, x + i)));
+     }
+ }
+
+ __attribute__((target("avx512f")))
+ float dotAvx512(const float* a, const float* b, int n) {
+     __m512 acc = _mm512_setzero_ps();
+     int i = 0;
+     for (; i + 16 <= n; i += 16) {
+         acc = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc);
+     }
+     if (i < n) {
+         __mmask16 m = tailMask(n - i);
+         acc = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, a + i), _mm512_maskz_loadu_ps(m, b + i), acc);
+     }
+     return _mm512_reduce_add_ps(acc);
+ }
+
+ __attribute__((target("avx512f")))
+ void axpyAvx512(float alpha, const float* x, float* y, int n) {
+     __m512 va = _mm512_set1_ps(alpha);
+     int i = 0;
+     for (; i + 16 <= n; i += 16) {
+         _mm512_storeu_ps(y + i, _mm512_fmadd_ps(va, _mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i)));
+     }
+     if (i < n) {
+         __mmask16 m = tailMask(n - i);
+         __m512 r = _mm512_fmadd_ps(va, _mm512_maskz_loadu_ps(m, x + i), _mm512_maskz_loadu_ps(m, y + i));
+         _mm512_mask_storeu_ps(y + i, m, r);
+     }
+ }
+
+ __attribute__((target("avx512f")))
+ void logitsAvx512(const float* X, int N, int D, const float* w, float bias, float* out) {
+     if (D > GATHER_MAX_D) {
+         for (int i = 0; i < N; ++i) {
+             out[i] = bias + dotAvx512(X + static_cast<size_t>(i) * D, w, D);
+         }
+         return;
+     }
+
+     const __m512i lane = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+     const __m512i offsets = _mm512_mullo_epi32(lane, _mm512_set1_epi32(D));
+     int i = 0;
+     for (; i + 16 <= N; i += 16) {
+         const float* base = X + static_cast<size_t>(i) * D;
+         __m512 acc = _mm512_set1_ps(bias);
+         for (int j = 0; j < D; ++j) {
+             __m512 col = _mm512_i32gather_ps(offsets, base + j, 4);
+             acc = _mm512_fmadd_ps(col, _mm512_set1_ps(w[j]), acc);
+         }
+         _mm512_storeu_ps(out + i, acc);
+     }
+     if (i < N) {
+         __mmask16 m = tailMask(N - i);
+         const float* base = X + static_cast<size_t>(i) * D;
+         __m512 acc = _mm512_set1_ps(bias);
+         for (int j = 0; j < D; ++j) {
+             __m512 col = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), m, offsets, base + j, 4);
+             acc = _mm512_fmadd_ps(col, _mm512_set1_ps(w[j]), acc);
+         }
+         _mm512_mask_storeu_ps(out + i, m, acc);
+     }
+ }
+
+ // ---------------------------------------------------------------------
+ // Dispatch
+ // ---------------------------------------------------------------------
+
+ struct KernelTable {
+     const char* isa;
+     void (*sigmoid)(const float*, float*, int);
+     float (*dot)(const float*, const float*, int);
+     void (*axpy)(float, const float*, float*, int);
+     void (*logits)(const float*, int, int, const float*, float, float*);
+ };
+
+ KernelTable selectKernels() {
+     const char* cap = std::getenv("ML_SIMD");
+     bool allowAvx512 = !cap || std::strcmp(cap, "avx512") == 0;
+     bool allowAvx2 = allowAvx512 || (cap && std::strcmp(cap, "avx2") == 0);
+
+     __builtin_cpu_init();
+     if (allowAvx512 && __builtin_cpu_supports("avx512f")) {
+         return {"avx512", sigmoidAvx512, dotAvx512, axpyAvx512, logitsAvx512};
+     }
+     if (allowAvx2 && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+         return {"avx2", sigmoidAvx2, dotAvx2, axpyAvx2, logitsAvx2};
+     }
+     return {"scalar", sigmoidScalar, dotScalar, axpyScalar, logitsScalar};
+ }
+
+ const KernelTable& table() {
+     static const KernelTable kernels = selectKernels();
+     return kernels;
+ }
+
+ } // namespace
+
+ const char* activeIsa() {
+     return table().isa;
+ }
+
+ float sigmoid(float x) {
+     return 1.0f / (1.0f + std::exp(-x));
+ }
+
+ void sigmoid(const float* x, float* out, int n) {
+     table().sigmoid(x, out, n);
+ }
+
+ float dot(const float* a, const float* b, int n) {
+     return table().dot(a, b, n);
+ }
+
+ void axpy(float alpha, const float* x, float* y, int n) {
+     table().axpy(alpha, x, y, n);
+ }
+
+ void logits(const float* X, int N, int D, const float* w, float bias, float* out) {
+     table().logits(X, N, D, w, bias, out);
+ }
+
+ } // namespace kernels
+
+ #pragma GCC diagnostic pop
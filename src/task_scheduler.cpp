@@ -0,0 +1,183 @@
+/**
+ * task_scheduler.cpp - Dynamic master/worker task scheduling over MPI
+ */
+
+ #include "./include/task_scheduler.h"
+ #include <algorithm>
+ #include <cstring>
+ #include <stdexcept>
+
+ static const int TAG_TASK = 1;
+ static const int TAG_RESULT = 2;
+ static const int TAG_STOP = 3;
+
+ // Task messages are a TaskHeader followed by the payload; results are the
+ // task id followed by the executor's output
+ struct TaskHeader {
+     int32_t kind;
+     int32_t id;
+ };
+
+ TaskScheduler::TaskScheduler(MPI_Comm comm, Executor execute, int tasksInFlight)
+     : comm(comm), execute(std::move(execute)), tasksInFlight(std::max(1, tasksInFlight)) {
+     MPI_Comm_rank(comm, &rank);
+     MPI_Comm_size(comm, &worldSize);
+     inFlight.assign(worldSize, 0);
+     completedByRank.assign(worldSize, 0);
+ }
+
+ TaskScheduler::~TaskScheduler() {
+     if (isMaster() && !stopped) {
+         for (int worker = 1; worker < worldSize; ++worker) {
+             MPI_Send(nullptr, 0, MPI_CHAR, worker, TAG_STOP, comm);
+         }
+         reapSends(true);
+     }
+ }
+
+ void TaskScheduler::serve() {
+     Payload message;
+     Payload reply;
+     MPI_Request replyRequest = MPI_REQUEST_NULL;
+
+     while (true) {
+         MPI_Status status;
+         MPI_Probe(0, MPI_ANY_TAG, comm, &status);
+         int bytes;
+         MPI_Get_count(&status, MPI_CHAR, &bytes);
+         message.resize(bytes);
+         MPI_Recv(message.data(), bytes, MPI_CHAR, 0, status.MPI_TAG, comm, MPI_STATUS_IGNORE);
+         if (status.MPI_TAG == TAG_STOP) {
+             break;
+         }
+
+         TaskHeader header;
+         std::memcpy(&header, message.data(), sizeof(header));
+         Payload input(message.begin() + sizeof(header), message.end());
+         Payload output = execute(header.kind, input);
+
+         // The previous reply has to leave before its buffer is reused
+         MPI_Wait(&replyRequest, MPI_STATUS_IGNORE);
+         reply.resize(sizeof(header.id) + output.size());
+         std::memcpy(reply.data(), &header.id, sizeof(header.id));
+         std::copy(output.begin(), output.end(), reply.begin() + sizeof(header.id));
+         MPI_Isend(reply.data(), static_cast<int>(reply.size()), MPI_CHAR, 0, TAG_RESULT, comm, &replyRequest);
+     }
+     MPI_Wait(&replyRequest, MPI_STATUS_IGNORE);
+ }
+
+ void TaskScheduler::submit(int kind, int priority, Payload input, Completion onDone) {
+     queue.emplace(std::make_pair(-priority, submitted++), Queued{kind, std::move(input), std::move(onDone)});
+ }
+
+ void TaskScheduler::runUntil(const std::function<bool()>& done) {
+     while (!done()) {
+         dispatch();
+         if (receiveResult(false)) {
+             continue;
+         }
+         if (!queue.empty()) {
+             // Every worker already has its share
+             runLocally();
+         } else if (!running.empty()) {
+             receiveResult(true);
+         } else {
+             throw std::logic_error("TaskScheduler: no tasks left but the wait condition does not hold");
+         }
+     }
+ }
+
+ void TaskScheduler::shutdown() {
+     if (!queue.empty() || !running.empty()) {
+         throw std::logic_error("TaskScheduler: shutdown with tasks outstanding");
+     }
+     for (int worker = 1; worker < worldSize; ++worker) {
+         MPI_Send(nullptr, 0, MPI_CHAR, worker, TAG_STOP, comm);
+     }
+     reapSends(true);
+     stopped = true;
+ }
+
+ // Top up the workers, least loaded first, from the head of the queue;
+ // returns whether anything was sent
+ bool TaskScheduler::dispatch() {
+     bool sent = false;
+     for (int level = 0; level < tasksInFlight && !queue.empty(); ++level) {
+         for (int worker = 1; worker < worldSize && !queue.empty(); ++worker) {
+             if (inFlight[worker] != level) {
+                 continue;
+             }
+             auto head = queue.begin();
+             TaskHeader header{head->second.kind, nextTaskId++};
+             const Payload& input = head->second.input;
+
+             sends.push_back(PendingSend{MPI_REQUEST_NULL, Payload(sizeof(header) + input.size())});
+             Payload& message = sends.back().message;
+             std::memcpy(message.data(), &header, sizeof(header));
+             std::copy(input.begin(), input.end(), message.begin() + sizeof(header));
+             MPI_Isend(message.data(), static_cast<int>(message.size()), MPI_CHAR, worker, TAG_TASK, comm,
+                       &sends.back().request);
+
+             running.emplace(header.id, std::move(head->second.onDone));
+             queue.erase(head);
+             ++inFlight[worker];
+             sent = true;
+         }
+     }
+     reapSends(false);
+     return sent;
+ }
+
+ // Complete one task whose result has arrived (waiting for one if asked);
+ // returns whether a task completed
+ bool TaskScheduler::receiveResult(bool wait) {
+     MPI_Status status;
+     int arrived = 1;
+     if (wait) {
+         MPI_Probe(MPI_ANY_SOURCE, TAG_RESULT, comm, &status);
+     } else {
+         MPI_Iprobe(MPI_ANY_SOURCE, TAG_RESULT, comm, &arrived, &status);
+     }
+     if (!arrived) {
+         return false;
+     }
+
+     int bytes;
+     MPI_Get_count(&status, MPI_CHAR, &bytes);
+     Payload message(bytes);
+     MPI_Recv(message.data(), bytes, MPI_CHAR, status.MPI_SOURCE, TAG_RESULT, comm, MPI_STATUS_IGNORE);
+     int32_t id;
+     std::memcpy(&id, message.data(), sizeof(id));
+     --inFlight[status.MPI_SOURCE];
+     ++completedByRank[status.MPI_SOURCE];
+
+     auto task = running.find(id);
+     Completion onDone = std::move(task->second);
+     running.erase(task);
+     onDone(Payload(message.begin() + sizeof(id), message.end()));
+     return true;
+ }
+
+ void TaskScheduler::runLocally() {
+     auto head = queue.begin();
+     Queued task = std::move(head->second);
+     queue.erase(head);
+     Payload output = execute(task.kind, task.input);
+     ++completedByRank[0];
+     task.onDone(std::move(output));
+ }
+
+ void TaskScheduler::reapSends(bool wait) {
+     while (!sends.empty()) {
+         int finished = 1;
+         if (wait) {
+             MPI_Wait(&sends.front().request, MPI_STATUS_IGNORE);
+         } else {
+             MPI_Test(&sends.front().request, &finished, MPI_STATUS_IGNORE);
+         }
+         if (!finished) {
+             return;
+         }
+         sends.pop_front();
+     }
+ }